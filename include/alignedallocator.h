@@ -0,0 +1,79 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Cache-aligned allocator for the dense buffers of the key detector
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef INCLUDE_ALIGNEDALLOCATOR_H_
+#define INCLUDE_ALIGNEDALLOCATOR_H_
+
+#include<cstddef>
+#include<cstdlib>
+#include<new>
+#include<vector>
+
+namespace justkeydding {
+
+// Minimal C++11 allocator returning memory aligned to a cache line,
+// so that every row of a dense (T x states) lattice starts on a
+// predictable boundary.
+template <typename T, std::size_t Alignment = 64>
+class AlignedAllocator {
+ public:
+    typedef T value_type;
+    template <typename U> struct rebind {
+        typedef AlignedAllocator<U, Alignment> other;
+    };
+    AlignedAllocator() {}
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+    T *allocate(std::size_t n) {
+        void *p = NULL;
+        if (n == 0) {
+            n = 1;
+        }
+        if (posix_memalign(&p, Alignment, n * sizeof(T)) != 0) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T *>(p);
+    }
+    void deallocate(T *p, std::size_t) {
+        std::free(p);
+    }
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment> &) const {
+        return true;
+    }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment> &) const {
+        return false;
+    }
+};
+
+typedef std::vector<double, AlignedAllocator<double> > AlignedDoubleVector;
+typedef std::vector<signed char,
+    AlignedAllocator<signed char> > AlignedStateVector;
+
+}  // namespace justkeydding
+
+#endif  // INCLUDE_ALIGNEDALLOCATOR_H_
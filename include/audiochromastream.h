@@ -0,0 +1,113 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Audio to chromagram, frame by frame
+
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef INCLUDE_AUDIOCHROMASTREAM_H_
+#define INCLUDE_AUDIOCHROMASTREAM_H_
+
+#include <vamp-hostsdk/PluginInputDomainAdapter.h>
+#include <vamp-hostsdk/PluginBufferingAdapter.h>
+#include <NNLSChroma.h>
+#include <sndfile.h>
+
+#include<string>
+#include<vector>
+
+#include "./pitchclass.h"
+#include "./chromagrambuffer.h"
+#include "./chromagramcache.h"
+#include "./chunkedfrontend.h"
+#include "./status.h"
+
+namespace justkeydding {
+
+// Reads an audio file block by block through NNLS Chroma.
+//
+// With a warm-up of zero or more seconds, the plugin streams: the
+// global tuning is estimated on the warm-up window, and from then on
+// every block read gives its chroma frames at once, without keeping the
+// spectra of the file. Otherwise the tuning is estimated on the whole
+// file, and every frame comes out after the last block.
+//
+// The frames ready at once are shared by numberOfThreads threads, all
+// the cores by default (0), with the same output whatever their number,
+// and their semitone spectra are solved by nnlsSolver (an
+// NNLSChroma::NNLSSolver).
+// Offline, with numberOfFrontEnds above one (not by default, nor on the
+// command line), the spectral front end is parallel too: the file is
+// read by a ChunkedFrontEnd, and its spectra are fed in order to the
+// plugin, which updates its running tuning estimates exactly as if it
+// had read them itself.
+class AudioChromaStream {
+ public:
+    explicit AudioChromaStream(
+        std::string audioFilename,
+        double warmUpSeconds = -1,
+        int numberOfThreads = 0,
+        int nnlsSolver = NNLSChroma::LawsonHansonSolver,
+        int numberOfFrontEnds = 1);
+    AudioChromaStream(const AudioChromaStream &) = delete;
+    AudioChromaStream &operator=(const AudioChromaStream &) = delete;
+    ~AudioChromaStream();
+    // Reads until new frames (C to B) are appended to chromagram, or
+    // until the end of the file; false once everything is out
+    bool read(ChromagramBuffer *chromagram);
+    // The tuning is the one of the frames out so far
+    const ChromagramCache::Parameters &getParameters() const;
+    int getStatus() const;
+    // NNLS work of the frames out so far
+    NNLSChroma::NNLSStatistics getNNLSStatistics() const;
+    // Parameters of the plugin that decide its output
+    static void getNNLSParameters(
+        const NNLSChroma &chroma,
+        ChromagramCache::Parameters *parameters);
+
+ private:
+    int m_status;
+    SF_INFO m_sfinfo;
+    SNDFILE *m_sndfile;
+    // Owned by m_adapter, through the input domain adapter
+    NNLSChroma *m_chroma;
+    Vamp::HostExt::PluginBufferingAdapter *m_adapter;
+    int m_blockSize;
+    int m_chromaFeatureNo;
+    sf_count_t m_frame;
+    std::vector<float> m_fileBuffer;
+    std::vector<float> m_mixBuffer;
+    ChromagramCache::Parameters m_parameters;
+    // Offline with several front ends, NULL otherwise
+    ChunkedFrontEnd *m_frontEnd;
+    // Mixes the next block of the file down to mono, false at its end
+    bool readBlock(float *mixbuf);
+    bool readChunks(ChromagramBuffer *chromagram);
+    static void appendFeatures(
+        const Vamp::Plugin::FeatureList &chromaFeatures,
+        ChromagramBuffer *chromagram);
+};
+
+}  // namespace justkeydding
+
+#endif  // INCLUDE_AUDIOCHROMASTREAM_H_
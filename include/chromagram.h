@@ -27,14 +27,10 @@ SOFTWARE.
 #ifndef INCLUDE_CHROMAGRAM_H_
 #define INCLUDE_CHROMAGRAM_H_
 
-#include <vamp-hostsdk/PluginInputDomainAdapter.h>
-#include <vamp-hostsdk/PluginBufferingAdapter.h>
 #include <NNLSChroma.h>
-#include <sndfile.h>
 
 #include<string>
 #include<vector>
-#include<map>
 #include<cmath>
 #include<iostream>
 #include<fstream>
@@ -44,6 +40,11 @@ SOFTWARE.
 #include "./key.h"
 #include "./keyprofile.h"
 #include "./keytransition.h"
+#include "./chromagrambuffer.h"
+#include "./chromagramcsvreader.h"
+#include "./chromagramcache.h"
+#include "./audiochromastream.h"
+#include "./featurecache.h"
 #include "./status.h"
 
 using std::cout;
@@ -56,23 +57,55 @@ class Chromagram {
  public:
   typedef std::array<double,
       PitchClass::NUMBER_OF_PITCHCLASSES> ChromagramVector;
-  typedef std::map<double, ChromagramVector> ChromagramMap;
+  typedef std::vector<ChromagramVector> ChromagramSequence;
   enum enFileType {
     FILETYPE_CSV,
     FILETYPE_AUDIO,
+    FILETYPE_CACHE,
   };
-  Chromagram(std::string fileName, enFileType fileType);
+  // Audio files are looked up in, and added to, the feature cache if any,
+  // and extracted by numberOfThreads threads (all the cores with 0) with
+  // the NNLSChroma::NNLSSolver nnlsSolver
+  Chromagram(
+      std::string fileName,
+      enFileType fileType,
+      FeatureCache *featureCache = NULL,
+      int numberOfThreads = 0,
+      int nnlsSolver = NNLSChroma::LawsonHansonSolver);
   PitchClass::PitchClassSequence getPitchClassSequence();
+  // Pitch classes of one frame, each one repeated its discrete value
+  // minus one times
+  static void appendPitchClasses(
+      const ChromagramBuffer &chromagram,
+      std::size_t frame,
+      PitchClass::PitchClassSequence *pitchClassSequence);
+  // Original chroma vectors (C to B), one per frame in time order
+  ChromagramSequence getChromagramSequence();
   void printChromagram();
   int getStatus() const;
   void printOriginalChromagram(bool);
+  // Frames in time order, without copies
+  const ChromagramBuffer &getChromagramBuffer() const;
+  // How the frames were extracted, zero when unknown
+  const ChromagramCache::Parameters &getParameters() const;
+  // NNLS work of the extraction, zero unless from an audio file
+  const NNLSChroma::NNLSStatistics &getNNLSStatistics() const;
+  // What the chromagrams of audio files depend on, besides the audio
+  static std::string getExtractionSignature(
+      int nnlsSolver = NNLSChroma::LawsonHansonSolver);
+  // Binary cache that can be read back as a FILETYPE_CACHE
+  bool writeChromagramCache(std::string cacheFilename) const;
  private:
   int m_status;
-  ChromagramMap m_originalChromagramMap;
-  ChromagramMap m_discreteChromagramMap;
+  ChromagramBuffer m_chromagram;
+  ChromagramCache::Parameters m_parameters;
+  NNLSChroma::NNLSStatistics m_nnlsStatistics;
   void getChromagramFromCsv(std::string csvFilename);
-  void getChromagramFromAudio(std::string audioFilename);
-  void discretizeChromagram();
+  void getChromagramFromAudio(
+      std::string audioFilename,
+      int numberOfThreads,
+      int nnlsSolver);
+  void getChromagramFromCache(std::string cacheFilename);
 };
 
 }  // namespace justkeydding
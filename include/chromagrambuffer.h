@@ -0,0 +1,76 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Contiguous frame-major storage of a chromagram
+
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef INCLUDE_CHROMAGRAMBUFFER_H_
+#define INCLUDE_CHROMAGRAMBUFFER_H_
+
+#include<vector>
+#include<ostream>
+#include<cstddef>
+
+#include "./pitchclass.h"
+
+namespace justkeydding {
+
+// One timestamp and twelve chroma values (C to B) per frame, the
+// values kept in a single frames x 12 float matrix. Discrete chroma
+// values are the floor of the original ones, computed when needed.
+class ChromagramBuffer {
+ public:
+    typedef std::vector<double> TimestampVector;
+    typedef std::vector<float> FrameMatrix;
+    ChromagramBuffer();
+    // frames holds PitchClass::NUMBER_OF_PITCHCLASSES values per timestamp
+    ChromagramBuffer(TimestampVector timestamps, FrameMatrix frames);
+    void reserve(std::size_t numberOfFrames);
+    // Adds a frame of zeros at the end and returns its chroma values
+    float *appendFrame(double timestamp);
+    // Sorts the frames by timestamp; of several frames with the same
+    // timestamp only the last one is kept
+    void sortByTimestamp();
+    std::size_t getNumberOfFrames() const;
+    bool isEmpty() const;
+    double getTimestamp(std::size_t frame) const;
+    const float *getFrame(std::size_t frame) const;
+    int getDiscreteChroma(std::size_t frame, int pitchClass) const;
+    // Whether two frames have the same discrete chroma values
+    bool isSameDiscreteFrame(std::size_t frame, std::size_t other) const;
+    const TimestampVector &getTimestamps() const;
+    // Row-major, PitchClass::NUMBER_OF_PITCHCLASSES values per frame
+    const FrameMatrix &getFrames() const;
+    // Sonic Annotator CSV lines, with enough digits to read back the
+    // same floats, the chroma values from A to G# if startOnANatural
+    void writeCsv(std::ostream &out, bool startOnANatural) const;
+
+ private:
+    TimestampVector m_timestamps;
+    FrameMatrix m_frames;
+};
+
+}  // namespace justkeydding
+
+#endif  // INCLUDE_CHROMAGRAMBUFFER_H_
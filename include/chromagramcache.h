@@ -0,0 +1,100 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Binary chromagram cache, memory-mapped on load
+
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef INCLUDE_CHROMAGRAMCACHE_H_
+#define INCLUDE_CHROMAGRAMCACHE_H_
+
+#include<string>
+#include<memory>
+#include<cstddef>
+#include<cstdint>
+
+#include "./pitchclass.h"
+#include "./chromagrambuffer.h"
+#include "./status.h"
+
+namespace justkeydding {
+
+// A chromagram extracted once and stored in binary, so that every model
+// of an ensemble maps it instead of parsing the text of --chromaonly.
+//
+// Layout, little-endian, every section aligned to 64 bytes:
+//   header      magic "JKDCHROM", version, pitch classes, frames and
+//               the extraction parameters
+//   timestamps  float64 per frame, in seconds
+//   frames      float32 x 12 per frame, from C to B
+//
+// The timestamps and frames are used in place from the mapping.
+class ChromagramCache {
+ public:
+    static const std::uint32_t VERSION = 1;
+    // How the chromagram was extracted, zero when unknown (for example
+    // when it comes from a CSV file)
+    struct Parameters {
+        double sampleRate;
+        std::uint32_t blockSize;
+        std::uint32_t stepSize;
+        // NNLS Chroma parameters, as given by getParameter()
+        float useNNLS;
+        float whitening;
+        float spectralShape;
+        float rollOn;
+        float boostN;
+        float tuningMode;
+        float chromaNormalize;
+        // Estimated tuning frequency, in Hz
+        float tuning;
+        Parameters();
+    };
+    explicit ChromagramCache(const std::string &fileName);
+    int getStatus() const;
+    const Parameters &getParameters() const;
+    std::size_t getNumberOfFrames() const;
+    const double *getTimestamps() const;
+    // Row-major, PitchClass::NUMBER_OF_PITCHCLASSES values per frame
+    const float *getFrames() const;
+    // Copy of the mapped frames
+    ChromagramBuffer getChromagramBuffer() const;
+    // Writes the cache, false on failure
+    static bool write(
+        const std::string &fileName,
+        const ChromagramBuffer &chromagram,
+        const Parameters &parameters);
+
+ private:
+    struct Header;
+    int m_status;
+    std::shared_ptr<const void> m_mapping;
+    Parameters m_parameters;
+    std::size_t m_numberOfFrames;
+    const double *m_timestamps;
+    const float *m_frames;
+};
+
+}  // namespace justkeydding
+
+#endif  // INCLUDE_CHROMAGRAMCACHE_H_
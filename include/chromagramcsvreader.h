@@ -0,0 +1,82 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Memory-mapped reader of Sonic Annotator chromagram CSV files
+
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef INCLUDE_CHROMAGRAMCSVREADER_H_
+#define INCLUDE_CHROMAGRAMCSVREADER_H_
+
+#include<string>
+#include<vector>
+#include<cstddef>
+
+#include "./pitchclass.h"
+#include "./chromagrambuffer.h"
+#include "./status.h"
+
+namespace justkeydding {
+
+// Reads the chromagram CSV files written by Sonic Annotator (and by
+// --chromaonly), one frame per line: a timestamp followed by the twelve
+// chroma values from A to G#.
+//
+// The file is memory-mapped and parsed in place into a ChromagramBuffer,
+// with the chroma values stored from C to B. Values are rounded to float exactly as std::stof
+// does; most of them take a fast path and the rest fall back to strtof.
+// Large files are split at newlines and parsed by several threads, each
+// writing its own rows of the preallocated buffers.
+class ChromagramCsvReader {
+ public:
+    // Smallest share of the file worth a thread of its own
+    static const std::size_t MINIMUM_BYTES_PER_THREAD = 4 << 20;
+    explicit ChromagramCsvReader(const std::string &fileName);
+    // Threads used by read(), automatic (0) by default
+    void setNumberOfThreads(int numberOfThreads);
+    void read();
+    int getStatus() const;
+    // Frames in the order of the file
+    const ChromagramBuffer &getChromagramBuffer() const;
+    // Size of the file and time spent reading it
+    std::size_t getNumberOfBytes() const;
+    double getSeconds() const;
+    double getMegabytesPerSecond() const;
+
+ private:
+    int m_status;
+    std::string m_fileName;
+    int m_numberOfThreads;
+    ChromagramBuffer m_chromagramBuffer;
+    std::size_t m_numberOfBytes;
+    double m_seconds;
+    bool parse(
+        const char *begin,
+        const char *end,
+        ChromagramBuffer::TimestampVector *timestamps,
+        ChromagramBuffer::FrameMatrix *frames);
+};
+
+}  // namespace justkeydding
+
+#endif  // INCLUDE_CHROMAGRAMCSVREADER_H_
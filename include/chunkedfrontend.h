@@ -0,0 +1,108 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Spectral front end of NNLS Chroma, run on chunks of a signal at once
+
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef INCLUDE_CHUNKEDFRONTEND_H_
+#define INCLUDE_CHUNKEDFRONTEND_H_
+
+#include <vamp-hostsdk/PluginInputDomainAdapter.h>
+#include <vamp-hostsdk/PluginBufferingAdapter.h>
+#include <NNLSChroma.h>
+
+#include<vector>
+#include<cstdint>
+
+namespace justkeydding {
+
+// Log-frequency spectra (FFT and log-frequency mapping, the front end
+// of NNLS Chroma) of a mono signal given block by block, computed by
+// numberOfFrontEnds front ends at once, each on a chunk of
+// blocksPerChunk blocks. A front end starts and ends two analysis
+// windows beyond its chunk, so that the frames of the chunk are those
+// of a single front end over the whole signal, timestamps included.
+//
+// Blocks are appended while needsBlocks(), or until endSignal(), and
+// every process() gives the spectra of the next round of chunks, one
+// per front end, in time order.
+class ChunkedFrontEnd {
+ public:
+    static const int BLOCKS_PER_CHUNK = 256;
+    ChunkedFrontEnd(
+        int sampleRate,
+        int blockSize,
+        int numberOfFrontEnds,
+        int blocksPerChunk = BLOCKS_PER_CHUNK);
+    ChunkedFrontEnd(const ChunkedFrontEnd &) = delete;
+    ChunkedFrontEnd &operator=(const ChunkedFrontEnd &) = delete;
+    ~ChunkedFrontEnd();
+    // False if a front end could not be initialised
+    bool isReady() const;
+    // Whether the next round of chunks needs more blocks
+    bool needsBlocks() const;
+    // Appends the next blockSize samples
+    void appendBlock(const float *block);
+    // The blocks appended so far are the whole signal
+    void endSignal();
+    // Appends the spectra of the next round of chunks to logSpectra
+    void process(Vamp::Plugin::FeatureList *logSpectra);
+    // Whether the spectra of every block are out
+    bool isDone() const;
+    // Input domain and buffering adapters around the plugin, which they
+    // own, as a host reading the signal block by block uses
+    static Vamp::HostExt::PluginBufferingAdapter *makeAdapter(
+        NNLSChroma *chroma);
+
+ private:
+    // Host and plugin of a front end thread
+    struct FrontEnd {
+        Vamp::HostExt::PluginBufferingAdapter *adapter;
+        int logSpectrumFeatureNo;
+    };
+    bool m_ready;
+    int m_sampleRate;
+    int m_blockSize;
+    int m_blocksPerChunk;
+    std::vector<FrontEnd> m_frontEnds;
+    // Blocks a front end reads before and after its chunk
+    int m_overlapBlocks;
+    // Blocks appended and not done with yet, from m_firstBlock on
+    std::vector<float> m_blocks;
+    std::int64_t m_firstBlock;
+    std::int64_t m_numberOfBlocks;
+    // First block of the next chunk
+    std::int64_t m_nextBlock;
+    bool m_endOfSignal;
+    // Log-frequency spectra of the frames starting in blocks begin to end
+    void processChunk(
+        FrontEnd *frontEnd,
+        std::int64_t begin,
+        std::int64_t end,
+        Vamp::Plugin::FeatureList *logSpectrum) const;
+};
+
+}  // namespace justkeydding
+
+#endif  // INCLUDE_CHUNKEDFRONTEND_H_
@@ -0,0 +1,144 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Log-domain key model compiled once from a key profile and key transition
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef INCLUDE_COMPILEDKEYMODEL_H_
+#define INCLUDE_COMPILEDKEYMODEL_H_
+
+#include<map>
+#include<vector>
+#include<memory>
+#include<cmath>
+#include<cstddef>
+
+#include "./pitchclass.h"
+#include "./key.h"
+#include "./keyprofile.h"
+#include "./keytransition.h"
+#include "./alignedallocator.h"
+
+namespace justkeydding {
+
+// Immutable, log10-domain version of a key HMM. Every table is computed
+// once in the constructor and never modified afterwards, so a single
+// instance can be shared (through ConstPointer) by any number of
+// HiddenMarkovModel objects, files and threads.
+//
+// States are addressed by their position in the states vector, symbols
+// by their integer value (PitchClass or Key). The emission table is
+// stored symbol-major, so the scores of all states for one observation
+// are contiguous.
+//
+// Besides the separate log tables, the model keeps one step matrix per
+// symbol, log10(transition * emission), and one start vector per symbol,
+// log10(initial * emission). These are the exact terms the Viterbi
+// recurrence used to evaluate in its inner loop, so decoding with them
+// is a pure max-plus product that reproduces the historical scores.
+//
+// All the tables live in one contiguous block, in the order initial,
+// transition, emission, start, step. The block is either owned by the
+// model or borrowed, e.g., from a memory-mapped ModelBundle, in which
+// case the model keeps a reference to its owner.
+class CompiledKeyModel {
+ public:
+    typedef std::shared_ptr<const CompiledKeyModel> ConstPointer;
+    // First-stage model over all keys: symmetrical initial
+    // probabilities, the given key transitions and key profiles
+    CompiledKeyModel(KeyProfile keyProfile, KeyTransition keyTransition);
+    CompiledKeyModel(
+      Key::KeyVector states,
+      std::map<Key, double> initialProbabilities,
+      std::map<Key, std::map<Key, double> > transitionProbabilities,
+      std::map<Key, std::map<PitchClass, double> > emissionProbabilities);
+    CompiledKeyModel(
+      Key::KeyVector states,
+      std::map<Key, double> initialProbabilities,
+      std::map<Key, std::map<Key, double> > transitionProbabilities,
+      std::map<Key, std::map<Key, double> > emissionProbabilities);
+    // All keys as states and pitch classes as symbols, with the tables
+    // already compiled in the block layout. The owner keeps the block
+    // alive and is released with the model.
+    CompiledKeyModel(const double *tables, std::shared_ptr<const void> owner);
+    CompiledKeyModel(const CompiledKeyModel &) = delete;
+    CompiledKeyModel &operator=(const CompiledKeyModel &) = delete;
+    // Doubles in the block of tables
+    static std::size_t getNumberOfTableValues(
+      int numberOfStates,
+      int numberOfSymbols);
+    const double *getTables() const;
+    int getNumberOfStates() const;
+    int getNumberOfSymbols() const;
+    // Key represented by the state at this position
+    int getState(int state) const;
+    // numberOfStates values
+    const double *getLogInitial() const;
+    // numberOfStates x numberOfStates, row-major [from][to]
+    const double *getLogTransition() const;
+    // numberOfStates values for one observation symbol
+    const double *getLogEmission(int symbol) const;
+    // numberOfStates values, the sum over the symbols of
+    // weights[symbol] * log10(emission), for one weighted observation of
+    // numberOfSymbols values. Weights that are not positive are ignored.
+    void getWeightedLogEmission(
+      const double *weights,
+      double *logEmission) const;
+    // numberOfStates values, log10(initial * emission) for one symbol
+    const double *getLogStart(int symbol) const;
+    // numberOfStates x numberOfStates, row-major [from][to],
+    // log10(transition * emission) for one symbol
+    const double *getLogStep(int symbol) const;
+
+ private:
+    int m_numberOfSymbols;
+    std::vector<int> m_states;
+    std::vector<int> m_stateIndex;
+    AlignedDoubleVector m_tableStorage;
+    std::shared_ptr<const void> m_tableOwner;
+    const double *m_logInitial;
+    const double *m_logTransition;
+    const double *m_logEmission;
+    const double *m_logStart;
+    const double *m_logStep;
+    void initStates(const Key::KeyVector &states);
+    void setTables(const double *tables);
+    std::vector<double> getInitialVector(
+      const std::map<Key, double> &initialProbabilities) const;
+    std::vector<double> getTransitionMatrix(
+      const std::map<Key, std::map<Key, double> > &transitionProbabilities)
+      const;
+    template <typename Symbol>
+    std::vector<double> getEmissionMatrix(
+      const std::map<Key, std::map<Symbol, double> > &emissionProbabilities,
+      int numberOfSymbols) const;
+    void compile(
+      const std::vector<double> &initialProbabilities,
+      const std::vector<double> &transitionProbabilities,
+      const std::vector<double> &emissionProbabilities,
+      int numberOfSymbols);
+};
+
+}  // namespace justkeydding
+
+#endif  // INCLUDE_COMPILEDKEYMODEL_H_
@@ -0,0 +1,83 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Key detection under every model of an ensemble
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef INCLUDE_ENSEMBLE_H_
+#define INCLUDE_ENSEMBLE_H_
+
+#include<string>
+#include<vector>
+#include<cstddef>
+
+#include "./pitchclass.h"
+#include "./keytransition.h"
+#include "./compiledkeymodel.h"
+#include "./hiddenmarkovmodel.h"
+#include "./globalkeyestimator.h"
+#include "./modelbundle.h"
+#include "./status.h"
+
+namespace justkeydding {
+
+// The models of an ensemble of a ModelBundle, each with the key
+// transitions of its second stage. estimate() runs both stages of the
+// detector under every model on the same observations: the local keys
+// with a HiddenMarkovModel of its own, then the global key with a
+// GlobalKeyEstimator. The probability vectors are those that -p prints
+// for the same model, one per model in the order of the ensemble
+// (justkeydding -B FILE -E NAME).
+//
+// A missing ensemble, or a member the bundle has no model for, leaves
+// the ensemble with ENSEMBLE_MODEL_ERROR.
+class Ensemble {
+ public:
+    typedef GlobalKeyEstimator::ProbabilityVector ProbabilityVector;
+    Ensemble(const ModelBundle &bundle, const std::string &name);
+    // Of the local-key stage, as in HiddenMarkovModel
+    void setViterbiMode(HiddenMarkovModel::enViterbiMode viterbiMode);
+    void setNumberOfThreads(int numberOfThreads);
+    void setBeamWidth(double beamWidth);
+    void estimate(const std::vector<PitchClass> &observations);
+    void estimate(
+        const HiddenMarkovModel::WeightedObservations &observations);
+    std::size_t getNumberOfModels() const;
+    const std::vector<CompiledKeyModel::ConstPointer> &getModels() const;
+    std::vector<ProbabilityVector> getProbabilityVectors() const;
+    int getStatus() const;
+
+ private:
+    int m_status;
+    HiddenMarkovModel::enViterbiMode m_viterbiMode;
+    int m_numberOfThreads;
+    double m_beamWidth;
+    std::vector<CompiledKeyModel::ConstPointer> m_models;
+    std::vector<KeyTransition::KeyTransitionArray> m_transitions;
+    std::vector<ProbabilityVector> m_probabilityVectors;
+    void estimate(HiddenMarkovModel *hmm, std::size_t model);
+};
+
+}  // namespace justkeydding
+
+#endif  // INCLUDE_ENSEMBLE_H_
@@ -0,0 +1,108 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Content-addressed on-disk cache of chromagrams and results
+
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef INCLUDE_FEATURECACHE_H_
+#define INCLUDE_FEATURECACHE_H_
+
+#include<string>
+#include<map>
+#include<cstddef>
+#include<cstdint>
+
+#include "./chromagrambuffer.h"
+#include "./chromagramcache.h"
+#include "./status.h"
+
+namespace justkeydding {
+
+// A directory of chromagrams, keyed by the content of the audio file
+// and the extraction parameters, and of the final results of the
+// detector, keyed by the same key and a model identifier:
+//
+//   directory/chroma/KEY.chroma
+//   directory/results/KEY-MODEL.txt
+//
+// Entries are written aside and renamed, so concurrent processes
+// never read half an entry, and the last writer of an entry wins.
+// Reading an entry refreshes its modification time; when the entries
+// exceed the size bound, the least recently used ones are removed,
+// one process at a time (under a lock on directory/lock).
+class FeatureCache {
+ public:
+    struct Statistics {
+        std::size_t chromagramHits;
+        std::size_t chromagramMisses;
+        std::size_t resultHits;
+        std::size_t resultMisses;
+        std::size_t evictedEntries;
+        Statistics();
+    };
+    static const std::uint64_t DEFAULT_MAXIMUM_BYTES = 1000000000ULL;
+    FeatureCache(const std::string &directory, std::uint64_t maximumBytes);
+    int getStatus() const;
+    // Key of the content of a file and a description of how it is
+    // analyzed, empty if the file cannot be read
+    std::string getKey(
+        const std::string &fileName,
+        const std::string &parameters);
+    // Hexadecimal FNV-1a hash of a block of memory, to build identifiers
+    static std::string hash(const void *data, std::size_t size);
+    bool findChromagram(
+        const std::string &key,
+        ChromagramBuffer *chromagram,
+        ChromagramCache::Parameters *parameters);
+    bool storeChromagram(
+        const std::string &key,
+        const ChromagramBuffer &chromagram,
+        const ChromagramCache::Parameters &parameters);
+    bool findResult(
+        const std::string &key,
+        const std::string &modelId,
+        std::string *result);
+    bool storeResult(
+        const std::string &key,
+        const std::string &modelId,
+        const std::string &result);
+    const Statistics &getStatistics() const;
+
+ private:
+    int m_status;
+    std::string m_directory;
+    std::uint64_t m_maximumBytes;
+    Statistics m_statistics;
+    // Content hashes of the files seen, each file is read only once
+    std::map<std::string, std::string> m_contentHashes;
+    std::string getChromagramFileName(const std::string &key) const;
+    std::string getResultFileName(
+        const std::string &key,
+        const std::string &modelId) const;
+    void evict();
+};
+
+}  // namespace justkeydding
+
+#endif  // INCLUDE_FEATURECACHE_H_
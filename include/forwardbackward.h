@@ -0,0 +1,89 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Scaled forward-backward algorithm for per-frame key posteriors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef INCLUDE_FORWARDBACKWARD_H_
+#define INCLUDE_FORWARDBACKWARD_H_
+
+#include<vector>
+#include<cstddef>
+
+#include "./pitchclass.h"
+#include "./key.h"
+#include "./status.h"
+#include "./compiledkeymodel.h"
+#include "./alignedallocator.h"
+
+namespace justkeydding {
+
+// Posterior probability of every key at every frame, given the whole
+// observation sequence, under a CompiledKeyModel.
+//
+// The recursions run in the linear domain on the step matrices
+// 10^logStep = transition * emission. The forward variables are
+// normalized to sum 1 at every frame, and the scale factors give the
+// log-likelihood. The backward variables are normalized the same way
+// (their scale cancels out in the posteriors), so nothing overflows or
+// underflows on sequences of any length. The forward variables are kept
+// for the backward pass and are overwritten by the posteriors, which
+// needs numberOfObservations x 24 doubles.
+class ForwardBackward {
+ public:
+    typedef std::vector<double> ProbabilityVector;
+    ForwardBackward(
+      std::vector<PitchClass> observations,
+      CompiledKeyModel::ConstPointer model);
+    ForwardBackward(
+      std::vector<Key> observations,
+      CompiledKeyModel::ConstPointer model);
+    void run();
+    std::size_t getNumberOfObservations() const;
+    // Key::NUMBER_OF_KEYS values indexed by key
+    ProbabilityVector getPosterior(std::size_t frame) const;
+    // numberOfObservations x Key::NUMBER_OF_KEYS, row-major
+    const std::vector<double> &getPosteriors() const;
+    // Posteriors averaged over every frame
+    ProbabilityVector getAveragePosterior() const;
+    // log10 P(observations)
+    double getLogLikelihood() const;
+    int getStatus() const;
+
+ private:
+    int m_status;
+    std::vector<int> m_observations;
+    CompiledKeyModel::ConstPointer m_model;
+    // Linear-domain start vectors and step matrices, per symbol
+    AlignedDoubleVector m_start;
+    AlignedDoubleVector m_step;
+    std::vector<double> m_posteriors;
+    ProbabilityVector m_averagePosterior;
+    double m_logLikelihood;
+    template <typename Symbol>
+    void initObservations(const std::vector<Symbol> &observations);
+};
+
+}  // namespace justkeydding
+
+#endif  // INCLUDE_FORWARDBACKWARD_H_
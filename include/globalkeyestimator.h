@@ -0,0 +1,85 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Global key of a piece from the histogram of its local keys
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef INCLUDE_GLOBALKEYESTIMATOR_H_
+#define INCLUDE_GLOBALKEYESTIMATOR_H_
+
+#include<vector>
+#include<cstddef>
+
+#include "./key.h"
+#include "./keytransition.h"
+#include "./status.h"
+#include "./compiledkeymodel.h"
+
+namespace justkeydding {
+
+// Second stage of the key detector. The global-key model is built with
+// the "zero" key transitions, which only allow staying in the same
+// state, so its Viterbi path is one of the constant paths and the final
+// score of state s is
+//
+//   start[first local key][s] + sum over keys k of count[k] * step[k][s][s]
+//
+// where count is the histogram of the remaining local keys. This is the
+// probability vector of the second HiddenMarkovModel, computed in
+// O(T + states * symbols) instead of O(T * states * states). It is not
+// bit-identical to it: the Viterbi recursion adds the steps one frame at
+// a time, while count * step multiplies them, so the scores differ by
+// rounding (about 1e-9 relative on long sequences). Ties go to the
+// lowest state, and keys whose scores are equal or within that rounding
+// may therefore resolve differently from the Viterbi decoder.
+//
+// Models allowing any transition between different states are not
+// handled, and leave the estimator uninitialized.
+class GlobalKeyEstimator {
+ public:
+    typedef std::vector<std::size_t> KeyHistogram;
+    typedef std::vector<double> ProbabilityVector;
+    explicit GlobalKeyEstimator(CompiledKeyModel::ConstPointer model);
+    // Global-key model over all keys: symmetrical initial probabilities,
+    // the "zero" key transitions, and the given key transitions as the
+    // emissions of the local keys
+    static CompiledKeyModel::ConstPointer compileModel(
+        KeyTransition keyTransition);
+    void estimate(const Key::KeySequence &localKeys);
+    // Histogram of the local keys after the first one
+    void estimate(int firstKey, const KeyHistogram &histogram);
+    Key getGlobalKey() const;
+    ProbabilityVector getProbabilityVector() const;
+    int getStatus() const;
+
+ private:
+    int m_status;
+    CompiledKeyModel::ConstPointer m_model;
+    bool m_stayOnly;
+    int m_globalKey;
+    ProbabilityVector m_probabilityVector;
+};
+
+}  // namespace justkeydding
+
+#endif  // INCLUDE_GLOBALKEYESTIMATOR_H_
@@ -29,41 +29,106 @@ SOFTWARE.
 
 #include<string>
 #include<vector>
+#include<array>
 #include<map>
-#include<unordered_map>
+#include<utility>
 #include<cmath>
 #include<iostream>
 #include<limits>
+#include<algorithm>
+#include<thread>
 
 #include "./pitchclass.h"
 #include "./key.h"
 #include "./keyprofile.h"
 #include "./keytransition.h"
 #include "./status.h"
+#include "./compiledkeymodel.h"
+#include "./maxplus.h"
+#include "./steppowers.h"
+#include "./alignedallocator.h"
 
 namespace justkeydding {
 
+// The model is a shared CompiledKeyModel (log-domain dense matrices).
+// The Viterbi lattice is a pair of flat (T x states) arrays holding
+// the scores and the back-pointers of every time step.
+// runBatchedViterbi() decodes one observation stream under several
+// models at once, keeping only the last layer of each model.
+//
+// VITERBI_CHECKPOINT keeps only every ceil(sqrt(T))-th layer of scores
+// in the forward pass, and recomputes the back-pointers of one segment
+// at a time during the backtrace. Memory is O(sqrt(T) * states) for one
+// extra forward pass, and the result is identical to VITERBI_FULL.
+//
+// VITERBI_PARALLEL splits the observations into one chunk per thread.
+// Every chunk but the first is decoded concurrently from a uniform
+// (all zero) layer, keeping the margin by which every decision beats
+// the runner-up. The chunks are then fixed up in order from the true
+// layer before them. Once a true layer is within d of the speculative
+// one plus a constant (the rank convergence of max-plus products), a
+// decision of the next step that wins by more than 2d, rounding
+// included, is also the true one and only its score is added; the
+// others (ties) are taken again from every candidate, and a layer with
+// too many of them is recomputed whole. Every true layer is thus the
+// one of VITERBI_FULL, and so are the path and the scores.
+//
+// VITERBI_BEAM only visits the active states of every layer. A state
+// is skipped when the emission of the current observation is impossible
+// under it (the zeros of profiles such as "sapp"), and it is dropped
+// when its score falls more than the beam width (log10 units) below the
+// best one. With an infinite beam, the default, only impossible states
+// are skipped and the result is identical to VITERBI_FULL; narrower
+// beams trade exactness for speed. getPruningStatistics() reports how
+// many states were kept.
+//
+// Weighted observations hold one weight per pitch class and frame (e.g.,
+// a chroma vector), instead of one pitch class per observation. Their
+// log emission is the weighted sum of the log profile values, so an
+// integer weight of n is worth n observations of that pitch class
+// within the same frame, and the fractional part is kept. They are
+// always decoded with the full lattice, whatever the Viterbi mode (and
+// without pruning statistics), adding the emission to the max-plus
+// product with the transition matrix. Models whose symbols are not the
+// pitch classes (e.g., the global key model over local keys) reject
+// them with HIDDENMARKOVMODEL_INVALID_OBSERVATIONS.
+//
+// In VITERBI_RUNLENGTH mode, every run of k identical observations is
+// applied as the max-plus power M^k of its step matrix (see StepPowers),
+// and only the back-pointers at the boundaries of the powers are kept.
+// The paths inside a power are expanded during the backtrace. Summing
+// the same terms in a different order may change the last bits of the
+// scores, so exact ties can be broken differently than in VITERBI_FULL.
+// Observations given as runs are decoded from the runs themselves in
+// this mode, and only expanded for the other ones.
 class HiddenMarkovModel {
-  struct ViterbiNode {
-      double probability;
-      int previousState;
-      ViterbiNode(
-        double p = -std::numeric_limits<double>::infinity(),
-        int s = -1) : probability(p), previousState(s) { }
-  };
-
  public:
     typedef std::vector<int> Observations;
     typedef std::vector<int> States;
     typedef std::vector<double> ProbabilityVector;
-    typedef std::unordered_map<int, double> InitialProbabilities;
-    typedef std::unordered_map<int, double> TransitionProbability;
-    typedef std::unordered_map<int, double> EmissionProbability;
-    typedef std::unordered_map<int,
-      TransitionProbability> TransitionProbabilities;
-    typedef std::unordered_map<int,
-      EmissionProbability> EmissionProbabilities;
-    typedef std::unordered_map<int, ViterbiNode> ViterbiLayer;
+    // (symbol, length) pairs
+    typedef std::vector<std::pair<int, std::size_t> > ObservationRuns;
+    typedef std::array<double,
+        PitchClass::NUMBER_OF_PITCHCLASSES> WeightedObservation;
+    typedef std::vector<WeightedObservation> WeightedObservations;
+    struct PruningStatistics {
+        std::size_t numberOfFrames;
+        // States carried over to the next frame, summed over the frames
+        std::size_t numberOfActiveStates;
+        // States skipped because their emission is impossible
+        std::size_t numberOfImpossibleStates;
+        // States dropped because they fell outside of the beam
+        std::size_t numberOfBeamPrunedStates;
+        double averageActiveStates;
+    };
+    enum enViterbiMode {
+        VITERBI_FULL,
+        VITERBI_CHECKPOINT,
+        VITERBI_RUNLENGTH,
+        VITERBI_PARALLEL,
+        VITERBI_BEAM,
+        NUMBER_OF_VITERBIMODES
+    };
     HiddenMarkovModel(
       std::vector<PitchClass> observations,
       Key::KeyVector states,
@@ -76,23 +141,72 @@ class HiddenMarkovModel {
       std::map<Key, double> initialProbabilities,
       std::map<Key, std::map<Key, double> > transitionProbabilities,
       std::map<Key, std::map<Key, double> > emissionProbabilities);
+    HiddenMarkovModel(
+      std::vector<PitchClass> observations,
+      CompiledKeyModel::ConstPointer model);
+    HiddenMarkovModel(
+      std::vector<Key> observations,
+      CompiledKeyModel::ConstPointer model);
+    HiddenMarkovModel(
+      const ObservationRuns &observationRuns,
+      CompiledKeyModel::ConstPointer model);
+    HiddenMarkovModel(
+      const WeightedObservations &weightedObservations,
+      CompiledKeyModel::ConstPointer model);
+    void setViterbiMode(enViterbiMode viterbiMode);
+    // Threads used by VITERBI_PARALLEL, all the cores by default
+    void setNumberOfThreads(int numberOfThreads);
+    // Beam of VITERBI_BEAM in log10 units, infinite (exact) by default
+    void setBeamWidth(double beamWidth);
+    PruningStatistics getPruningStatistics() const;
     void printOutput();
     void runViterbi();
     Key::KeySequence getKeySequence();
     double getMaximumProbability() const;
     ProbabilityVector getProbabilityVector() const;
     int getStatus() const;
+    static std::vector<ProbabilityVector> runBatchedViterbi(
+      const std::vector<PitchClass> &observations,
+      const std::vector<CompiledKeyModel::ConstPointer> &models);
+    static std::vector<ProbabilityVector> runBatchedViterbi(
+      const std::vector<Key> &observations,
+      const std::vector<CompiledKeyModel::ConstPointer> &models);
 
  private:
+    // Observations processed by every model before moving on
+    static const std::size_t OBSERVATION_BLOCK = 256;
+    // Shortest chunk worth a thread in VITERBI_PARALLEL
+    static const std::size_t MINIMUM_CHUNK = 1024;
     int m_status;
+    enViterbiMode m_viterbiMode;
+    int m_numberOfThreads;
+    double m_beamWidth;
+    PruningStatistics m_pruningStatistics;
     Observations m_observations;
-    States m_states;
-    InitialProbabilities m_initialProbabilities;
-    TransitionProbabilities m_transitionProbabilities;
-    EmissionProbabilities m_emissionProbabilities;
+    // Observations given as runs, until a mode other than
+    // VITERBI_RUNLENGTH expands them into m_observations
+    ObservationRuns m_observationRuns;
+    WeightedObservations m_weightedObservations;
+    CompiledKeyModel::ConstPointer m_model;
     double m_maximumProbability;
     ProbabilityVector m_probabilityVector;
     Key::KeySequence m_keySequence;
+    template <typename Symbol>
+    void initObservations(const std::vector<Symbol> &observations);
+    template <typename Symbol>
+    static Observations toObservations(const std::vector<Symbol> &symbols);
+    ObservationRuns getObservationRuns() const;
+    void expandObservationRuns();
+    bool decodeFull(States *states);
+    bool decodeCheckpoint(States *states);
+    bool decodeRunLength(States *states);
+    bool decodeParallel(States *states);
+    bool decodeBeam(States *states);
+    bool decodeWeighted(States *states);
+    int selectLastState(const double *lastLayer);
+    static std::vector<ProbabilityVector> decodeBatch(
+      const Observations &observations,
+      const std::vector<CompiledKeyModel::ConstPointer> &models);
 };
 
 
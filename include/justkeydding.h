@@ -33,13 +33,23 @@ SOFTWARE.
 #include<vector>
 #include<string>
 #include<array>
+#include<memory>
+#include<algorithm>
 
 #include "./pitchclass.h"
 #include "./key.h"
 #include "./keyprofile.h"
 #include "./keytransition.h"
 #include "./chromagram.h"
+#include "./chromagrambuffer.h"
+#include "./audiochromastream.h"
+#include "./compiledkeymodel.h"
 #include "./hiddenmarkovmodel.h"
+#include "./globalkeyestimator.h"
+#include "./forwardbackward.h"
+#include "./streamingviterbidecoder.h"
+#include "./modelbundle.h"
+#include "./ensemble.h"
 #include "./status.h"
 #include "optparse/optparse.h"
 #include "./midi.h"
@@ -51,7 +61,8 @@ namespace justkeydding {
 enum enInputType {
     INPUT_CSV,
     INPUT_WAV,
-    INPUT_MIDI
+    INPUT_MIDI,
+    INPUT_CHROMA
 };
 
 } // namespace justkeydding
@@ -36,6 +36,9 @@ SOFTWARE.
 
 namespace justkeydding {
 
+// A key is a one-byte, trivially copyable value, like PitchClass. Names
+// are read with the parser of PitchClass: an uppercase letter is a major
+// key and a lowercase one a minor key.
 class Key {
  public:
     typedef std::vector<Key> KeyVector;
@@ -50,7 +53,6 @@ class Key {
     bool operator==(const Key &key) const;
     bool operator!=(const Key &key) const;
     bool operator<(const Key &key) const;
-    Key& operator=(const Key &key);
     Key getRelativeKey() const;
     Key getDominantKey() const;
     Key getSubDominantKey() const;
@@ -89,16 +91,14 @@ class Key {
     };
 
  private:
-    int m_key;
-    std::string m_keyString;
-    std::map<std::string, int> m_stringToIntMap;
-    const std::string m_allKeyStrings[NUMBER_OF_KEYS] = {
+    // NUMBER_OF_KEYS when constructed from an invalid value
+    unsigned char m_key;
+    static constexpr const char *KEY_NAMES[NUMBER_OF_KEYS] = {
         "C", "Db", "D", "Eb", "E", "F",
         "F#", "G", "Ab", "A", "Bb", "B",
         "c", "c#", "d", "eb", "e", "f",
         "f#", "g", "ab", "a", "bb", "b"
     };
-    void initStringToIntMap();
 };
 
 }  // namespace justkeydding
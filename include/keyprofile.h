@@ -37,10 +37,19 @@ SOFTWARE.
 
 namespace justkeydding {
 
+// The built-in profiles are static tables. The 24 rotated profiles are
+// computed once, in the constructor, into a dense matrix with one row
+// of 12 pitch classes per key. The nested map is built from that matrix
+// for the callers that still use it.
 class KeyProfile {
  public:
     typedef std::array<double,
         PitchClass::NUMBER_OF_PITCHCLASSES> KeyProfileArray;
+    // Key::NUMBER_OF_KEYS x PitchClass::NUMBER_OF_PITCHCLASSES,
+    // row-major [key][pitchClass]
+    typedef std::array<double,
+        Key::NUMBER_OF_KEYS *
+        PitchClass::NUMBER_OF_PITCHCLASSES> KeyProfileMatrix;
     typedef std::map<Key, std::map<PitchClass, double> > KeyProfileMap;
     KeyProfile();
     explicit KeyProfile(std::string keyProfile);
@@ -56,14 +65,18 @@ class KeyProfile {
     std::string whichMinorKeyProfile();
     KeyProfileArray getMajorKeyProfile();
     KeyProfileArray getMinorKeyProfile();
+    const KeyProfileMatrix &getKeyProfileMatrix() const;
     KeyProfileMap getKeyProfileMap();
 
- private:    
+ private:
     std::string m_majorKeyProfile;
     std::string m_minorKeyProfile;
-    std::map<std::string, KeyProfileArray> m_majorKeyProfiles;
-    std::map<std::string, KeyProfileArray> m_minorKeyProfiles;
-    void initKeyProfileArrays();
+    bool m_hasMajorCustomKeyProfile;
+    bool m_hasMinorCustomKeyProfile;
+    KeyProfileArray m_majorKeyProfileArray;
+    KeyProfileArray m_minorKeyProfileArray;
+    KeyProfileMatrix m_keyProfileMatrix;
+    void initKeyProfileMatrix();
 };
 
 }  // namespace justkeydding
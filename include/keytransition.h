@@ -37,9 +37,17 @@ SOFTWARE.
 
 namespace justkeydding {
 
+// The built-in transitions are static tables, given from C major to
+// every key. The transitions of the other 23 keys are rotations of that
+// row, computed once, in the constructor, into a dense matrix. The
+// nested map is built from that matrix for the callers that still use
+// it.
 class KeyTransition {
  public:
     typedef std::array<double, Key::NUMBER_OF_KEYS> KeyTransitionArray;
+    // Key::NUMBER_OF_KEYS x Key::NUMBER_OF_KEYS, row-major [from][to]
+    typedef std::array<double,
+        Key::NUMBER_OF_KEYS * Key::NUMBER_OF_KEYS> KeyTransitionMatrix;
     typedef std::map<Key, std::map<Key, double> > KeyTransitionMap;
     KeyTransition();
     explicit KeyTransition(std::string keyTransition);
@@ -48,12 +56,15 @@ class KeyTransition {
     bool isValidKeyTransition(std::string keyTransition);
     std::string whichKeyTransition();
     KeyTransitionArray getKeyTransitionArray();
+    const KeyTransitionMatrix &getKeyTransitionMatrix() const;
     KeyTransitionMap getKeyTransitionMap();
 
  private:
     std::string m_keyTransition;
-    std::map<std::string, KeyTransitionArray> m_keyTransitions;
-    void initKeyTransitionArrays();
+    bool m_hasCustomKeyTransition;
+    KeyTransitionArray m_keyTransitionArray;
+    KeyTransitionMatrix m_keyTransitionMatrix;
+    void initKeyTransitionMatrix();
 };
 
 }  // namespace justkeydding
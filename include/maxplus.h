@@ -0,0 +1,85 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Max-plus matrix-vector kernels for the Viterbi recurrence
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef INCLUDE_MAXPLUS_H_
+#define INCLUDE_MAXPLUS_H_
+
+namespace justkeydding {
+
+// One Viterbi step is a max-plus matrix-vector product:
+//
+//   next[to] = max over from of (current[from] + matrix[from * n + to])
+//
+// together with the arg max (the back-pointer). The SIMD kernels work
+// on groups of "to" lanes and visit the "from" states in increasing
+// order with a strict comparison, exactly like the scalar loop. Max and
+// addition are exact IEEE operations, so every instruction set returns
+// bit-identical scores and back-pointers (ties go to the lowest state,
+// -1 when every candidate is -inf).
+//
+// The instruction set is chosen once at runtime from the CPU features.
+class MaxPlus {
+ public:
+    enum enInstructionSet {
+        INSTRUCTIONSET_SCALAR,
+        INSTRUCTIONSET_SSE2,
+        INSTRUCTIONSET_AVX2,
+        INSTRUCTIONSET_AVX512,
+        NUMBER_OF_INSTRUCTIONSETS
+    };
+    static void step(
+        const double *current,
+        const double *matrix,
+        int numberOfStates,
+        double *next,
+        signed char *backPointers);
+    // Same step, with the margin of every decision: the best candidate
+    // minus the runner-up (0 for a tie, inf without a finite runner-up,
+    // NaN when every candidate is -inf)
+    static void stepWithMargins(
+        const double *current,
+        const double *matrix,
+        int numberOfStates,
+        double *next,
+        signed char *backPointers,
+        double *margins);
+    // Same product without back-pointers
+    static void product(
+        const double *current,
+        const double *matrix,
+        int numberOfStates,
+        double *next);
+    static int getInstructionSet();
+    // Forces an instruction set (e.g., for parity tests). Returns false,
+    // leaving the current one, if the CPU does not support it.
+    static bool setInstructionSet(int instructionSet);
+    static bool isSupported(int instructionSet);
+    static const char *getInstructionSetName(int instructionSet);
+};
+
+}  // namespace justkeydding
+
+#endif  // INCLUDE_MAXPLUS_H_
@@ -0,0 +1,126 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Versioned binary bundle of named key models, memory-mapped on load
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef INCLUDE_MODELBUNDLE_H_
+#define INCLUDE_MODELBUNDLE_H_
+
+#include<string>
+#include<vector>
+#include<memory>
+#include<cstddef>
+#include<cstdint>
+
+#include "./key.h"
+#include "./keyprofile.h"
+#include "./keytransition.h"
+#include "./compiledkeymodel.h"
+#include "./status.h"
+
+namespace justkeydding {
+
+// A bundle holds named key profiles (12 major and 12 minor values),
+// named key transitions (24 values), models (a profile and a transition,
+// together with their precompiled CompiledKeyModel tables) and
+// ensembles (lists of models).
+//
+// The file is mapped read-only and shared, so every process loading the
+// same bundle uses the same physical pages, and the models point into
+// the mapping instead of copying or recompiling their tables. They keep
+// the mapping alive after the ModelBundle is destroyed.
+//
+// Layout, little-endian, every section aligned to 64 bytes:
+//   header      magic "JKDMODEL", version, counts and section offsets
+//   profiles    name[64], double major[12], double minor[12]
+//   transitions name[64], double transition[24]
+//   models      name[64], uint32 profile, uint32 transition,
+//               uint64 offset of the tables
+//   ensembles   name[64], uint32 first member, uint32 members
+//   members     uint32 model
+//   tables      CompiledKeyModel blocks of 24 states and 12 symbols
+class ModelBundle {
+ public:
+    static const std::uint32_t VERSION = 1;
+    // Longest name, without the terminating null character
+    static const std::size_t MAXIMUM_NAME_LENGTH = 63;
+    struct Profile {
+        std::string name;
+        KeyProfile::KeyProfileArray major;
+        KeyProfile::KeyProfileArray minor;
+    };
+    struct Transition {
+        std::string name;
+        KeyTransition::KeyTransitionArray transition;
+    };
+    struct Model {
+        std::string name;
+        std::string profile;
+        std::string transition;
+    };
+    struct Ensemble {
+        std::string name;
+        std::vector<std::string> models;
+    };
+    explicit ModelBundle(const std::string &fileName);
+    int getStatus() const;
+    std::vector<std::string> getModelNames() const;
+    std::vector<std::string> getEnsembleNames() const;
+    // NULL if the bundle has no model with this name
+    CompiledKeyModel::ConstPointer getModel(const std::string &name) const;
+    // Key transitions of a model, for the second stage of the detector
+    bool getKeyTransitionArray(
+        const std::string &name,
+        KeyTransition::KeyTransitionArray *keyTransitionArray) const;
+    // Names of the models of an ensemble, empty if there is none
+    std::vector<std::string> getEnsemble(const std::string &name) const;
+    // Compiles the models and writes the bundle, false on failure
+    static bool write(
+        const std::string &fileName,
+        const std::vector<Profile> &profiles,
+        const std::vector<Transition> &transitions,
+        const std::vector<Model> &models,
+        const std::vector<Ensemble> &ensembles);
+
+ private:
+    struct Header;
+    struct ProfileRecord;
+    struct TransitionRecord;
+    struct ModelRecord;
+    struct EnsembleRecord;
+    int m_status;
+    std::shared_ptr<const void> m_mapping;
+    const Header *m_header;
+    const ProfileRecord *m_profiles;
+    const TransitionRecord *m_transitions;
+    const ModelRecord *m_models;
+    const EnsembleRecord *m_ensembles;
+    const std::uint32_t *m_members;
+    bool validate(std::size_t fileSize);
+    int findModel(const std::string &name) const;
+};
+
+}  // namespace justkeydding
+
+#endif  // INCLUDE_MODELBUNDLE_H_
@@ -36,6 +36,9 @@ SOFTWARE.
 
 namespace justkeydding {
 
+// A pitch class is a one-byte, trivially copyable value. Its names are
+// a static table, so sequences of millions of pitch classes are as
+// cheap as arrays of bytes.
 class PitchClass {
  public:
     typedef std::vector<PitchClass> PitchClassVector;
@@ -45,6 +48,9 @@ class PitchClass {
     int getInt() const;
     std::string getString() const;
     static PitchClassVector getAllPitchClassesVector();
+    // Parses a letter and an optional sharp (#) or flat (b), ignoring
+    // case. Returns the pitch class, or -1 if the name is not valid.
+    static int parse(const std::string &name);
     bool operator==(const PitchClass &pitchClass) const;
     bool operator!=(const PitchClass &pitchClass) const;
     bool operator<(const PitchClass &pitchClass) const;
@@ -65,15 +71,13 @@ class PitchClass {
     };
 
  private:
-    int m_pitchClass;
-    std::string m_pitchClassString;
-    std::map<std::string, int> m_stringToIntMap;
-    const std::string m_allPitchClassStrings[
+    // NUMBER_OF_PITCHCLASSES when constructed from an invalid value
+    unsigned char m_pitchClass;
+    static constexpr const char *PITCHCLASS_NAMES[
         NUMBER_OF_PITCHCLASSES] = {
         "c", "c#", "d", "eb", "e", "f",
         "f#", "g", "ab", "a", "bb", "b"
     };
-    void initStringToIntMap();
 };
 
 }  // namespace justkeydding
@@ -41,7 +41,39 @@ class Status {
     MIDI_UNINITIALIZED,
     MIDI_READY,
     HIDDENMARKOVMODEL_UNINITIALIZED,
-    HIDDENMARKOVMODEL_VITERBI_READY
+    HIDDENMARKOVMODEL_VITERBI_READY,
+    HIDDENMARKOVMODEL_INVALID_OBSERVATIONS,
+    GLOBALKEYESTIMATOR_UNINITIALIZED,
+    GLOBALKEYESTIMATOR_READY,
+    STREAMINGVITERBIDECODER_UNINITIALIZED,
+    STREAMINGVITERBIDECODER_DECODING,
+    STREAMINGVITERBIDECODER_READY,
+    FORWARDBACKWARD_UNINITIALIZED,
+    FORWARDBACKWARD_READY,
+    MODELBUNDLE_UNINITIALIZED,
+    MODELBUNDLE_INPUTFILE_ERROR,
+    MODELBUNDLE_FORMAT_ERROR,
+    MODELBUNDLE_READY,
+    CHROMAGRAMCSVREADER_UNINITIALIZED,
+    CHROMAGRAMCSVREADER_INPUTFILE_ERROR,
+    CHROMAGRAMCSVREADER_FORMAT_ERROR,
+    CHROMAGRAMCSVREADER_READY,
+    CHROMAGRAMCACHE_UNINITIALIZED,
+    CHROMAGRAMCACHE_INPUTFILE_ERROR,
+    CHROMAGRAMCACHE_FORMAT_ERROR,
+    CHROMAGRAMCACHE_READY,
+    FEATURECACHE_UNINITIALIZED,
+    FEATURECACHE_DIRECTORY_ERROR,
+    FEATURECACHE_READY,
+    AUDIOCHROMASTREAM_UNINITIALIZED,
+    AUDIOCHROMASTREAM_INPUTFILE_ERROR,
+    AUDIOCHROMASTREAM_NNLS_ERROR,
+    AUDIOCHROMASTREAM_STREAMING,
+    AUDIOCHROMASTREAM_READY,
+    ENSEMBLE_UNINITIALIZED,
+    ENSEMBLE_MODEL_ERROR,
+    ENSEMBLE_DECODING_ERROR,
+    ENSEMBLE_READY
   };
 };
 
@@ -0,0 +1,64 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Max-plus powers of the per-symbol step matrices
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef INCLUDE_STEPPOWERS_H_
+#define INCLUDE_STEPPOWERS_H_
+
+#include<vector>
+
+#include "./compiledkeymodel.h"
+#include "./alignedallocator.h"
+
+namespace justkeydding {
+
+// Powers M^(2^j) of the step matrix M of one observation symbol, in the
+// max-plus semiring, computed by repeated squaring the first time they
+// are needed. A run of k identical observations is then applied as the
+// product of the powers selected by the bits of k.
+//
+// Every squaring keeps, for each (from, to) pair, the state in the
+// middle of the best path, so the 2^j states crossed by a power can be
+// expanded again on demand. Power 0 is the model's step matrix itself.
+class StepPowers {
+ public:
+    explicit StepPowers(CompiledKeyModel::ConstPointer model);
+    // numberOfStates x numberOfStates, row-major [from][to]
+    const double *getPower(int symbol, int power);
+    // Writes the 2^power states visited by the best path from "from" to
+    // "to" (the latter included, the former not) into states
+    void expandPath(int symbol, int power, int from, int to, int *states);
+
+ private:
+    CompiledKeyModel::ConstPointer m_model;
+    int m_numberOfStates;
+    // [symbol][power - 1]
+    std::vector<std::vector<AlignedDoubleVector> > m_powers;
+    std::vector<std::vector<AlignedStateVector> > m_midStates;
+};
+
+}  // namespace justkeydding
+
+#endif  // INCLUDE_STEPPOWERS_H_
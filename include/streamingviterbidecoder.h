@@ -0,0 +1,106 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Fixed-lag Viterbi decoder for observations arriving incrementally
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef INCLUDE_STREAMINGVITERBIDECODER_H_
+#define INCLUDE_STREAMINGVITERBIDECODER_H_
+
+#include<vector>
+#include<cstddef>
+#include<stdint.h>
+
+#include "./pitchclass.h"
+#include "./key.h"
+#include "./status.h"
+#include "./compiledkeymodel.h"
+#include "./maxplus.h"
+#include "./alignedallocator.h"
+
+namespace justkeydding {
+
+// Viterbi decoder fed one observation at a time. Only the back-pointers
+// of the frames that are not committed yet are kept, in a ring buffer
+// of maximumLag layers.
+//
+// After every observation, the paths of all the surviving states are
+// traced back. Once they meet in a single state, every frame up to that
+// point is committed: no future observation can change it, and the
+// committed keys are those of the offline Viterbi path. If the oldest
+// uncommitted frame reaches maximumLag, it is committed following the
+// currently best state (a forced commit), and the states whose paths
+// disagree with it are discarded, so the output is always a valid path.
+// finish() commits the remaining frames from the best final state.
+//
+// Lags are measured in observations: the lag of a frame is the number
+// of observations received after it, at the time it was committed.
+class StreamingViterbiDecoder {
+ public:
+    struct LatencyStatistics {
+        std::size_t numberOfCommits;
+        std::size_t numberOfForcedCommits;
+        std::size_t numberOfCommittedFrames;
+        std::size_t maximumLag;
+        double meanLag;
+        // Number of frames committed with each lag, 0 to maximumLag
+        std::vector<std::size_t> lagHistogram;
+    };
+    StreamingViterbiDecoder(
+      CompiledKeyModel::ConstPointer model,
+      std::size_t maximumLag);
+    void addObservation(const PitchClass &observation);
+    void addObservation(const Key &observation);
+    void finish();
+    // Keys committed since the last call
+    Key::KeySequence takeCommittedKeys();
+    std::size_t getNumberOfObservations() const;
+    std::size_t getNumberOfCommittedFrames() const;
+    LatencyStatistics getLatencyStatistics() const;
+    int getStatus() const;
+
+ private:
+    int m_status;
+    CompiledKeyModel::ConstPointer m_model;
+    int m_numberOfStates;
+    std::size_t m_maximumLag;
+    std::size_t m_numberOfObservations;
+    std::size_t m_numberOfCommittedFrames;
+    AlignedDoubleVector m_scores;
+    AlignedDoubleVector m_nextScores;
+    // Ring buffer, the back-pointers of frame t are in layer t % maximumLag
+    AlignedStateVector m_backPointers;
+    Key::KeySequence m_committedKeys;
+    std::vector<int> m_path;
+    LatencyStatistics m_latencyStatistics;
+    void addSymbol(int symbol);
+    int getPredecessor(std::size_t frame, int state) const;
+    int getBestState() const;
+    void commitConverged();
+    void commitOldest();
+    void commit(std::size_t lastFrame, int lastState, bool forced);
+};
+
+}  // namespace justkeydding
+
+#endif  // INCLUDE_STREAMINGVITERBIDECODER_H_
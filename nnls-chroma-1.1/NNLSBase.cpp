@@ -441,8 +441,13 @@ NNLSBase::reset()
 void
 NNLSBase::baseProcess(const float *const *inputBuffers, Vamp::RealTime timestamp)
 {   
-    m_frameCount++;   
-    float *magnitude = new float[m_blockSize/2];
+    appendLogSpectrum(getLogFrequencySpectrum(inputBuffers, timestamp));
+}
+
+NNLSBase::Feature
+NNLSBase::getLogFrequencySpectrum(const float *const *inputBuffers, Vamp::RealTime timestamp) const
+{   
+    vector<float> magnitude(m_blockSize/2);
 	
     const float *fbuf = inputBuffers[0];	
     float energysum = 0;
@@ -475,20 +480,21 @@ NNLSBase::baseProcess(const float *const *inputBuffers, Vamp::RealTime timestamp
     }
 		
     // note magnitude mapping using pre-calculated matrix
-    float *nm  = new float[nNote]; // note magnitude
-    for (int iNote = 0; iNote < nNote; iNote++) {
-        nm[iNote] = 0; // initialise as 0
-    }
-    int binCount = 0;
-    for (vector<float>::iterator it = m_kernelValue.begin(); it != m_kernelValue.end(); ++it) {
-        // cerr << ".";
-        nm[m_kernelNoteIndex[binCount]] += magnitude[m_kernelFftIndex[binCount]] * m_kernelValue[binCount];
-        // cerr << m_kernelFftIndex[binCount] << " -- " << magnitude[m_kernelFftIndex[binCount]] << " -- "<< m_kernelValue[binCount] << endl;
-        binCount++;	
+    Feature f1; // logfreqspec
+    f1.hasTimestamp = true;
+    f1.timestamp = timestamp;
+    f1.values.assign(nNote, 0); // note magnitude, initialise as 0
+    for (int binCount = 0; binCount < (int)m_kernelValue.size(); binCount++) {
+        f1.values[m_kernelNoteIndex[binCount]] += magnitude[m_kernelFftIndex[binCount]] * m_kernelValue[binCount];
     }
-    // cerr << nm[20];
-    // cerr << endl;
-	
+    return f1;
+}
+
+void
+NNLSBase::appendLogSpectrum(const Feature &f1)
+{
+    m_frameCount++;   
+    const vector<float> &nm = f1.values; // note magnitude
 	
     float one_over_N = 1.0/m_frameCount;
     // update means of complex tuning variables
@@ -517,17 +523,5 @@ NNLSBase::baseProcess(const float *const *inputBuffers, Vamp::RealTime timestamp
     float normalisedtuning = atan2(localTuningImag, localTuningReal)/(2*M_PI);
     m_localTuning.push_back(normalisedtuning);
     
-    Feature f1; // logfreqspec
-    f1.hasTimestamp = true;
-    f1.timestamp = timestamp;
-    for (int iNote = 0; iNote < nNote; iNote++) {
-        f1.values.push_back(nm[iNote]);
-    }
-
-    // deletes
-    delete[] magnitude;
-    delete[] nm;
-
     m_logSpectrum.push_back(f1); // remember note magnitude
 }
-
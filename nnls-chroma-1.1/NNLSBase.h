@@ -50,10 +50,19 @@ public:
     bool initialise(size_t channels, size_t stepSize, size_t blockSize);
     void reset();
 
+    // Log-frequency spectrum of one frame of frequency-domain input. It
+    // depends on nothing but the frame, so front ends on other threads
+    // can compute it for this instance.
+    Feature getLogFrequencySpectrum(const float *const *inputBuffers,
+                                    Vamp::RealTime timestamp) const;
+
 protected:
     NNLSBase(float inputSampleRate);
     void baseProcess(const float *const *inputBuffers,
                      Vamp::RealTime timestamp);
+    // Updates the running tuning estimates with the next frame, in
+    // order, and keeps it in m_logSpectrum
+    void appendLogSpectrum(const Feature &f1);
 
     int m_frameCount;
     FeatureList m_logSpectrum;
@@ -19,17 +19,27 @@
 #include "NNLSChroma.h"
 
 #include "chromamethods.h"
+#include "fnnls.h"
 
 #include <cstdlib>
 #include <fstream>
 #include <cmath>
 
 #include <algorithm>
+#include <thread>
 
 const bool debug_on = false;
 
 NNLSChroma::NNLSChroma(float inputSampleRate) :
-    NNLSBase(inputSampleRate)
+    NNLSBase(inputSampleRate),
+    m_estimatedTuning(440),
+    m_normalisedTuning(0),
+    m_streamingWarmUp(0),
+    m_tuningFixed(false),
+    m_numberOfThreads(0),
+    m_logSpectrumOnly(false),
+    m_nnlsSolver(LawsonHansonSolver),
+    m_solvedFrames(0)
 {
     if (debug_on) cerr << "--> NNLSChroma" << endl;
 }
@@ -194,6 +204,18 @@ NNLSChroma::initialise(size_t channels, size_t stepSize, size_t blockSize)
         return false;
     }
 
+    m_dictGram.assign(84 * 84, 0);
+    for (int iNote = 0; iNote < 84; ++iNote) {
+        for (int jNote = 0; jNote <= iNote; ++jNote) {
+            double sum = 0;
+            for (int iBin = 0; iBin < nNote; ++iBin) {
+                sum += (double)m_dict[iNote * nNote + iBin] * m_dict[jNote * nNote + iBin];
+            }
+            m_dictGram[iNote + jNote * 84] = sum;
+            m_dictGram[jNote + iNote * 84] = sum;
+        }
+    }
+
     return true;
 }
 
@@ -202,6 +224,18 @@ NNLSChroma::reset()
 {
     if (debug_on) cerr << "--> reset";
     NNLSBase::reset();
+    m_estimatedTuning = 440;
+    m_normalisedTuning = 0;
+    m_tuningFixed = false;
+    m_nnlsStatistics = NNLSStatistics();
+    m_solvedFrames = 0;
+    m_activeNotes.clear();
+}
+
+float
+NNLSChroma::getEstimatedTuning() const
+{
+    return m_estimatedTuning;
 }
 
 NNLSChroma::FeatureSet
@@ -209,10 +243,30 @@ NNLSChroma::process(const float *const *inputBuffers, Vamp::RealTime timestamp)
 {   
     if (debug_on) cerr << "--> process" << endl;
 
-    NNLSBase::baseProcess(inputBuffers, timestamp);
-	
+    return processLogFrequencySpectrum(getLogFrequencySpectrum(inputBuffers, timestamp));
+}
+
+NNLSChroma::FeatureSet
+NNLSChroma::processLogFrequencySpectrum(const Feature &f1)
+{
     FeatureSet fs;
-    fs[m_outputLogfreqspec].push_back(m_logSpectrum[m_logSpectrum.size()-1]);
+    fs[m_outputLogfreqspec].push_back(f1);
+    if (m_logSpectrumOnly) return fs;
+
+    appendLogSpectrum(f1);
+
+    if (m_streamingWarmUp > 0) {
+        // Local tuning only looks back, global tuning is fixed once the
+        // warm-up window is full
+        if (!m_tuningFixed &&
+            (m_tuneLocal || m_logSpectrum.size() >= m_streamingWarmUp)) {
+            estimateTuning();
+            m_tuningFixed = true;
+        }
+        if (m_tuningFixed) {
+            processLogSpectrum(fs);
+        }
+    }
     return fs;	
 }
 
@@ -222,8 +276,72 @@ NNLSChroma::getRemainingFeatures()
     
 	if (debug_on) cerr << "--> getRemainingFeatures" << endl;
     FeatureSet fsOut;
-    if (m_logSpectrum.size() == 0) return fsOut;
+    if (m_logSpectrum.size() == 0 && !m_tuningFixed) return fsOut;
+
+    // In streaming mode, the tuning used by the frames already out
+    // stays, unless it was only ever local
+    if (!m_tuningFixed || m_tuneLocal) {
+        estimateTuning();
+    }
+    processLogSpectrum(fsOut);
+    return fsOut;     
+}
+
+void
+NNLSChroma::setStreamingWarmUp(size_t warmUpFrames)
+{
+    m_streamingWarmUp = warmUpFrames;
+}
+
+void
+NNLSChroma::setLogSpectrumOnly(bool logSpectrumOnly)
+{
+    m_logSpectrumOnly = logSpectrumOnly;
+}
+
+void
+NNLSChroma::setNumberOfThreads(int numberOfThreads)
+{
+    m_numberOfThreads = numberOfThreads;
+}
+
+void
+NNLSChroma::setNNLSSolver(int solver)
+{
+    m_nnlsSolver = solver;
+}
 
+NNLSChroma::NNLSStatistics
+NNLSChroma::getNNLSStatistics() const
+{
+    return m_nnlsStatistics;
+}
+
+NNLSChroma::NNLSStatistics::NNLSStatistics() :
+    solves(0),
+    warmStarts(0),
+    warmStartHits(0),
+    iterations(0),
+    seededColumnsKept(0),
+    unconverged(0)
+{
+}
+
+NNLSChroma::NNLSStatistics &
+NNLSChroma::NNLSStatistics::operator+=(const NNLSStatistics &other)
+{
+    solves += other.solves;
+    warmStarts += other.warmStarts;
+    warmStartHits += other.warmStartHits;
+    iterations += other.iterations;
+    seededColumnsKept += other.seededColumnsKept;
+    unconverged += other.unconverged;
+    return *this;
+}
+
+void
+NNLSChroma::estimateTuning()
+{
     /**  Calculate Tuning
          calculate tuning from (using the angle of the complex number defined by the 
          cumulative mean real and imag values)
@@ -235,69 +353,142 @@ NNLSChroma::getRemainingFeatures()
         meanTuningImag += m_meanTunings[iBPS] * sinvalues[iBPS];
     }
     float cumulativetuning = 440 * pow(2,atan2(meanTuningImag, meanTuningReal)/(24*M_PI));
-    float normalisedtuning = atan2(meanTuningImag, meanTuningReal)/(2*M_PI);
+    m_estimatedTuning = cumulativetuning;
+    m_normalisedTuning = atan2(meanTuningImag, meanTuningReal)/(2*M_PI);
+    if (debug_on) cerr << "estimated tuning: " << cumulativetuning << " Hz" << endl;
+}
+
+void
+NNLSChroma::processLogSpectrum(FeatureSet &fsOut)
+{
+    if (debug_on) cerr << "[NNLS Chroma Plugin] Tuning, whitening and mapping to chroma ... ";
+    // Once the tuning is known the frames are independent: each thread
+    // takes a run of them, and writes to its place in the output lists
+    int numberOfFrames = m_logSpectrum.size();
+    FeatureList *outputs[] = {
+        &fsOut[m_outputTunedlogfreqspec],
+        &fsOut[m_outputSemitonespectrum],
+        &fsOut[m_outputChroma],
+        &fsOut[m_outputBasschroma],
+        &fsOut[m_outputBothchroma]
+    };
+    size_t first = outputs[0]->size();
+    for (int i = 0; i < 5; ++i) {
+        outputs[i]->resize(first + numberOfFrames);
+    }
+    int numberOfThreads = m_numberOfThreads;
+    if (numberOfThreads <= 0) {
+        numberOfThreads = max(int(std::thread::hardware_concurrency()), 1);
+    }
+    numberOfThreads = max(min(numberOfThreads, numberOfFrames / minimumFramesPerThread), 1);
+    // A warm start chain is not split between threads: runs start at
+    // the first frame, or where a chain does
+    vector<int> runBegin;
+    for (int iThread = 0; iThread < numberOfThreads; ++iThread) {
+        int begin = (long long)numberOfFrames * iThread / numberOfThreads;
+        if (m_nnlsSolver == WarmStartSolver && begin > 0) {
+            size_t solved = m_solvedFrames + begin + warmStartSpan - 1;
+            begin = solved - solved % warmStartSpan - m_solvedFrames;
+        }
+        if (begin < numberOfFrames && (runBegin.empty() || begin > runBegin.back())) {
+            runBegin.push_back(begin);
+        }
+    }
+    runBegin.push_back(numberOfFrames);
+    int numberOfRuns = runBegin.size() - 1;
+    vector<vector<int> > activeNotes(max(numberOfRuns, 1));
+    vector<NNLSStatistics> statistics(max(numberOfRuns, 1));
+    activeNotes[0] = m_activeNotes;
+    std::vector<std::thread> threads;
+    for (int iRun = 0; iRun < numberOfRuns; ++iRun) {
+        if (numberOfRuns == 1) {
+            processFrames(runBegin[iRun], runBegin[iRun + 1], first, outputs,
+                          &activeNotes[iRun], &statistics[iRun]);
+            break;
+        }
+        threads.push_back(std::thread(&NNLSChroma::processFrames, this,
+                                      runBegin[iRun], runBegin[iRun + 1], first, outputs,
+                                      &activeNotes[iRun], &statistics[iRun]));
+    }
+    for (int iThread = 0; iThread < (int)threads.size(); ++iThread) {
+        threads[iThread].join();
+    }
+    for (int iRun = 0; iRun < numberOfRuns; ++iRun) {
+        m_nnlsStatistics += statistics[iRun];
+    }
+    if (numberOfRuns > 0) {
+        m_activeNotes = activeNotes[numberOfRuns - 1];
+    }
+    m_solvedFrames += numberOfFrames;
+    // Only the frames still to come are kept
+    m_logSpectrum.clear();
+    m_localTuning.clear();
+    if (debug_on) cerr << "done." << endl;
+}
+
+void
+NNLSChroma::processFrames(int begin, int end, size_t first, FeatureList *outputs[],
+                          vector<int> *activeNotes, NNLSStatistics *statistics)
+{
+    for (int count = begin; count < end; ++count) {
+        if ((m_solvedFrames + count) % warmStartSpan == 0) {
+            activeNotes->clear();
+        }
+        processFrame(m_logSpectrum[count],
+                     m_tuneLocal ? m_localTuning[count] : m_normalisedTuning,
+                     (*outputs[0])[first + count],
+                     (*outputs[1])[first + count],
+                     (*outputs[2])[first + count],
+                     (*outputs[3])[first + count],
+                     (*outputs[4])[first + count],
+                     *activeNotes, *statistics);
+    }
+}
+
+void
+NNLSChroma::processFrame(const Feature &f1, float normalisedtuning,
+                         Feature &f2, Feature &f3, Feature &f4, Feature &f5, Feature &f6,
+                         vector<int> &activeNotes, NNLSStatistics &statistics)
+{
     int intShift = floor(normalisedtuning * 3);
     float floatShift = normalisedtuning * 3 - intShift; // floatShift is a really bad name for this
 		    
-    char buffer0 [50];
-		
-    sprintf(buffer0, "estimated tuning: %0.1f Hz", cumulativetuning);
-		    		    
     /** Tune Log-Frequency Spectrogram
         calculate a tuned log-frequency spectrogram (f2): use the tuning estimated above (kinda f0) to 
         perform linear interpolation on the existing log-frequency spectrogram (kinda f1).
     **/
-    if (debug_on) cerr << endl << "[NNLS Chroma Plugin] Tuning Log-Frequency Spectrogram ... ";
-					
     float tempValue = 0;
 
-    int count = 0;
-
-		
-    for (FeatureList::iterator i = m_logSpectrum.begin(); i != m_logSpectrum.end(); ++i) {
-        Feature f1 = *i;
-        Feature f2; // tuned log-frequency spectrum
-        f2.hasTimestamp = true;
-        f2.timestamp = f1.timestamp;
-        f2.values.push_back(0.0); f2.values.push_back(0.0); // set lower edge to zero
-		
-		
-        if (m_tuneLocal) {
-            intShift = floor(m_localTuning[count] * 3);
-            floatShift = m_localTuning[count] * 3 - intShift; // floatShift is a really bad name for this
-        }
+    // f2: tuned log-frequency spectrum
+    f2.hasTimestamp = true;
+    f2.timestamp = f1.timestamp;
+    f2.values.push_back(0.0); f2.values.push_back(0.0); // set lower edge to zero
 		        
-        // cerr << intShift << " " << floatShift << endl;
-		        
-        for (int k = 2; k < (int)f1.values.size() - 3; ++k) { // interpolate all inner bins
-            tempValue = f1.values[k + intShift] * (1-floatShift) + f1.values[k+intShift+1] * floatShift;
-            f2.values.push_back(tempValue);
-        }
+    for (int k = 2; k < (int)f1.values.size() - 3; ++k) { // interpolate all inner bins
+        tempValue = f1.values[k + intShift] * (1-floatShift) + f1.values[k+intShift+1] * floatShift;
+        f2.values.push_back(tempValue);
+    }
 		        
-        f2.values.push_back(0.0); f2.values.push_back(0.0); f2.values.push_back(0.0); // upper edge
+    f2.values.push_back(0.0); f2.values.push_back(0.0); f2.values.push_back(0.0); // upper edge
 
-        vector<float> runningmean = SpecialConvolution(f2.values,hw);
-        vector<float> runningstd;
-        for (int i = 0; i < nNote; i++) { // first step: squared values into vector (variance)
-            runningstd.push_back((f2.values[i] - runningmean[i]) * (f2.values[i] - runningmean[i]));
+    vector<float> runningmean = SpecialConvolution(f2.values,hw);
+    vector<float> runningstd;
+    for (int i = 0; i < nNote; i++) { // first step: squared values into vector (variance)
+        runningstd.push_back((f2.values[i] - runningmean[i]) * (f2.values[i] - runningmean[i]));
+    }
+    runningstd = SpecialConvolution(runningstd,hw); // second step convolve
+    for (int i = 0; i < nNote; i++) { 
+        runningstd[i] = sqrt(runningstd[i]); // square root to finally have running std
+        if (runningstd[i] > 0) {
+            // f2.values[i] = (f2.values[i] / runningmean[i]) > thresh ? 
+            // 		                    (f2.values[i] - runningmean[i]) / pow(runningstd[i],m_whitening) : 0;
+            f2.values[i] = (f2.values[i] - runningmean[i]) > 0 ?
+                (f2.values[i] - runningmean[i]) / pow(runningstd[i],m_whitening) : 0;
         }
-        runningstd = SpecialConvolution(runningstd,hw); // second step convolve
-        for (int i = 0; i < nNote; i++) { 
-            runningstd[i] = sqrt(runningstd[i]); // square root to finally have running std
-            if (runningstd[i] > 0) {
-                // f2.values[i] = (f2.values[i] / runningmean[i]) > thresh ? 
-                // 		                    (f2.values[i] - runningmean[i]) / pow(runningstd[i],m_whitening) : 0;
-                f2.values[i] = (f2.values[i] - runningmean[i]) > 0 ?
-                    (f2.values[i] - runningmean[i]) / pow(runningstd[i],m_whitening) : 0;
-            }
-            if (f2.values[i] < 0) {
-                cerr << "ERROR: negative value in logfreq spectrum" << endl;
-            }
+        if (f2.values[i] < 0) {
+            cerr << "ERROR: negative value in logfreq spectrum" << endl;
         }
-        fsOut[m_outputTunedlogfreqspec].push_back(f2);
-        count++;
     }
-    if (debug_on) cerr << "done." << endl;
 	    
     /** Semitone spectrum and chromagrams
         Semitone-spaced log-frequency spectrum derived from the tuned log-freq spectrum above. the spectrum
@@ -305,89 +496,110 @@ NNLSChroma::getRemainingFeatures()
         Three different kinds of chromagram are calculated, "treble", "bass", and "both" (which means 
         bass and treble stacked onto each other).
     **/
-    if (m_useNNLS == 0) {
-        if (debug_on) cerr << "[NNLS Chroma Plugin] Mapping to semitone spectrum and chroma ... ";
-    } else {
-        if (debug_on) cerr << "[NNLS Chroma Plugin] Performing NNLS and mapping to chroma ... ";
-    }
-
-	    
-    vector<float> oldchroma = vector<float>(12,0);
-    vector<float> oldbasschroma = vector<float>(12,0);
-    count = 0;
-
-    for (FeatureList::iterator it = fsOut[m_outputTunedlogfreqspec].begin(); it != fsOut[m_outputTunedlogfreqspec].end(); ++it) {
-        Feature f2 = *it; // logfreq spectrum
-        Feature f3; // semitone spectrum
-        Feature f4; // treble chromagram
-        Feature f5; // bass chromagram
-        Feature f6; // treble and bass chromagram
+    // f3: semitone spectrum
+    // f4: treble chromagram
+    // f5: bass chromagram
+    // f6: treble and bass chromagram
 	    
-        f3.hasTimestamp = true;
-        f3.timestamp = f2.timestamp;
+    f3.hasTimestamp = true;
+    f3.timestamp = f2.timestamp;
 	        
-        f4.hasTimestamp = true;
-        f4.timestamp = f2.timestamp;
+    f4.hasTimestamp = true;
+    f4.timestamp = f2.timestamp;
 	        
-        f5.hasTimestamp = true;
-        f5.timestamp = f2.timestamp;
+    f5.hasTimestamp = true;
+    f5.timestamp = f2.timestamp;
 	        
-        f6.hasTimestamp = true;
-        f6.timestamp = f2.timestamp;
+    f6.hasTimestamp = true;
+    f6.timestamp = f2.timestamp;
 	        
-        float b[nNote];
+    float b[nNote];
 	
-        bool some_b_greater_zero = false;
-        float sumb = 0;
-        for (int i = 0; i < nNote; i++) {
-            // b[i] = m_dict[(nNote * count + i) % (nNote * 84)];
-            b[i] = f2.values[i];
-            sumb += b[i];
-            if (b[i] > 0) {
-                some_b_greater_zero = true;
-            }            
-        }
+    bool some_b_greater_zero = false;
+    float sumb = 0;
+    for (int i = 0; i < nNote; i++) {
+        // b[i] = m_dict[(nNote * count + i) % (nNote * 84)];
+        b[i] = f2.values[i];
+        sumb += b[i];
+        if (b[i] > 0) {
+            some_b_greater_zero = true;
+        }            
+    }
 	    
-        // here's where the non-negative least squares algorithm calculates the note activation x
+    // here's where the non-negative least squares algorithm calculates the note activation x
 	
-        vector<float> chroma = vector<float>(12, 0);
-        vector<float> basschroma = vector<float>(12, 0);
-        float currval;
-        int iSemitone = 0;
+    vector<float> chroma = vector<float>(12, 0);
+    vector<float> basschroma = vector<float>(12, 0);
+    float currval;
+    int iSemitone = 0;
 			
-        if (some_b_greater_zero) {
-            if (m_useNNLS == 0) {
-                for (int iNote = nBPS/2 + 2; iNote < nNote - nBPS/2; iNote += nBPS) {
-                    currval = 0;
-                    for (int iBPS = -nBPS/2; iBPS < nBPS/2+1; ++iBPS) {
-                        currval += b[iNote + iBPS] * (1-abs(iBPS*1.0/(nBPS/2+1)));						
-                    }
-                    f3.values.push_back(currval);
-                    chroma[iSemitone % 12] += currval * treblewindow[iSemitone];
-                    basschroma[iSemitone % 12] += currval * basswindow[iSemitone];
-                    iSemitone++;
+    if (some_b_greater_zero) {
+        if (m_useNNLS == 0) {
+            for (int iNote = nBPS/2 + 2; iNote < nNote - nBPS/2; iNote += nBPS) {
+                currval = 0;
+                for (int iBPS = -nBPS/2; iBPS < nBPS/2+1; ++iBPS) {
+                    currval += b[iNote + iBPS] * (1-abs(iBPS*1.0/(nBPS/2+1)));						
                 }
+                f3.values.push_back(currval);
+                chroma[iSemitone % 12] += currval * treblewindow[iSemitone];
+                basschroma[iSemitone % 12] += currval * basswindow[iSemitone];
+                iSemitone++;
+            }
 		        
-            } else {
-                float x[84+1000];
-                for (int i = 1; i < 1084; ++i) x[i] = 1.0;
-                vector<int> signifIndex;
-                int index=0;
-                sumb /= 84.0;
-                for (int iNote = nBPS/2 + 2; iNote < nNote - nBPS/2; iNote += nBPS) {
-                    float currval = 0;
-                    for (int iBPS = -nBPS/2; iBPS < nBPS/2+1; ++iBPS) {
-                        currval += b[iNote + iBPS]; 
+        } else {
+            float x[84+1000];
+            for (int i = 1; i < 1084; ++i) x[i] = 1.0;
+            vector<int> signifIndex;
+            int index=0;
+            sumb /= 84.0;
+            for (int iNote = nBPS/2 + 2; iNote < nNote - nBPS/2; iNote += nBPS) {
+                float currval = 0;
+                for (int iBPS = -nBPS/2; iBPS < nBPS/2+1; ++iBPS) {
+                    currval += b[iNote + iBPS]; 
+                }
+                if (currval > 0) signifIndex.push_back(index);
+                f3.values.push_back(0); // fill the values, change later
+                index++;
+            }
+            float rnorm;
+            float w[84+1000];
+            float zz[84+1000];
+            int indx[84+1000];
+            int mode;
+            int iterations;
+            if (m_nnlsSolver == GramActiveSetSolver) {
+                // normal equations of the significant notes. Frames are
+                // solved one at a time: their sets of significant notes
+                // (and of active ones) almost never repeat, so a batch of
+                // frames would have no Gram block or factor to share.
+                int n = signifIndex.size();
+                double ata[84 * 84], atb[84], xd[84];
+                double work[84 * 84 + 2 * 84];
+                int fnnlsIndex[2 * 84];
+                for (int iNote = 0; iNote < n; ++iNote) {
+                    const float *column = m_dict + signifIndex[iNote] * nNote;
+                    // four running sums, which can be vectorised
+                    double sum[4] = { 0, 0, 0, 0 };
+                    int iBin = 0;
+                    for (; iBin + 4 <= nNote; iBin += 4) {
+                        for (int k = 0; k < 4; ++k) {
+                            sum[k] += (double)column[iBin + k] * b[iBin + k];
+                        }
+                    }
+                    for (; iBin < nNote; ++iBin) {
+                        sum[0] += (double)column[iBin] * b[iBin];
+                    }
+                    atb[iNote] = (sum[0] + sum[1]) + (sum[2] + sum[3]);
+                    for (int jNote = 0; jNote < n; ++jNote) {
+                        ata[jNote + iNote * n] = m_dictGram[signifIndex[jNote] + signifIndex[iNote] * 84];
                     }
-                    if (currval > 0) signifIndex.push_back(index);
-                    f3.values.push_back(0); // fill the values, change later
-                    index++;
                 }
-                float rnorm;
-                float w[84+1000];
-                float zz[84+1000];
-                int indx[84+1000];
-                int mode;
+                iterations = fnnls(ata, atb, n, xd, work, fnnlsIndex, &mode);
+                statistics.solves++;
+                statistics.iterations += iterations;
+                if (mode == 3) statistics.unconverged++;
+                for (int iNote = 0; iNote < n; ++iNote) x[iNote] = xd[iNote];
+            } else {
                 int dictsize = nNote*signifIndex.size();
                 // cerr << "dictsize is " << dictsize << "and values size" << f3.values.size()<< endl;
                 float *curr_dict = new float[dictsize];
@@ -396,87 +608,100 @@ NNLSChroma::getRemainingFeatures()
                         curr_dict[iNote * nNote + iBin] = 1.0 * m_dict[signifIndex[iNote] * nNote + iBin];
                     }
                 }
-                nnls(curr_dict, nNote, nNote, signifIndex.size(), b, x, &rnorm, w, zz, indx, &mode);
-                delete [] curr_dict;
-                for (int iNote = 0; iNote < (int)signifIndex.size(); ++iNote) {
-                    f3.values[signifIndex[iNote]] = x[iNote];
-                    // cerr << mode << endl;
-                    chroma[signifIndex[iNote] % 12] += x[iNote] * treblewindow[signifIndex[iNote]];
-                    basschroma[signifIndex[iNote] % 12] += x[iNote] * basswindow[signifIndex[iNote]];
+                // columns of the notes active in the previous frame
+                vector<int> passive;
+                if (m_nnlsSolver == WarmStartSolver) {
+                    for (int iNote = 0; iNote < (int)signifIndex.size(); ++iNote) {
+                        if (binary_search(activeNotes.begin(), activeNotes.end(), signifIndex[iNote])) {
+                            passive.push_back(iNote);
+                        }
+                    }
                 }
-            }	
-        } else {
-            for (int i = 0; i < 84; ++i) f3.values.push_back(0);
-        }
+                statistics.solves++;
+                int nseed = nnls_warm(curr_dict, nNote, nNote, signifIndex.size(), b, x, &rnorm, w, zz, indx, &mode,
+                                      passive.empty() ? 0 : &passive[0], passive.size(), &iterations);
+                if (!passive.empty()) {
+                    statistics.warmStarts++;
+                    if (nseed == (int)passive.size()) statistics.warmStartHits++;
+                    statistics.seededColumnsKept += nseed;
+                }
+                statistics.iterations += iterations;
+                if (mode == 3) statistics.unconverged++;
+                delete [] curr_dict;
+            }
+            activeNotes.clear();
+            for (int iNote = 0; iNote < (int)signifIndex.size(); ++iNote) {
+                if (x[iNote] > 0) activeNotes.push_back(signifIndex[iNote]);
+            }
+            for (int iNote = 0; iNote < (int)signifIndex.size(); ++iNote) {
+                f3.values[signifIndex[iNote]] = x[iNote];
+                // cerr << mode << endl;
+                chroma[signifIndex[iNote] % 12] += x[iNote] * treblewindow[signifIndex[iNote]];
+                basschroma[signifIndex[iNote] % 12] += x[iNote] * basswindow[signifIndex[iNote]];
+            }
+        }	
+    } else {
+        for (int i = 0; i < 84; ++i) f3.values.push_back(0);
+        activeNotes.clear();
+    }
 		
 
-        f4.values = chroma; 
-        f5.values = basschroma;
-        chroma.insert(chroma.begin(), basschroma.begin(), basschroma.end()); // just stack the both chromas 
-        f6.values = chroma; 
+    f4.values = chroma; 
+    f5.values = basschroma;
+    chroma.insert(chroma.begin(), basschroma.begin(), basschroma.end()); // just stack the both chromas 
+    f6.values = chroma; 
 	        
-        if (m_doNormalizeChroma > 0) {
-            vector<float> chromanorm = vector<float>(3,0);			
-            switch (int(m_doNormalizeChroma)) {
-            case 0: // should never end up here
-                break;
-            case 1:
-                chromanorm[0] = *max_element(f4.values.begin(), f4.values.end());
-                chromanorm[1] = *max_element(f5.values.begin(), f5.values.end());
-                chromanorm[2] = max(chromanorm[0], chromanorm[1]);
-                break;
-            case 2:
-                for (vector<float>::iterator it = f4.values.begin(); it != f4.values.end(); ++it) {
-                    chromanorm[0] += *it; 						
-                }
-                for (vector<float>::iterator it = f5.values.begin(); it != f5.values.end(); ++it) {
-                    chromanorm[1] += *it; 						
-                }
-                for (vector<float>::iterator it = f6.values.begin(); it != f6.values.end(); ++it) {
-                    chromanorm[2] += *it; 						
-                }
-                break;
-            case 3:
-                for (vector<float>::iterator it = f4.values.begin(); it != f4.values.end(); ++it) {
-                    chromanorm[0] += pow(*it,2); 						
-                }
-                chromanorm[0] = sqrt(chromanorm[0]);
-                for (vector<float>::iterator it = f5.values.begin(); it != f5.values.end(); ++it) {
-                    chromanorm[1] += pow(*it,2); 						
-                }
-                chromanorm[1] = sqrt(chromanorm[1]);
-                for (vector<float>::iterator it = f6.values.begin(); it != f6.values.end(); ++it) {
-                    chromanorm[2] += pow(*it,2); 						
-                }
-                chromanorm[2] = sqrt(chromanorm[2]);
-                break;
+    if (m_doNormalizeChroma > 0) {
+        vector<float> chromanorm = vector<float>(3,0);			
+        switch (int(m_doNormalizeChroma)) {
+        case 0: // should never end up here
+            break;
+        case 1:
+            chromanorm[0] = *max_element(f4.values.begin(), f4.values.end());
+            chromanorm[1] = *max_element(f5.values.begin(), f5.values.end());
+            chromanorm[2] = max(chromanorm[0], chromanorm[1]);
+            break;
+        case 2:
+            for (vector<float>::iterator it = f4.values.begin(); it != f4.values.end(); ++it) {
+                chromanorm[0] += *it; 						
             }
-            if (chromanorm[0] > 0) {
-                for (int i = 0; i < (int)f4.values.size(); i++) {
-                    f4.values[i] /= chromanorm[0];
-                }
+            for (vector<float>::iterator it = f5.values.begin(); it != f5.values.end(); ++it) {
+                chromanorm[1] += *it; 						
             }
-            if (chromanorm[1] > 0) {
-                for (int i = 0; i < (int)f5.values.size(); i++) {
-                    f5.values[i] /= chromanorm[1];
-                }
+            for (vector<float>::iterator it = f6.values.begin(); it != f6.values.end(); ++it) {
+                chromanorm[2] += *it; 						
             }
-            if (chromanorm[2] > 0) {
-                for (int i = 0; i < (int)f6.values.size(); i++) {
-                    f6.values[i] /= chromanorm[2];
-                }
+            break;
+        case 3:
+            for (vector<float>::iterator it = f4.values.begin(); it != f4.values.end(); ++it) {
+                chromanorm[0] += pow(*it,2); 						
+            }
+            chromanorm[0] = sqrt(chromanorm[0]);
+            for (vector<float>::iterator it = f5.values.begin(); it != f5.values.end(); ++it) {
+                chromanorm[1] += pow(*it,2); 						
+            }
+            chromanorm[1] = sqrt(chromanorm[1]);
+            for (vector<float>::iterator it = f6.values.begin(); it != f6.values.end(); ++it) {
+                chromanorm[2] += pow(*it,2); 						
+            }
+            chromanorm[2] = sqrt(chromanorm[2]);
+            break;
+        }
+        if (chromanorm[0] > 0) {
+            for (int i = 0; i < (int)f4.values.size(); i++) {
+                f4.values[i] /= chromanorm[0];
+            }
+        }
+        if (chromanorm[1] > 0) {
+            for (int i = 0; i < (int)f5.values.size(); i++) {
+                f5.values[i] /= chromanorm[1];
+            }
+        }
+        if (chromanorm[2] > 0) {
+            for (int i = 0; i < (int)f6.values.size(); i++) {
+                f6.values[i] /= chromanorm[2];
             }
         }
-	
-        fsOut[m_outputSemitonespectrum].push_back(f3);
-        fsOut[m_outputChroma].push_back(f4);
-        fsOut[m_outputBasschroma].push_back(f5);
-        fsOut[m_outputBothchroma].push_back(f6);
-        count++;
     }
-    if (debug_on) cerr << "done." << endl;
-
-    return fsOut;     
-
+	
 }
-
@@ -27,6 +27,36 @@ using namespace std;
 class NNLSChroma : public NNLSBase
 {
 public:
+    // How the semitone spectrum of each frame is solved
+    enum NNLSSolver {
+        // Lawson-Hanson, from scratch every frame
+        LawsonHansonSolver,
+        // Lawson-Hanson, starting from the notes active in the previous
+        // frame (chains restart every warmStartSpan frames)
+        WarmStartSolver,
+        // Active set on the normal equations (fnnls.h), with the Gram
+        // matrix of the dictionary computed once
+        GramActiveSetSolver
+    };
+
+    // NNLS work since the plugin was made or reset
+    struct NNLSStatistics {
+        long solves;
+        // Solves with notes of the previous frame to start from, and
+        // those whose start was feasible and kept
+        long warmStarts;
+        long warmStartHits;
+        // Iterations of the solution loop, and the seeded columns the warm
+        // starts kept in their first passive set
+        long iterations;
+        long seededColumnsKept;
+        // Solves stopped at the iteration limit of the solver, whose notes
+        // are then its last feasible solution
+        long unconverged;
+        NNLSStatistics();
+        NNLSStatistics &operator+=(const NNLSStatistics &other);
+    };
+
     NNLSChroma(float inputSampleRate);
     virtual ~NNLSChroma();
 
@@ -40,16 +70,80 @@ public:
                        Vamp::RealTime timestamp);
     FeatureSet getRemainingFeatures();
 
+    // Same as process(), for a frame whose log-frequency spectrum was
+    // computed elsewhere, by getLogFrequencySpectrum(); frames must come
+    // in time order
+    FeatureSet processLogFrequencySpectrum(const Feature &f1);
+
     bool initialise(size_t channels, size_t stepSize, size_t blockSize);
     void reset();
 
+    // Tuning frequency in Hz, estimated by getRemainingFeatures()
+    float getEstimatedTuning() const;
+
+    // Streaming mode, for live or very long inputs: the global tuning is
+    // estimated from the first warmUpFrames frames only (local tuning
+    // needs no warm-up), and from then on process() returns the chroma
+    // of every frame as it arrives, so memory does not grow with the
+    // duration. 0, the default, tunes on the whole input and returns
+    // everything from getRemainingFeatures(). Call before process().
+    void setStreamingWarmUp(size_t warmUpFrames);
+
+    // Threads sharing the tuning, whitening and NNLS of the frames, all
+    // the cores by default (0). The output does not depend on it.
+    void setNumberOfThreads(int numberOfThreads);
+
+    // Front end mode: process() only returns the log-frequency spectrum
+    // of each frame and keeps nothing, and getRemainingFeatures() returns
+    // nothing. Instances in this mode feed processLogFrequencySpectrum()
+    // of another one.
+    void setLogSpectrumOnly(bool logSpectrumOnly);
+
+    // NNLSSolver for the semitone spectrum, LawsonHansonSolver by default
+    void setNNLSSolver(int solver);
+    NNLSStatistics getNNLSStatistics() const;
+
 protected:
+    float m_estimatedTuning;
+    float m_normalisedTuning;
+    size_t m_streamingWarmUp;
+    bool m_tuningFixed;
+    int m_numberOfThreads;
+    bool m_logSpectrumOnly;
+    int m_nnlsSolver;
+    // Gram matrix of the note dictionary, 84 x 84
+    vector<double> m_dictGram;
+    NNLSStatistics m_nnlsStatistics;
+    // Frames solved since reset(), and the notes active in the last one
+    size_t m_solvedFrames;
+    vector<int> m_activeNotes;
+    // Fewer frames than this per thread are not worth the thread
+    static const int minimumFramesPerThread = 16;
+    // Warm starts chain through the frames from a multiple of this on,
+    // so that the output does not depend on how they are shared
+    static const int warmStartSpan = 64;
     mutable int m_outputLogfreqspec;
     mutable int m_outputTunedlogfreqspec;
     mutable int m_outputSemitonespectrum;
     mutable int m_outputChroma;
     mutable int m_outputBasschroma;
     mutable int m_outputBothchroma;
+
+    // Sets m_estimatedTuning and m_normalisedTuning from m_meanTunings
+    void estimateTuning();
+    // Outputs the frames of m_logSpectrum and drops them
+    void processLogSpectrum(FeatureSet &fsOut);
+    // Frames begin to end of m_logSpectrum, into the outputs tuned
+    // log-frequency spectrum, semitone spectrum, chroma, bass chroma and
+    // both chromas, from their element first on. activeNotes are those
+    // of the frame before begin, and become those of the frame end - 1
+    void processFrames(int begin, int end, size_t first, FeatureList *outputs[],
+                       vector<int> *activeNotes, NNLSStatistics *statistics);
+    // Tuning, whitening, NNLS and chroma mapping of one frame; a warm
+    // start begins with activeNotes, which become those of the frame
+    void processFrame(const Feature &f1, float normalisedtuning,
+                      Feature &f2, Feature &f3, Feature &f4, Feature &f5, Feature &f6,
+                      vector<int> &activeNotes, NNLSStatistics &statistics);
 };
 
 
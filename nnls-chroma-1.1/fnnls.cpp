@@ -0,0 +1,177 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  NNLS-Chroma / Chordino
+
+  Active-set NNLS on the normal equations, see fnnls.h.
+*/
+
+#include "fnnls.h"
+
+#include <cfloat>
+#include <cmath>
+
+/* a[0..n-1] . b[0..n-1], in four running sums: unlike a single one,
+   they do not have to be added in order, so the compiler can keep them
+   in vector registers. */
+static inline double
+dot(const double *a, const double *b, int n)
+{
+    double sum[4] = { 0, 0, 0, 0 };
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        for (int k = 0; k < 4; ++k) sum[k] += a[i + k] * b[i + k];
+    }
+    for (; i < n; ++i) sum[0] += a[i] * b[i];
+    return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+/* Extends the Cholesky factor l of ata[P,P] from the first columns in
+   passive to np of them, row by row. Row j of the factor is
+   l[j * n .. j * n + j], so the products below run over contiguous
+   rows. Returns how many columns are factored: less than np if column
+   passive[k] depends on those before it, within tol, for the returned
+   k. */
+static int
+factorPassive(const double *ata, int n, const int *passive,
+              int first, int np, double tol, double *l)
+{
+    for (int j = first; j < np; ++j) {
+        const double *column = ata + passive[j] * n;
+        double *row = l + j * n;
+        for (int k = 0; k < j; ++k) {
+            row[k] = (column[passive[k]] - dot(row, l + k * n, k)) /
+                l[k + k * n];
+        }
+        double diagonal = column[passive[j]] - dot(row, row, j);
+        if (diagonal <= tol) return j;
+        row[j] = sqrt(diagonal);
+    }
+    return np;
+}
+
+/* Solves ata[P,P] s = atb[P] with its factor l. */
+static void
+solvePassive(const double *atb, int n, const int *passive, int np,
+             const double *l, double *s)
+{
+    for (int i = 0; i < np; ++i) {
+        s[i] = (atb[passive[i]] - dot(l + i * n, s, i)) / l[i + i * n];
+    }
+    // the transpose, a row of the factor at a time
+    for (int i = np - 1; i >= 0; --i) {
+        const double *row = l + i * n;
+        s[i] /= row[i];
+        for (int k = 0; k < i; ++k) s[k] -= row[k] * s[i];
+    }
+}
+
+int
+fnnls(const double *ata, const double *atb, int n,
+      double *x, double *work, int *index, int *mode)
+{
+    double *l = work;
+    double *s = l + n * n;
+    double *w = s + n;
+    int *passive = index;
+    int *inPassive = index + n;
+
+    // gradients below this are rounding, as in lsqnonneg
+    double norm = 0;
+    for (int j = 0; j < n; ++j) {
+        double columnSum = 0;
+        for (int i = 0; i < n; ++i) columnSum += fabs(ata[i + j * n]);
+        if (columnSum > norm) norm = columnSum;
+    }
+    double tol = 10 * DBL_EPSILON * norm * n;
+
+    int np = 0;
+    for (int j = 0; j < n; ++j) {
+        x[j] = 0;
+        w[j] = atb[j];
+        inPassive[j] = 0;
+    }
+    *mode = 1;
+    int iter = 0;
+    int itmax = 3 * n;
+    while (np < n) {
+        // the column most against the constraints enters
+        int jmax = -1;
+        for (int j = 0; j < n; ++j) {
+            if (!inPassive[j] && w[j] > tol && (jmax < 0 || w[j] > w[jmax])) {
+                jmax = j;
+            }
+        }
+        if (jmax < 0) break;
+        passive[np] = jmax;
+        // as in nnls(), a column that is nearly dependent on the active
+        // ones, or whose own coefficient would not be positive, waits
+        if (factorPassive(ata, n, passive, np, np + 1, tol, l) == np) {
+            w[jmax] = 0;
+            continue;
+        }
+        solvePassive(atb, n, passive, np + 1, l, s);
+        if (s[np] <= 0) {
+            w[jmax] = 0;
+            continue;
+        }
+        inPassive[jmax] = 1;
+        ++np;
+        // back into the feasible region, dropping columns on the way
+        for (;;) {
+            if (++iter > itmax) {
+                *mode = 3;
+                return iter;
+            }
+            double alpha = 2;
+            int jalpha = -1;
+            for (int i = 0; i < np; ++i) {
+                if (s[i] <= 0) {
+                    double t = x[passive[i]] / (x[passive[i]] - s[i]);
+                    if (t < alpha) {
+                        alpha = t;
+                        jalpha = i;
+                    }
+                }
+            }
+            if (jalpha < 0) break;
+            for (int i = 0; i < np; ++i) {
+                x[passive[i]] += alpha * (s[i] - x[passive[i]]);
+            }
+            x[passive[jalpha]] = 0;
+            int kept = 0;
+            for (int i = 0; i < np; ++i) {
+                if (x[passive[i]] > 0) {
+                    passive[kept++] = passive[i];
+                } else {
+                    x[passive[i]] = 0;
+                    inPassive[passive[i]] = 0;
+                }
+            }
+            np = kept;
+            // rounding can leave a kept column dependent on the others;
+            // it leaves too, as one that would not enter above
+            int factored = factorPassive(ata, n, passive, 0, np, tol, l);
+            while (factored < np) {
+                x[passive[factored]] = 0;
+                inPassive[passive[factored]] = 0;
+                for (int i = factored + 1; i < np; ++i) {
+                    passive[i - 1] = passive[i];
+                }
+                --np;
+                factored = factorPassive(ata, n, passive, factored, np,
+                                         tol, l);
+            }
+            solvePassive(atb, n, passive, np, l, s);
+        }
+        for (int i = 0; i < np; ++i) x[passive[i]] = s[i];
+        // gradient of the new solution
+        for (int j = 0; j < n; ++j) w[j] = atb[j];
+        for (int i = 0; i < np; ++i) {
+            const double *column = ata + passive[i] * n;
+            double xi = s[i];
+            for (int j = 0; j < n; ++j) w[j] -= column[j] * xi;
+        }
+    }
+    return iter;
+}
@@ -0,0 +1,32 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  NNLS-Chroma / Chordino
+
+  Active-set NNLS on the normal equations, after R. Bro and S. de
+  Jong, "A fast non-negativity-constrained least squares algorithm",
+  Journal of Chemometrics 11, 1997.
+
+  The iterations are those of Lawson and Hanson (nnls.c), but on the
+  small Gram matrix A^T A instead of the tall A, in double precision.
+  For the note dictionary (256 bins, at most 84 notes) A^T A is
+  computed once, and a frame only costs A^T b and Cholesky solves of
+  the size of the active set.
+*/
+
+#ifndef FNNLS_H
+#define FNNLS_H
+
+/* Solves min |A x - b| subject to x >= 0, given ata = A^T A (n x n,
+   column-major) and atb = A^T b. work needs fnnlsWorkSize(n) doubles
+   and index fnnlsIndexSize(n) ints. Returns the iterations of the
+   solution loop, as nnls() counts them. *mode is 1 on success and, as
+   in nnls(), 3 if the loop stopped after 3n iterations (x is then the
+   last feasible solution). */
+int fnnls(const double *ata, const double *atb, int n,
+          double *x, double *work, int *index, int *mode);
+
+inline int fnnlsWorkSize(int n) { return n * n + 2 * n; }
+inline int fnnlsIndexSize(int n) { return 2 * n; }
+
+#endif
@@ -201,6 +201,14 @@ int h12(int mode, int* lpivot, int* l1,
 int nnls(float* a,  int mda,  int m,  int n, float* b,
          float* x, float* rnorm, float* w, float* zz, int* index,
          int* mode)
+{
+  nnls_warm(a, mda, m, n, b, x, rnorm, w, zz, index, mode, 0, 0, 0);
+  return 0;
+} /* nnls_ */
+
+int nnls_warm(float* a,  int mda,  int m,  int n, float* b,
+              float* x, float* rnorm, float* w, float* zz, int* index,
+              int* mode, const int* passive, int npassive, int* iterations)
 {
   /* System generated locals */
   int a_dim1, a_offset, idx1, idx2;
@@ -220,6 +228,7 @@ int nnls(float* a,  int mda,  int m,  int n, float* b,
   int iz, jz;
   float up, ss;
   int rtnkey, iz1, iz2, npp1;
+  int ipass, nseed;
 
   /*     ------------------------------------------------------------------
    */
@@ -239,6 +248,9 @@ int nnls(float* a,  int mda,  int m,  int n, float* b,
 
   /* Function Body */
   *mode = 1;
+  if (iterations) {
+    *iterations = 0;
+  }
   if (m <= 0 || n <= 0) {
     *mode = 2;
     return 0;
@@ -259,6 +271,86 @@ int nnls(float* a,  int mda,  int m,  int n, float* b,
   iz1 = 1;
   nsetp = 0;
   npp1 = 1;
+  nseed = 0;
+
+  /*     WARM START: MOVE THE COLUMNS PASSIVE() (ZERO-BASED) TO SET P FIRST, */
+  /*     AS THE MAIN LOOP WOULD, SKIPPING THOSE NEARLY DEPENDENT. THOSE */
+  /*     WHOSE COEFFS ARE NONPOSITIVE GO BACK TO SET Z, AS IN THE SECONDARY */
+  /*     LOOP, WHICH THEN GOES ON FROM THE FEASIBLE REST. */
+
+  for (ipass = 0; ipass < npassive && nsetp < m; ++ipass) {
+    j = passive[ipass] + 1;
+    for (iz = iz1; iz <= iz2 && index[iz] != j; ++iz) {
+    }
+    if (iz > iz2) {
+      continue;
+    }
+    asave = a[npp1 + j * a_dim1];
+    idx1 = npp1 + 1;
+    h12(c__1, &npp1, &idx1, m, &a[j * a_dim1 + 1], &c__1, &up, dummy, &
+        c__1, &c__1, &c__0);
+    unorm = 0.;
+    if (nsetp != 0) {
+      idx1 = nsetp;
+      for (l = 1; l <= idx1; ++l) {
+        /* Computing 2nd power */
+        d1 = a[l + j * a_dim1];
+        unorm += d1 * d1;
+      }
+    }
+    unorm = sqrt(unorm);
+    d2 = unorm + (d1 = a[npp1 + j * a_dim1], nnls_abs(d1)) * .01;
+    if ((d2- unorm) <= 0.) {
+      a[npp1 + j * a_dim1] = asave;
+      continue;
+    }
+    idx1 = npp1 + 1;
+    h12(c__2, &npp1, &idx1, m, &a[j * a_dim1 + 1], &c__1, &up, (b+1), &
+        c__1, &c__1, &c__1);
+
+    index[iz] = index[iz1];
+    index[iz1] = j;
+    ++iz1;
+    nsetp = npp1;
+    ++npp1;
+
+    if (iz1 <= iz2) {
+      idx1 = iz2;
+      for (jz = iz1; jz <= idx1; ++jz) {
+        jj = index[jz];
+        h12(c__2, &nsetp, &npp1, m,
+            &a[j * a_dim1 + 1], &c__1, &up,
+            &a[jj * a_dim1 + 1], &c__1, &mda, &c__1);
+      }
+    }
+
+    if (nsetp != m) {
+      idx1 = m;
+      for (l = npp1; l <= idx1; ++l) {
+        a[l + j * a_dim1] = 0.;
+      }
+    }
+    ++nseed;
+  }
+  if (nseed > 0) {
+    idx1 = m;
+    for (l = 1; l <= idx1; ++l) {
+      zz[l] = b[l];
+    }
+    rtnkey = 3;
+    goto L400;
+  L500:
+    idx1 = nsetp;
+    for (ip = 1; ip <= idx1; ++ip) {
+      x[index[ip]] = zz[ip];
+      if (zz[ip] <= 0.) {
+        --nseed;
+      }
+    }
+    if (nseed < nsetp) {
+      goto L290;
+    }
+  }
   /*                             ******  MAIN LOOP BEGINS HERE  ****** */
  L30:
   /*                  QUIT IF ALL COEFFICIENTS ARE ALREADY IN THE SOLUTION.
@@ -502,6 +594,7 @@ int nnls(float* a,  int mda,  int m,  int n, float* b,
   /*        THAT ARE NONPOSITIVE WILL BE SET TO ZERO */
   /*        AND MOVED FROM SET P TO SET Z. */
 
+  L290:
   idx1 = nsetp;
   for (jj = 1; jj <= idx1; ++jj) {
     i__ = index[jj];
@@ -557,7 +650,10 @@ int nnls(float* a,  int mda,  int m,  int n, float* b,
     }
   }
   *rnorm = sqrt(sm);
-  return 0;
+  if (iterations) {
+    *iterations = iter;
+  }
+  return nseed;
 
   /*     THE FOLLOWING BLOCK OF CODE IS USED AS AN INTERNAL SUBROUTINE */
   /*     TO SOLVE THE TRIANGULAR SYSTEM, PUTTING THE SOLUTION IN ZZ(). */
@@ -580,10 +676,11 @@ int nnls(float* a,  int mda,  int m,  int n, float* b,
   switch ((int)rtnkey) {
   case 1:  goto L200;
   case 2:  goto L320;
+  case 3:  goto L500;
   }
 
   return 0;
 
-} /* nnls_ */
+} /* nnls_warm */
 
 
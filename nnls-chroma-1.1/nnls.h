@@ -9,6 +9,16 @@ int nnls(float *a, int mda, int m, int n,
 	 float *b, float *x, float *rnorm, 
 	 float *w, float *zz, int *index, int *mode);
 
+/* Same as nnls(), starting with the columns passive[0..npassive-1]
+   (zero-based) in the solution, as those of a previous, similar problem.
+   Returns how many of them had a positive coefficient on their own, and
+   sets *iterations (unless null) to the iterations of the solution
+   loop. */
+int nnls_warm(float *a, int mda, int m, int n,
+	      float *b, float *x, float *rnorm,
+	      float *w, float *zz, int *index, int *mode,
+	      const int *passive, int npassive, int *iterations);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,73 +1,131 @@
-import subprocess
-import logging
-from . import key_profiles
-from . import key_transitions
-import itertools
-from multiprocessing.dummy import Pool as ThreadPool
-
-class Ensembler:
-    def __init__(self, profiles, transitions):
-        self.logger = logging.getLogger('ensembler')
-        self.logger.info('Ensembler() <- profiles={}, transitions={}'.format(profiles, transitions))
-        self.profiles = profiles
-        self.transitions = transitions
-
-    def grade_key_profiles(self, key_profiles, key_transition_name):
-        ''' Grade a list of key profiles '''
-        self.logger.info('Start grade_key_profiles() <- key_profiles={}, key_transition_name={}'.format(key_profiles, key_transition_name))
-        grading = [self.evaluate(x, key_transition_name) for x in key_profiles]
-        grading = sorted(grading, key=lambda score: score[0])
-        self.logger.info('Done grade_key_profiles() -> grading={}'.format(grading))
-        return grading
-
-    def grade_key_transitions(self, key_profile_name, key_transitions):
-        ''' Grade a list of key transitions '''
-        self.logger.info('Start grade_key_transitions() <- key_profile_name={}, key_transitions ={}'.format(key_profile_name, key_transitions))
-        grading = [self.evaluate(key_profile_name, x) for x in key_transitions]
-        grading = sorted(grading, key=lambda score: score[0])
-        self.logger.info('Done grade_key_transitions() -> grading={}'.format(grading))
-        return grading
-
-    def get_ensemble(self, mixed_profiles=False):
-        ''' Create the ensemble '''
-        self.logger.info('Start get_ensemble() <- mixedProfiles={}'.format(mixed_profiles))
-        if mixed_profiles:
-            profiles = [key_profiles.mix(m[0], m[1]) for m in itertools.product(self.profiles, self.profiles)]
-        else:
-            profiles = self.profiles
-        self.ensemble = [(e[0], e[1]) for e in itertools.product(profiles, self.transitions)]
-        return self.ensemble
-
-    def evaluate(self, filename, mixed_profiles=False):
-        ''' Evaluate a key profile '''
-        self.logger.info('Start evaluate() <- filename={}'.format(filename))
-        if not hasattr(self, 'ensemble'):
-            self.get_ensemble(mixed_profiles)
-        with ThreadPool(4) as p:
-            features = p.map(lambda e: self.run_keydetection(filename, e), self.ensemble)
-        self.logger.info('Done evaluate() -> features={}'.format(features))
-        return features
-
-    def run_keydetection(self, filename, ensemble):
-        self.logger.debug('run_keydetection() <- filename={}, ensemble={}'.format(filename, ensemble))
-        key_profile_name = ensemble[0]
-        key_transition_name = ensemble[1]
-        kp_string = key_profiles.get_as_string(key_profile_name)
-        kt_string = key_transitions.get_as_string(key_transition_name)
-        justkeydding = subprocess.Popen(
-                ('bin/justkeydding',
-                '-p',
-                '-K',
-                '{}'.format(kp_string),
-                '-T',
-                '{}'.format(kt_string),
-                filename),
-                stdout=subprocess.PIPE)
-        output, _ = justkeydding.communicate()
-        features = output.split()
-        if len(features) != 24:
-            self.logger.error('Failed while running justkeydding, output: {}'.format(output))
-            features = ['-1000000'] * 24
-        features = [float(x) for x in features]
-        self.logger.debug('{} {}: {}'.format(filename, ensemble, features))
-        return features
+import subprocess
+import logging
+import tempfile
+import atexit
+import os
+from . import key_profiles
+from . import key_transitions
+import itertools
+from multiprocessing.dummy import Pool as ThreadPool
+
+class Ensembler:
+    def __init__(self, profiles, transitions):
+        self.logger = logging.getLogger('ensembler')
+        self.logger.info('Ensembler() <- profiles={}, transitions={}'.format(profiles, transitions))
+        self.profiles = profiles
+        self.transitions = transitions
+        self.bundle = None
+
+    def grade_key_profiles(self, key_profiles, key_transition_name):
+        ''' Grade a list of key profiles '''
+        self.logger.info('Start grade_key_profiles() <- key_profiles={}, key_transition_name={}'.format(key_profiles, key_transition_name))
+        grading = [self.evaluate(x, key_transition_name) for x in key_profiles]
+        grading = sorted(grading, key=lambda score: score[0])
+        self.logger.info('Done grade_key_profiles() -> grading={}'.format(grading))
+        return grading
+
+    def grade_key_transitions(self, key_profile_name, key_transitions):
+        ''' Grade a list of key transitions '''
+        self.logger.info('Start grade_key_transitions() <- key_profile_name={}, key_transitions ={}'.format(key_profile_name, key_transitions))
+        grading = [self.evaluate(key_profile_name, x) for x in key_transitions]
+        grading = sorted(grading, key=lambda score: score[0])
+        self.logger.info('Done grade_key_transitions() -> grading={}'.format(grading))
+        return grading
+
+    def get_ensemble(self, mixed_profiles=False):
+        ''' Create the ensemble '''
+        self.logger.info('Start get_ensemble() <- mixedProfiles={}'.format(mixed_profiles))
+        if mixed_profiles:
+            profiles = [key_profiles.mix(m[0], m[1]) for m in itertools.product(self.profiles, self.profiles)]
+        else:
+            profiles = self.profiles
+        self.ensemble = [(e[0], e[1]) for e in itertools.product(profiles, self.transitions)]
+        self.bundle = self.write_bundle()
+        return self.ensemble
+
+    def write_bundle(self):
+        ''' Compile the models of the ensemble into a bundle, None if bin/modelbundler fails '''
+        self.logger.info('Start write_bundle()')
+        lines = []
+        for name in sorted(set(e[0] for e in self.ensemble)):
+            lines.append('profile {} {}'.format(name, key_profiles.get_as_string(name)))
+        for name in sorted(set(e[1] for e in self.ensemble)):
+            lines.append('transition {} {}'.format(name, key_transitions.get_as_string(name)))
+        models = ['m{}'.format(i) for i in range(len(self.ensemble))]
+        for model, e in zip(models, self.ensemble):
+            lines.append('model {} {} {}'.format(model, e[0], e[1]))
+        lines.append('ensemble ensemble {}'.format(' '.join(models)))
+        fd, bundle = tempfile.mkstemp(suffix='.jkd')
+        os.close(fd)
+        atexit.register(os.remove, bundle)
+        try:
+            modelbundler = subprocess.run(
+                    ('bin/modelbundler', '-', bundle),
+                    input='\n'.join(lines).encode())
+        except OSError:
+            self.logger.warning('Could not run bin/modelbundler, every model runs on its own')
+            return None
+        if modelbundler.returncode != 0:
+            self.logger.warning('Failed while writing the bundle, every model runs on its own')
+            return None
+        self.logger.info('Done write_bundle() -> bundle={}'.format(bundle))
+        return bundle
+
+    def evaluate(self, filename, mixed_profiles=False):
+        ''' Evaluate a key profile '''
+        self.logger.info('Start evaluate() <- filename={}'.format(filename))
+        if not hasattr(self, 'ensemble'):
+            self.get_ensemble(mixed_profiles)
+        if self.bundle:
+            features = self.run_ensemble(filename)
+            self.logger.info('Done evaluate() -> features={}'.format(features))
+            return features
+        with ThreadPool(4) as p:
+            features = p.map(lambda e: self.run_keydetection(filename, e), self.ensemble)
+        self.logger.info('Done evaluate() -> features={}'.format(features))
+        return features
+
+    def run_ensemble(self, filename):
+        ''' Every model of the bundle, from a single chromagram of the file '''
+        self.logger.debug('run_ensemble() <- filename={}'.format(filename))
+        justkeydding = subprocess.Popen(
+                ('bin/justkeydding',
+                '-B',
+                self.bundle,
+                '-E',
+                'ensemble',
+                filename),
+                stdout=subprocess.PIPE)
+        output, _ = justkeydding.communicate()
+        lines = output.splitlines()
+        features = [line.split() for line in lines]
+        if len(features) != len(self.ensemble) or any(len(f) != 24 for f in features):
+            self.logger.error('Failed while running justkeydding, output: {}'.format(output))
+            features = [['-1000000'] * 24 for _ in self.ensemble]
+        features = [[float(x) for x in f] for f in features]
+        self.logger.debug('{}: {}'.format(filename, features))
+        return features
+
+    def run_keydetection(self, filename, ensemble):
+        self.logger.debug('run_keydetection() <- filename={}, ensemble={}'.format(filename, ensemble))
+        key_profile_name = ensemble[0]
+        key_transition_name = ensemble[1]
+        kp_string = key_profiles.get_as_string(key_profile_name)
+        kt_string = key_transitions.get_as_string(key_transition_name)
+        justkeydding = subprocess.Popen(
+                ('bin/justkeydding',
+                '-p',
+                '-K',
+                '{}'.format(kp_string),
+                '-T',
+                '{}'.format(kt_string),
+                filename),
+                stdout=subprocess.PIPE)
+        output, _ = justkeydding.communicate()
+        features = output.split()
+        if len(features) != 24:
+            self.logger.error('Failed while running justkeydding, output: {}'.format(output))
+            features = ['-1000000'] * 24
+        features = [float(x) for x in features]
+        self.logger.debug('{} {}: {}'.format(filename, ensemble, features))
+        return features
@@ -0,0 +1,231 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Audio to chromagram, frame by frame
+
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "./audiochromastream.h"
+
+namespace justkeydding {
+
+AudioChromaStream::AudioChromaStream(
+    std::string audioFilename,
+    double warmUpSeconds,
+    int numberOfThreads,
+    int nnlsSolver,
+    int numberOfFrontEnds) :
+    m_status(Status::AUDIOCHROMASTREAM_UNINITIALIZED),
+    m_sndfile(NULL),
+    m_chroma(NULL),
+    m_adapter(NULL),
+    m_blockSize(0),
+    m_chromaFeatureNo(-1),
+    m_frame(0),
+    m_frontEnd(NULL) {
+    m_sndfile = sf_open(audioFilename.c_str(), SFM_READ, &m_sfinfo);
+    if (!m_sndfile) {
+        m_status = Status::AUDIOCHROMASTREAM_INPUTFILE_ERROR;
+        return;
+    }
+    m_chroma = new NNLSChroma(m_sfinfo.samplerate);
+    m_chroma->setNumberOfThreads(numberOfThreads);
+    m_chroma->setNNLSSolver(nnlsSolver);
+    if (warmUpSeconds >= 0) {
+        std::size_t warmUpFrames = static_cast<std::size_t>(
+            warmUpSeconds * m_sfinfo.samplerate /
+            m_chroma->getPreferredStepSize());
+        m_chroma->setStreamingWarmUp(warmUpFrames > 0 ? warmUpFrames : 1);
+    }
+    m_adapter = ChunkedFrontEnd::makeAdapter(m_chroma);
+
+    m_blockSize = m_adapter->getPreferredBlockSize();
+
+    if (!m_adapter->initialise(1, m_blockSize, m_blockSize)) {
+        m_status = Status::AUDIOCHROMASTREAM_NNLS_ERROR;
+        return;
+    }
+
+    Vamp::Plugin::OutputList outputs = m_adapter->getOutputDescriptors();
+    for (int i = 0; i < static_cast<int>(outputs.size()); ++i) {
+        if (outputs[i].identifier == "chroma") {
+            m_chromaFeatureNo = i;
+        }
+    }
+    if (m_chromaFeatureNo < 0) {
+        m_status = Status::AUDIOCHROMASTREAM_NNLS_ERROR;
+        return;
+    }
+
+    m_fileBuffer.resize(m_sfinfo.channels * m_blockSize);
+    m_mixBuffer.resize(m_blockSize);
+
+    m_parameters.sampleRate = m_sfinfo.samplerate;
+    m_parameters.blockSize = m_blockSize;
+    getNNLSParameters(*m_chroma, &m_parameters);
+
+    if (warmUpSeconds < 0 && numberOfFrontEnds > 1) {
+        m_frontEnd = new ChunkedFrontEnd(
+            m_sfinfo.samplerate, m_blockSize, numberOfFrontEnds);
+        if (!m_frontEnd->isReady()) {
+            m_status = Status::AUDIOCHROMASTREAM_NNLS_ERROR;
+            return;
+        }
+    }
+    m_status = Status::AUDIOCHROMASTREAM_STREAMING;
+}
+
+AudioChromaStream::~AudioChromaStream() {
+    if (m_sndfile) {
+        sf_close(m_sndfile);
+    }
+    if (m_adapter) {
+        delete m_adapter;
+    } else {
+        delete m_chroma;
+    }
+    delete m_frontEnd;
+}
+
+bool AudioChromaStream::read(ChromagramBuffer *chromagram) {
+    if (m_status != Status::AUDIOCHROMASTREAM_STREAMING) {
+        return false;
+    }
+    if (m_frontEnd) {
+        return readChunks(chromagram);
+    }
+    Vamp::Plugin::FeatureSet fs;
+    const std::size_t numberOfFrames = chromagram->getNumberOfFrames();
+    while (chromagram->getNumberOfFrames() == numberOfFrames) {
+        Vamp::RealTime timestamp =
+            Vamp::RealTime::frame2RealTime(m_frame, m_sfinfo.samplerate);
+        if (!readBlock(&m_mixBuffer[0])) {
+            // Whatever the plugin still holds
+            fs = m_adapter->getRemainingFeatures();
+            appendFeatures(fs[m_chromaFeatureNo], chromagram);
+            m_status = Status::AUDIOCHROMASTREAM_READY;
+            break;
+        }
+
+        float *mixbuf = &m_mixBuffer[0];
+        fs = m_adapter->process(&mixbuf, timestamp);
+        appendFeatures(fs[m_chromaFeatureNo], chromagram);
+    }
+    m_parameters.tuning = m_chroma->getEstimatedTuning();
+    return true;
+}
+
+bool AudioChromaStream::readBlock(float *mixbuf) {
+    int count = -1;
+    if (!m_sndfile || m_frame >= m_sfinfo.frames || (count = sf_readf_float(
+            m_sndfile, &m_fileBuffer[0], m_blockSize)) <= 0) {
+        if (m_sndfile) {
+            sf_close(m_sndfile);
+            m_sndfile = NULL;
+        }
+        return false;
+    }
+
+    for (int i = 0; i < m_blockSize; ++i) {
+        mixbuf[i] = 0.f;
+        if (i < count) {
+            for (int c = 0; c < m_sfinfo.channels; ++c) {
+                mixbuf[i] +=
+                    m_fileBuffer[i * m_sfinfo.channels + c] /
+                    m_sfinfo.channels;
+            }
+        }
+    }
+
+    m_frame += count;
+    return true;
+}
+
+bool AudioChromaStream::readChunks(ChromagramBuffer *chromagram) {
+    while (m_frontEnd->needsBlocks()) {
+        if (!readBlock(&m_mixBuffer[0])) {
+            m_frontEnd->endSignal();
+            break;
+        }
+        m_frontEnd->appendBlock(&m_mixBuffer[0]);
+    }
+    Vamp::Plugin::FeatureList logSpectra;
+    m_frontEnd->process(&logSpectra);
+    // The plugin takes the spectra in time order
+    Vamp::Plugin::FeatureSet fs;
+    for (std::size_t i = 0; i < logSpectra.size(); i++) {
+        fs = m_chroma->processLogFrequencySpectrum(logSpectra[i]);
+        appendFeatures(fs[m_chromaFeatureNo], chromagram);
+    }
+    if (m_frontEnd->isDone()) {
+        fs = m_chroma->getRemainingFeatures();
+        appendFeatures(fs[m_chromaFeatureNo], chromagram);
+        m_status = Status::AUDIOCHROMASTREAM_READY;
+    }
+    m_parameters.tuning = m_chroma->getEstimatedTuning();
+    return true;
+}
+
+void AudioChromaStream::getNNLSParameters(
+    const NNLSChroma &chroma,
+    ChromagramCache::Parameters *parameters) {
+    parameters->stepSize = chroma.getPreferredStepSize();
+    parameters->useNNLS = chroma.getParameter("useNNLS");
+    parameters->whitening = chroma.getParameter("whitening");
+    parameters->spectralShape = chroma.getParameter("s");
+    parameters->rollOn = chroma.getParameter("rollon");
+    parameters->boostN = chroma.getParameter("boostn");
+    parameters->tuningMode = chroma.getParameter("tuningmode");
+    parameters->chromaNormalize = chroma.getParameter("chromanormalize");
+}
+
+const ChromagramCache::Parameters &AudioChromaStream::getParameters() const {
+    return m_parameters;
+}
+
+int AudioChromaStream::getStatus() const {
+    return m_status;
+}
+
+NNLSChroma::NNLSStatistics AudioChromaStream::getNNLSStatistics() const {
+    return m_chroma->getNNLSStatistics();
+}
+
+void AudioChromaStream::appendFeatures(
+    const Vamp::Plugin::FeatureList &chromaFeatures,
+    ChromagramBuffer *chromagram) {
+    int pcIndex;
+    double timestamp;
+    for (int i = 0; i < static_cast<int>(chromaFeatures.size()); ++i) {
+        timestamp = std::stof(chromaFeatures[i].timestamp.toString());
+        float *chrVector = chromagram->appendFrame(timestamp);
+        for (std::size_t c = 0; c < chromaFeatures[i].values.size(); c++) {
+            pcIndex =
+                (PitchClass::PITCHCLASS_A_NATURAL + c)
+                % PitchClass::NUMBER_OF_PITCHCLASSES;
+            chrVector[pcIndex] = chromaFeatures[i].values[c];
+        }
+    }
+}
+
+}  // namespace justkeydding
@@ -28,54 +28,138 @@ SOFTWARE.
 
 namespace justkeydding {
 
-Chromagram::Chromagram(std::string fileName, enFileType fileType) {
+Chromagram::Chromagram(
+    std::string fileName,
+    enFileType fileType,
+    FeatureCache *featureCache,
+    int numberOfThreads,
+    int nnlsSolver) {
     m_status = Status::CHROMAGRAM_UNINITIALIZED;
+    std::string cacheKey;
     switch (fileType) {
         case FILETYPE_CSV:
             getChromagramFromCsv(fileName);
             break;
         case FILETYPE_AUDIO:
-            getChromagramFromAudio(fileName);
+            if (featureCache) {
+                cacheKey = featureCache->getKey(
+                    fileName, getExtractionSignature(nnlsSolver));
+            }
+            if (!cacheKey.empty() && featureCache->findChromagram(
+                    cacheKey, &m_chromagram, &m_parameters)) {
+                m_status = Status::CHROMAGRAM_ORIGINAL_READY;
+                break;
+            }
+            getChromagramFromAudio(fileName, numberOfThreads, nnlsSolver);
+            if (!cacheKey.empty() &&
+                m_status == Status::CHROMAGRAM_ORIGINAL_READY) {
+                featureCache->storeChromagram(
+                    cacheKey, m_chromagram, m_parameters);
+            }
+            break;
+        case FILETYPE_CACHE:
+            getChromagramFromCache(fileName);
             break;
     }
     if (m_status == Status::CHROMAGRAM_ORIGINAL_READY) {
-        discretizeChromagram();
+        // In time order, the discrete values are taken when needed
+        m_chromagram.sortByTimestamp();
+        m_status = Status::CHROMAGRAM_DISCRETE_READY;
     }
 }
 
 PitchClass::PitchClassSequence Chromagram::getPitchClassSequence() {
     PitchClass::PitchClassSequence pitchClassSequence;
-    for (ChromagramMap::const_iterator itChr = m_discreteChromagramMap.begin();
-        itChr != m_discreteChromagramMap.end(); itChr++) {
-        if (itChr->second == std::next(itChr)->second) {
+    const std::size_t numberOfFrames = m_chromagram.getNumberOfFrames();
+    for (std::size_t frame = 0; frame < numberOfFrames; frame++) {
+        if (frame + 1 < numberOfFrames &&
+            m_chromagram.isSameDiscreteFrame(frame, frame + 1)) {
             continue;
         }
-        ChromagramVector chrVector = itChr->second;
-        for (int pc = 0; pc < chrVector.size(); pc++) {
-            int n = static_cast<int>(chrVector[pc]);
-            if (n) n--;
-            while (n) {
-                pitchClassSequence.push_back(PitchClass(pc));
-                n--;
-            }
-        }
+        appendPitchClasses(m_chromagram, frame, &pitchClassSequence);
     }
     return pitchClassSequence;
 }
 
+void Chromagram::appendPitchClasses(
+    const ChromagramBuffer &chromagram,
+    std::size_t frame,
+    PitchClass::PitchClassSequence *pitchClassSequence) {
+    for (int pc = 0; pc < PitchClass::NUMBER_OF_PITCHCLASSES; pc++) {
+        int n = chromagram.getDiscreteChroma(frame, pc);
+        if (n) n--;
+        while (n) {
+            pitchClassSequence->push_back(PitchClass(pc));
+            n--;
+        }
+    }
+}
+
+Chromagram::ChromagramSequence Chromagram::getChromagramSequence() {
+    const std::size_t numberOfFrames = m_chromagram.getNumberOfFrames();
+    ChromagramSequence chromagramSequence(numberOfFrames);
+    for (std::size_t frame = 0; frame < numberOfFrames; frame++) {
+        const float *chrVector = m_chromagram.getFrame(frame);
+        std::copy(chrVector, chrVector + PitchClass::NUMBER_OF_PITCHCLASSES,
+            chromagramSequence[frame].begin());
+    }
+    return chromagramSequence;
+}
+
+const ChromagramBuffer &Chromagram::getChromagramBuffer() const {
+    return m_chromagram;
+}
+
+const ChromagramCache::Parameters &Chromagram::getParameters() const {
+    return m_parameters;
+}
+
+const NNLSChroma::NNLSStatistics &Chromagram::getNNLSStatistics() const {
+    return m_nnlsStatistics;
+}
+
+std::string Chromagram::getExtractionSignature(int nnlsSolver) {
+    NNLSChroma chroma(44100);
+    ChromagramCache::Parameters parameters;
+    AudioChromaStream::getNNLSParameters(chroma, &parameters);
+    std::ostringstream signature;
+    signature << chroma.getIdentifier()
+        << " version " << chroma.getPluginVersion()
+        << " cache " << ChromagramCache::VERSION
+        << " block " << chroma.getPreferredBlockSize()
+        << " step " << parameters.stepSize
+        << " useNNLS " << parameters.useNNLS
+        << " whitening " << parameters.whitening
+        << " s " << parameters.spectralShape
+        << " rollon " << parameters.rollOn
+        << " boostn " << parameters.boostN
+        << " tuningmode " << parameters.tuningMode
+        << " chromanormalize " << parameters.chromaNormalize;
+    // Other solvers agree with the default one to rounding only
+    if (nnlsSolver != NNLSChroma::LawsonHansonSolver) {
+        signature << " solver " << nnlsSolver;
+    }
+    return signature.str();
+}
+
+bool Chromagram::writeChromagramCache(std::string cacheFilename) const {
+    if (m_status != Status::CHROMAGRAM_ORIGINAL_READY &&
+        m_status != Status::CHROMAGRAM_DISCRETE_READY) {
+        return false;
+    }
+    return ChromagramCache::write(cacheFilename, m_chromagram, m_parameters);
+}
+
 void Chromagram::printChromagram() {
     if (m_status != Status::CHROMAGRAM_ORIGINAL_READY &&
         m_status != Status::CHROMAGRAM_DISCRETE_READY) {
         return;
     }
-    for (ChromagramMap::const_iterator itChr = m_discreteChromagramMap.begin();
-         itChr != m_discreteChromagramMap.end(); itChr++) {
-        double timestamp = itChr->first;
-        ChromagramVector chrVector = itChr->second;
-        std::cout << timestamp;
-        for (ChromagramVector::const_iterator itChrVector = chrVector.begin();
-            itChrVector != chrVector.end(); itChrVector++) {
-            std::cout << "," << (*itChrVector);
+    for (std::size_t frame = 0; frame < m_chromagram.getNumberOfFrames();
+         frame++) {
+        std::cout << m_chromagram.getTimestamp(frame);
+        for (int pc = 0; pc < PitchClass::NUMBER_OF_PITCHCLASSES; pc++) {
+            std::cout << "," << m_chromagram.getDiscreteChroma(frame, pc);
         }
         std::cout << std::endl;
     }
@@ -86,160 +170,52 @@ void Chromagram::printOriginalChromagram(bool startOnANatural=true) {
         m_status != Status::CHROMAGRAM_DISCRETE_READY) {
         return;
     }
-    for (ChromagramMap::const_iterator itChr = m_originalChromagramMap.begin();
-            itChr != m_originalChromagramMap.end(); itChr++) {
-        double timestamp = itChr->first;
-        ChromagramVector chrVector = itChr->second;
-        std::cout << timestamp;
-        for (int i = 0; i < chrVector.size(); i++) {
-            int index = i;
-            if (startOnANatural) {
-                index = (PitchClass::PITCHCLASS_A_NATURAL + i) % PitchClass::NUMBER_OF_PITCHCLASSES;
-            }
-            std::cout << "," << chrVector[index];
-        }
-        std::cout << std::endl;
-    }
+    m_chromagram.writeCsv(std::cout, startOnANatural);
 }
 
 void Chromagram::getChromagramFromCsv(std::string csvFilename) {
-    std::ifstream infile;
-    infile.open(csvFilename);
-    if (!infile.is_open()) {
+    ChromagramCsvReader reader(csvFilename);
+    reader.read();
+    if (reader.getStatus() != Status::CHROMAGRAMCSVREADER_READY) {
         m_status = Status::CHROMAGRAM_INPUTFILE_ERROR;
         return;
     }
-    std::string line;
-    double timeStamp = 0.0;
-    while (std::getline(infile, line)) {
-        std::istringstream sstr(line);
-        std::string token;
-        int i = 0;
-        while ( std::getline(sstr, token, ',') ) {
-            if (i == 0) {
-                timeStamp = std::stof(token);
-            } else {
-                // NNLS orders chromagrams from A-G#
-                // we want to store them as C-B instead
-                int pcIndex =
-                    (PitchClass::PITCHCLASS_A_NATURAL + (i-1))
-                    % PitchClass::NUMBER_OF_PITCHCLASSES;
-                m_originalChromagramMap[timeStamp][pcIndex] =
-                    std::stof(token);
-            }
-            i++;
-        }
-    }
-    infile.close();
+    m_chromagram = reader.getChromagramBuffer();
     m_status = Status::CHROMAGRAM_ORIGINAL_READY;
     return;
 }
 
-void Chromagram::getChromagramFromAudio(std::string audioFile) {
-    SF_INFO sfinfo;
-    SNDFILE *sndfile = sf_open(audioFile.c_str(), SFM_READ, &sfinfo);
-    if (!sndfile) {
+void Chromagram::getChromagramFromCache(std::string cacheFilename) {
+    ChromagramCache cache(cacheFilename);
+    if (cache.getStatus() != Status::CHROMAGRAMCACHE_READY) {
         m_status = Status::CHROMAGRAM_INPUTFILE_ERROR;
         return;
     }
-    NNLSChroma *chroma = new NNLSChroma(sfinfo.samplerate);
-    Vamp::HostExt::PluginInputDomainAdapter *ia =
-    new Vamp::HostExt::PluginInputDomainAdapter(chroma);
-    ia->setProcessTimestampMethod(
-        Vamp::HostExt::PluginInputDomainAdapter::ShiftData);
-    Vamp::HostExt::PluginBufferingAdapter *adapter =
-    new Vamp::HostExt::PluginBufferingAdapter(ia);
-
-    int blocksize = adapter->getPreferredBlockSize();
-
-    if (!adapter->initialise(1, blocksize, blocksize)) {
-        m_status = Status::CHROMAGRAM_NNLS_ERROR;
-        return;
-    }
-
-    float *filebuf = new float[sfinfo.channels * blocksize];
-    float *mixbuf = new float[blocksize];
-
-    Vamp::Plugin::FeatureList chromaFeatures;
-    Vamp::Plugin::FeatureSet fs;
-
-    int chromaFeatureNo = -1;
-    Vamp::Plugin::OutputList outputs = adapter->getOutputDescriptors();
-    for (int i = 0; i < static_cast<int>(outputs.size()); ++i) {
-        if (outputs[i].identifier == "chroma") {
-            chromaFeatureNo = i;
-        }
-    }
-    if (chromaFeatureNo < 0) {
-        m_status = Status::CHROMAGRAM_NNLS_ERROR;
-        return;
-    }
-
-    int frame = 0;
-    while (frame < sfinfo.frames) {
-        int count = -1;
-        if ((count = sf_readf_float(sndfile, filebuf, blocksize)) <= 0) break;
-
-        for (int i = 0; i < blocksize; ++i) {
-            mixbuf[i] = 0.f;
-            if (i < count) {
-                for (int c = 0; c < sfinfo.channels; ++c) {
-                    mixbuf[i] +=
-                        filebuf[i * sfinfo.channels + c] / sfinfo.channels;
-                }
-            }
-        }
-
-        Vamp::RealTime timestamp =
-            Vamp::RealTime::frame2RealTime(frame, sfinfo.samplerate);
-
-        fs = adapter->process(&mixbuf, timestamp);
-
-        chromaFeatures.insert(chromaFeatures.end(),
-            fs[chromaFeatureNo].begin(),
-            fs[chromaFeatureNo].end());
-
-        frame += count;
-    }
-
-    sf_close(sndfile);
-
-    fs = adapter->getRemainingFeatures();
-
-    chromaFeatures.insert(chromaFeatures.end(),
-        fs[chromaFeatureNo].begin(),
-        fs[chromaFeatureNo].end());
-    int pcIndex;
-    double timestamp;
-    for (int i = 0; i < static_cast<int>(chromaFeatures.size()); ++i) {
-        timestamp = std::stof(chromaFeatures[i].timestamp.toString());
-        for (int c = 0; c < chromaFeatures[i].values.size(); c++) {
-            pcIndex =
-                (PitchClass::PITCHCLASS_A_NATURAL + c)
-                % PitchClass::NUMBER_OF_PITCHCLASSES;
-            m_originalChromagramMap[timestamp][pcIndex] =
-                chromaFeatures[i].values[c];
-        }
-    }
-
-    delete[] filebuf;
-    delete[] mixbuf;
-
-    delete adapter;
+    m_chromagram = cache.getChromagramBuffer();
+    m_parameters = cache.getParameters();
     m_status = Status::CHROMAGRAM_ORIGINAL_READY;
 }
 
-void Chromagram::discretizeChromagram() {
-    for (ChromagramMap::const_iterator itChr = m_originalChromagramMap.begin();
-            itChr != m_originalChromagramMap.end(); itChr++) {
-        ChromagramVector chrVector = itChr->second;
-        for (int i = 0; i < chrVector.size(); i++) {
-            double discreteMagnitude = std::floor(chrVector[i]);
-            m_discreteChromagramMap[itChr->first][i] = discreteMagnitude;
-        }
+void Chromagram::getChromagramFromAudio(
+    std::string audioFile,
+    int numberOfThreads,
+    int nnlsSolver) {
+    AudioChromaStream stream(audioFile, -1, numberOfThreads, nnlsSolver);
+    while (stream.read(&m_chromagram)) {
+    }
+    m_nnlsStatistics = stream.getNNLSStatistics();
+    switch (stream.getStatus()) {
+        case Status::AUDIOCHROMASTREAM_READY:
+            m_parameters = stream.getParameters();
+            m_status = Status::CHROMAGRAM_ORIGINAL_READY;
+            break;
+        case Status::AUDIOCHROMASTREAM_INPUTFILE_ERROR:
+            m_status = Status::CHROMAGRAM_INPUTFILE_ERROR;
+            break;
+        default:
+            m_status = Status::CHROMAGRAM_NNLS_ERROR;
+            break;
     }
-    m_status = Status::CHROMAGRAM_DISCRETE_READY;
-    return;
 }
 
 int Chromagram::getStatus() const {
@@ -0,0 +1,163 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Contiguous frame-major storage of a chromagram
+
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "./chromagrambuffer.h"
+
+#include<algorithm>
+#include<cmath>
+#include<limits>
+#include<utility>
+
+namespace justkeydding {
+
+static const int NUMBER_OF_PITCHCLASSES = PitchClass::NUMBER_OF_PITCHCLASSES;
+
+ChromagramBuffer::ChromagramBuffer() {
+}
+
+ChromagramBuffer::ChromagramBuffer(
+    TimestampVector timestamps,
+    FrameMatrix frames) :
+    m_timestamps(std::move(timestamps)),
+    m_frames(std::move(frames)) {
+    m_frames.resize(m_timestamps.size() * NUMBER_OF_PITCHCLASSES, 0.0f);
+}
+
+void ChromagramBuffer::reserve(std::size_t numberOfFrames) {
+    m_timestamps.reserve(numberOfFrames);
+    m_frames.reserve(numberOfFrames * NUMBER_OF_PITCHCLASSES);
+}
+
+float *ChromagramBuffer::appendFrame(double timestamp) {
+    m_timestamps.push_back(timestamp);
+    m_frames.resize(m_frames.size() + NUMBER_OF_PITCHCLASSES, 0.0f);
+    return &m_frames[m_frames.size() - NUMBER_OF_PITCHCLASSES];
+}
+
+void ChromagramBuffer::sortByTimestamp() {
+    const std::size_t numberOfFrames = m_timestamps.size();
+    bool sorted = true;
+    for (std::size_t frame = 1; frame < numberOfFrames && sorted; frame++) {
+        sorted = m_timestamps[frame - 1] < m_timestamps[frame];
+    }
+    if (sorted) {
+        return;
+    }
+    std::vector<std::size_t> order(numberOfFrames);
+    for (std::size_t frame = 0; frame < numberOfFrames; frame++) {
+        order[frame] = frame;
+    }
+    const TimestampVector &timestamps = m_timestamps;
+    std::stable_sort(order.begin(), order.end(),
+        [&timestamps](std::size_t a, std::size_t b) {
+            return timestamps[a] < timestamps[b];
+        });
+    TimestampVector sortedTimestamps;
+    FrameMatrix sortedFrames;
+    sortedTimestamps.reserve(numberOfFrames);
+    sortedFrames.reserve(numberOfFrames * NUMBER_OF_PITCHCLASSES);
+    for (std::size_t i = 0; i < numberOfFrames; i++) {
+        // A later frame with the same timestamp replaces this one
+        if (i + 1 < numberOfFrames &&
+            m_timestamps[order[i]] == m_timestamps[order[i + 1]]) {
+            continue;
+        }
+        const float *frame = getFrame(order[i]);
+        sortedTimestamps.push_back(m_timestamps[order[i]]);
+        sortedFrames.insert(sortedFrames.end(),
+            frame, frame + NUMBER_OF_PITCHCLASSES);
+    }
+    m_timestamps.swap(sortedTimestamps);
+    m_frames.swap(sortedFrames);
+}
+
+std::size_t ChromagramBuffer::getNumberOfFrames() const {
+    return m_timestamps.size();
+}
+
+bool ChromagramBuffer::isEmpty() const {
+    return m_timestamps.empty();
+}
+
+double ChromagramBuffer::getTimestamp(std::size_t frame) const {
+    return m_timestamps[frame];
+}
+
+const float *ChromagramBuffer::getFrame(std::size_t frame) const {
+    return &m_frames[frame * NUMBER_OF_PITCHCLASSES];
+}
+
+int ChromagramBuffer::getDiscreteChroma(
+    std::size_t frame,
+    int pitchClass) const {
+    return static_cast<int>(
+        std::floor(m_frames[frame * NUMBER_OF_PITCHCLASSES + pitchClass]));
+}
+
+bool ChromagramBuffer::isSameDiscreteFrame(
+    std::size_t frame,
+    std::size_t other) const {
+    for (int pc = 0; pc < NUMBER_OF_PITCHCLASSES; pc++) {
+        if (getDiscreteChroma(frame, pc) != getDiscreteChroma(other, pc)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const ChromagramBuffer::TimestampVector &
+ChromagramBuffer::getTimestamps() const {
+    return m_timestamps;
+}
+
+const ChromagramBuffer::FrameMatrix &ChromagramBuffer::getFrames() const {
+    return m_frames;
+}
+
+void ChromagramBuffer::writeCsv(
+    std::ostream &out,
+    bool startOnANatural) const {
+    std::streamsize precision =
+        out.precision(std::numeric_limits<float>::max_digits10);
+    for (std::size_t frame = 0; frame < getNumberOfFrames(); frame++) {
+        const float *chrVector = getFrame(frame);
+        out << m_timestamps[frame];
+        for (int i = 0; i < NUMBER_OF_PITCHCLASSES; i++) {
+            int index = i;
+            if (startOnANatural) {
+                index = (PitchClass::PITCHCLASS_A_NATURAL + i) %
+                    NUMBER_OF_PITCHCLASSES;
+            }
+            out << "," << chrVector[index];
+        }
+        out << '\n';
+    }
+    out.flush();
+    out.precision(precision);
+}
+
+}  // namespace justkeydding
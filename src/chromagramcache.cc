@@ -0,0 +1,250 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Binary chromagram cache, memory-mapped on load
+
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "./chromagramcache.h"
+
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<fcntl.h>
+#include<unistd.h>
+
+#include<cstdio>
+#include<cstring>
+#include<fstream>
+#include<sstream>
+#include<vector>
+
+namespace justkeydding {
+
+const std::uint32_t ChromagramCache::VERSION;
+
+static const char MAGIC[8] = {'J', 'K', 'D', 'C', 'H', 'R', 'O', 'M'};
+static const std::size_t SECTION_ALIGNMENT = 64;
+static const int NUMBER_OF_PITCHCLASSES = PitchClass::NUMBER_OF_PITCHCLASSES;
+
+struct ChromagramCache::Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t numberOfPitchClasses;
+    std::uint64_t numberOfFrames;
+    double sampleRate;
+    std::uint32_t blockSize;
+    std::uint32_t stepSize;
+    float useNNLS;
+    float whitening;
+    float spectralShape;
+    float rollOn;
+    float boostN;
+    float tuningMode;
+    float chromaNormalize;
+    float tuning;
+    std::uint64_t timestampsOffset;
+    std::uint64_t framesOffset;
+    std::uint64_t fileSize;
+};
+
+static bool isLittleEndian() {
+    const std::uint16_t one = 1;
+    return *reinterpret_cast<const unsigned char *>(&one) == 1;
+}
+
+static std::size_t align(std::size_t offset) {
+    return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT *
+        SECTION_ALIGNMENT;
+}
+
+ChromagramCache::Parameters::Parameters() :
+    sampleRate(0.0),
+    blockSize(0),
+    stepSize(0),
+    useNNLS(0.0f),
+    whitening(0.0f),
+    spectralShape(0.0f),
+    rollOn(0.0f),
+    boostN(0.0f),
+    tuningMode(0.0f),
+    chromaNormalize(0.0f),
+    tuning(0.0f) {
+}
+
+ChromagramCache::ChromagramCache(const std::string &fileName) :
+    m_status(Status::CHROMAGRAMCACHE_UNINITIALIZED),
+    m_numberOfFrames(0),
+    m_timestamps(NULL),
+    m_frames(NULL) {
+    int fileDescriptor = open(fileName.c_str(), O_RDONLY);
+    if (fileDescriptor == -1) {
+        m_status = Status::CHROMAGRAMCACHE_INPUTFILE_ERROR;
+        return;
+    }
+    struct stat fileStatus;
+    if (fstat(fileDescriptor, &fileStatus) != 0) {
+        close(fileDescriptor);
+        m_status = Status::CHROMAGRAMCACHE_INPUTFILE_ERROR;
+        return;
+    }
+    const std::size_t fileSize = fileStatus.st_size;
+    if (fileSize < sizeof(Header)) {
+        close(fileDescriptor);
+        m_status = Status::CHROMAGRAMCACHE_FORMAT_ERROR;
+        return;
+    }
+    void *address =
+        mmap(NULL, fileSize, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+    close(fileDescriptor);
+    if (address == MAP_FAILED) {
+        m_status = Status::CHROMAGRAMCACHE_INPUTFILE_ERROR;
+        return;
+    }
+    m_mapping = std::shared_ptr<const void>(address,
+        [fileSize](const void *mapping) {
+            munmap(const_cast<void *>(mapping), fileSize);
+        });
+    const char *base = static_cast<const char *>(address);
+    const Header *header = reinterpret_cast<const Header *>(base);
+    const std::uint64_t frameSize = sizeof(float) * NUMBER_OF_PITCHCLASSES;
+    if (!isLittleEndian() ||
+        std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header->version != VERSION ||
+        header->numberOfPitchClasses != NUMBER_OF_PITCHCLASSES ||
+        header->fileSize != fileSize ||
+        header->timestampsOffset % sizeof(double) != 0 ||
+        header->framesOffset % sizeof(float) != 0 ||
+        header->timestampsOffset > fileSize ||
+        header->framesOffset > fileSize ||
+        header->numberOfFrames >
+            (fileSize - header->timestampsOffset) / sizeof(double) ||
+        header->numberOfFrames >
+            (fileSize - header->framesOffset) / frameSize) {
+        m_mapping.reset();
+        m_status = Status::CHROMAGRAMCACHE_FORMAT_ERROR;
+        return;
+    }
+    m_parameters.sampleRate = header->sampleRate;
+    m_parameters.blockSize = header->blockSize;
+    m_parameters.stepSize = header->stepSize;
+    m_parameters.useNNLS = header->useNNLS;
+    m_parameters.whitening = header->whitening;
+    m_parameters.spectralShape = header->spectralShape;
+    m_parameters.rollOn = header->rollOn;
+    m_parameters.boostN = header->boostN;
+    m_parameters.tuningMode = header->tuningMode;
+    m_parameters.chromaNormalize = header->chromaNormalize;
+    m_parameters.tuning = header->tuning;
+    m_numberOfFrames = header->numberOfFrames;
+    m_timestamps =
+        reinterpret_cast<const double *>(base + header->timestampsOffset);
+    m_frames = reinterpret_cast<const float *>(base + header->framesOffset);
+    m_status = Status::CHROMAGRAMCACHE_READY;
+}
+
+int ChromagramCache::getStatus() const {
+    return m_status;
+}
+
+const ChromagramCache::Parameters &ChromagramCache::getParameters() const {
+    return m_parameters;
+}
+
+std::size_t ChromagramCache::getNumberOfFrames() const {
+    return m_numberOfFrames;
+}
+
+const double *ChromagramCache::getTimestamps() const {
+    return m_timestamps;
+}
+
+const float *ChromagramCache::getFrames() const {
+    return m_frames;
+}
+
+ChromagramBuffer ChromagramCache::getChromagramBuffer() const {
+    if (m_status != Status::CHROMAGRAMCACHE_READY) {
+        return ChromagramBuffer();
+    }
+    return ChromagramBuffer(
+        ChromagramBuffer::TimestampVector(
+            m_timestamps, m_timestamps + m_numberOfFrames),
+        ChromagramBuffer::FrameMatrix(
+            m_frames, m_frames + m_numberOfFrames * NUMBER_OF_PITCHCLASSES));
+}
+
+bool ChromagramCache::write(
+    const std::string &fileName,
+    const ChromagramBuffer &chromagram,
+    const Parameters &parameters) {
+    if (!isLittleEndian()) {
+        return false;
+    }
+    const std::size_t numberOfFrames = chromagram.getNumberOfFrames();
+    Header header;
+    std::memset(&header, 0, sizeof(Header));
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.numberOfPitchClasses = NUMBER_OF_PITCHCLASSES;
+    header.numberOfFrames = numberOfFrames;
+    header.sampleRate = parameters.sampleRate;
+    header.blockSize = parameters.blockSize;
+    header.stepSize = parameters.stepSize;
+    header.useNNLS = parameters.useNNLS;
+    header.whitening = parameters.whitening;
+    header.spectralShape = parameters.spectralShape;
+    header.rollOn = parameters.rollOn;
+    header.boostN = parameters.boostN;
+    header.tuningMode = parameters.tuningMode;
+    header.chromaNormalize = parameters.chromaNormalize;
+    header.tuning = parameters.tuning;
+    header.timestampsOffset = align(sizeof(Header));
+    header.framesOffset = align(
+        header.timestampsOffset + numberOfFrames * sizeof(double));
+    header.fileSize = header.framesOffset +
+        numberOfFrames * NUMBER_OF_PITCHCLASSES * sizeof(float);
+    std::vector<char> buffer(header.fileSize, 0);
+    std::memcpy(&buffer[0], &header, sizeof(Header));
+    if (numberOfFrames > 0) {
+        std::memcpy(&buffer[header.timestampsOffset],
+            &chromagram.getTimestamps()[0], numberOfFrames * sizeof(double));
+        std::memcpy(&buffer[header.framesOffset],
+            &chromagram.getFrames()[0],
+            numberOfFrames * NUMBER_OF_PITCHCLASSES * sizeof(float));
+    }
+    // Written aside and renamed, so that readers never map half a file,
+    // under a name of its own in case other processes write it too
+    std::ostringstream temporaryFileName;
+    temporaryFileName << fileName << ".tmp." << getpid();
+    std::ofstream outfile(temporaryFileName.str().c_str(), std::ios::binary);
+    outfile.write(&buffer[0], buffer.size());
+    outfile.close();
+    if (!outfile ||
+        std::rename(temporaryFileName.str().c_str(), fileName.c_str()) != 0) {
+        std::remove(temporaryFileName.str().c_str());
+        return false;
+    }
+    return true;
+}
+
+}  // namespace justkeydding
@@ -0,0 +1,407 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Memory-mapped reader of Sonic Annotator chromagram CSV files
+
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "./chromagramcsvreader.h"
+
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<fcntl.h>
+#include<unistd.h>
+
+#include<algorithm>
+#include<cerrno>
+#include<chrono>
+#include<cstdint>
+#include<cstdlib>
+#include<cstring>
+#include<thread>
+#include<utility>
+
+namespace justkeydding {
+
+const std::size_t ChromagramCsvReader::MINIMUM_BYTES_PER_THREAD;
+
+static const int NUMBER_OF_PITCHCLASSES = PitchClass::NUMBER_OF_PITCHCLASSES;
+
+// Longest decimal mantissa accumulated without overflowing 64 bits
+static const int MAXIMUM_DIGITS = 19;
+
+// Powers of ten exactly representable as doubles
+static const double POWERS_OF_TEN[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+static const int MAXIMUM_EXACT_POWER = 22;
+static const std::uint64_t MAXIMUM_EXACT_MANTISSA = 1ULL << 53;
+
+static bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static const char *skipBlanks(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+        p++;
+    }
+    return p;
+}
+
+// Whether rounding this double to float hits a tie between two floats,
+// which the double may not have inherited from the decimal value
+static bool isFloatTie(double value) {
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const std::uint64_t droppedBits = (1ULL << 29) - 1;
+    return (bits & droppedBits) == (1ULL << 28);
+}
+
+// Same value as std::stof, but without a null-terminated string. The
+// decimal mantissa and the power of ten are exact doubles, so their
+// product or quotient is correctly rounded (Clinger's fast path), and
+// rounding that to float again is exact unless it lands on a tie.
+static bool parseFloat(const char **position, const char *end, float *value) {
+    const char *start = skipBlanks(*position, end);
+    const char *p = start;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+    std::uint64_t mantissa = 0;
+    int numberOfDigits = 0;
+    int exponent = 0;
+    bool hasDigits = false;
+    bool fast = true;
+    while (p < end && isDigit(*p)) {
+        hasDigits = true;
+        if (numberOfDigits < MAXIMUM_DIGITS) {
+            mantissa = mantissa * 10 + (*p - '0');
+            numberOfDigits += mantissa != 0;
+        } else {
+            fast = false;
+        }
+        p++;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && isDigit(*p)) {
+            hasDigits = true;
+            if (numberOfDigits < MAXIMUM_DIGITS) {
+                mantissa = mantissa * 10 + (*p - '0');
+                numberOfDigits += mantissa != 0;
+                exponent--;
+            } else {
+                fast = false;
+            }
+            p++;
+        }
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char *q = p + 1;
+        bool negativeExponent = false;
+        if (q < end && (*q == '-' || *q == '+')) {
+            negativeExponent = *q == '-';
+            q++;
+        }
+        int explicitExponent = 0;
+        bool hasExponentDigits = false;
+        while (q < end && isDigit(*q)) {
+            hasExponentDigits = true;
+            if (explicitExponent < 100000) {
+                explicitExponent = explicitExponent * 10 + (*q - '0');
+            }
+            q++;
+        }
+        fast = fast && hasExponentDigits;
+        exponent += negativeExponent ? -explicitExponent : explicitExponent;
+        p = q;
+    }
+    if (fast && hasDigits && mantissa <= MAXIMUM_EXACT_MANTISSA &&
+        exponent >= -MAXIMUM_EXACT_POWER && exponent <= MAXIMUM_EXACT_POWER) {
+        double result = static_cast<double>(mantissa);
+        if (exponent < 0) {
+            result /= POWERS_OF_TEN[-exponent];
+        } else {
+            result *= POWERS_OF_TEN[exponent];
+        }
+        if (mantissa == 0 || !isFloatTie(result)) {
+            *value = static_cast<float>(negative ? -result : result);
+            *position = p;
+            return true;
+        }
+    }
+    // Slow path, on a null-terminated copy of the field
+    const char *fieldEnd = start;
+    while (fieldEnd < end && *fieldEnd != ',') {
+        fieldEnd++;
+    }
+    const std::string field(start, fieldEnd);
+    char *stop = NULL;
+    errno = 0;
+    const float result = std::strtof(field.c_str(), &stop);
+    if (stop == field.c_str() || errno == ERANGE) {
+        return false;
+    }
+    *value = result;
+    *position = start + (stop - field.c_str());
+    return true;
+}
+
+static std::size_t countLines(const char *begin, const char *end) {
+    std::size_t numberOfLines = 0;
+    const char *p = begin;
+    while (p < end) {
+        const char *newline =
+            static_cast<const char *>(std::memchr(p, '\n', end - p));
+        numberOfLines++;
+        if (!newline) {
+            break;
+        }
+        p = newline + 1;
+    }
+    return numberOfLines;
+}
+
+// Parses the lines from begin to end, one row per line with at least
+// one chroma value, false if a field is not a number
+static bool parseLines(
+    const char *begin,
+    const char *end,
+    double *timestamps,
+    float *frames,
+    std::size_t *numberOfFrames) {
+    std::size_t row = 0;
+    const char *p = begin;
+    while (p < end) {
+        const char *lineEnd =
+            static_cast<const char *>(std::memchr(p, '\n', end - p));
+        if (!lineEnd) {
+            lineEnd = end;
+        }
+        const char *q = skipBlanks(p, lineEnd);
+        p = lineEnd == end ? end : lineEnd + 1;
+        if (q == lineEnd) {
+            continue;
+        }
+        float timestamp;
+        if (!parseFloat(&q, lineEnd, &timestamp)) {
+            return false;
+        }
+        q = skipBlanks(q, lineEnd);
+        float *frame = frames + row * NUMBER_OF_PITCHCLASSES;
+        std::fill(frame, frame + NUMBER_OF_PITCHCLASSES, 0.0f);
+        int i = 0;
+        while (q < lineEnd && *q == ',') {
+            q++;
+            float chroma;
+            if (!parseFloat(&q, lineEnd, &chroma)) {
+                return false;
+            }
+            // NNLS orders chromagrams from A-G#
+            // we want to store them as C-B instead
+            frame[(PitchClass::PITCHCLASS_A_NATURAL + i) %
+                NUMBER_OF_PITCHCLASSES] = chroma;
+            q = skipBlanks(q, lineEnd);
+            i++;
+        }
+        if (q != lineEnd) {
+            return false;
+        }
+        if (i > 0) {
+            timestamps[row] = timestamp;
+            row++;
+        }
+    }
+    *numberOfFrames = row;
+    return true;
+}
+
+ChromagramCsvReader::ChromagramCsvReader(const std::string &fileName) :
+    m_status(Status::CHROMAGRAMCSVREADER_UNINITIALIZED),
+    m_fileName(fileName),
+    m_numberOfThreads(0),
+    m_numberOfBytes(0),
+    m_seconds(0.0) {
+}
+
+void ChromagramCsvReader::setNumberOfThreads(int numberOfThreads) {
+    m_numberOfThreads = std::max(numberOfThreads, 0);
+}
+
+void ChromagramCsvReader::read() {
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    m_chromagramBuffer = ChromagramBuffer();
+    m_numberOfBytes = 0;
+    int fileDescriptor = open(m_fileName.c_str(), O_RDONLY);
+    if (fileDescriptor == -1) {
+        m_status = Status::CHROMAGRAMCSVREADER_INPUTFILE_ERROR;
+        return;
+    }
+    struct stat fileStatus;
+    if (fstat(fileDescriptor, &fileStatus) != 0) {
+        close(fileDescriptor);
+        m_status = Status::CHROMAGRAMCSVREADER_INPUTFILE_ERROR;
+        return;
+    }
+    m_numberOfBytes = fileStatus.st_size;
+    ChromagramBuffer::TimestampVector timestamps;
+    ChromagramBuffer::FrameMatrix frames;
+    bool parsed = true;
+    if (m_numberOfBytes > 0) {
+        void *address = mmap(NULL, m_numberOfBytes, PROT_READ, MAP_PRIVATE,
+            fileDescriptor, 0);
+        if (address == MAP_FAILED) {
+            close(fileDescriptor);
+            m_status = Status::CHROMAGRAMCSVREADER_INPUTFILE_ERROR;
+            return;
+        }
+        madvise(address, m_numberOfBytes, MADV_SEQUENTIAL);
+        const char *begin = static_cast<const char *>(address);
+        parsed = parse(begin, begin + m_numberOfBytes, &timestamps, &frames);
+        munmap(address, m_numberOfBytes);
+    }
+    close(fileDescriptor);
+    m_seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    if (!parsed) {
+        m_status = Status::CHROMAGRAMCSVREADER_FORMAT_ERROR;
+        return;
+    }
+    m_chromagramBuffer =
+        ChromagramBuffer(std::move(timestamps), std::move(frames));
+    m_status = Status::CHROMAGRAMCSVREADER_READY;
+}
+
+bool ChromagramCsvReader::parse(
+    const char *begin,
+    const char *end,
+    ChromagramBuffer::TimestampVector *timestamps,
+    ChromagramBuffer::FrameMatrix *frames) {
+    const std::size_t numberOfBytes = end - begin;
+    std::size_t numberOfChunks = m_numberOfThreads;
+    if (numberOfChunks == 0) {
+        numberOfChunks = std::min<std::size_t>(
+            std::max(std::thread::hardware_concurrency(), 1u),
+            numberOfBytes / MINIMUM_BYTES_PER_THREAD);
+    }
+    numberOfChunks = std::max<std::size_t>(
+        std::min(numberOfChunks, numberOfBytes), 1);
+    // Chunk c holds the whole lines starting from chunkStart[c] to
+    // chunkStart[c + 1], and the rows from rowStart[c] on
+    std::vector<const char *> chunkStart(numberOfChunks + 1, end);
+    std::vector<std::size_t> rowStart(numberOfChunks + 1, 0);
+    chunkStart[0] = begin;
+    for (std::size_t chunk = 1; chunk < numberOfChunks; chunk++) {
+        const char *p = std::max(
+            begin + numberOfBytes * chunk / numberOfChunks,
+            chunkStart[chunk - 1]);
+        const char *newline =
+            static_cast<const char *>(std::memchr(p, '\n', end - p));
+        chunkStart[chunk] = newline ? newline + 1 : end;
+    }
+    for (std::size_t chunk = 0; chunk < numberOfChunks; chunk++) {
+        rowStart[chunk + 1] = rowStart[chunk] +
+            countLines(chunkStart[chunk], chunkStart[chunk + 1]);
+    }
+    timestamps->resize(rowStart[numberOfChunks]);
+    frames->resize(rowStart[numberOfChunks] * NUMBER_OF_PITCHCLASSES);
+    std::vector<std::size_t> numberOfFrames(numberOfChunks, 0);
+    std::vector<char> parsed(numberOfChunks, 0);
+    std::vector<std::thread> threads;
+    for (std::size_t chunk = 0; chunk < numberOfChunks; chunk++) {
+        const char *first = chunkStart[chunk];
+        const char *last = chunkStart[chunk + 1];
+        double *chunkTimestamps = timestamps->data() + rowStart[chunk];
+        float *chunkFrames =
+            frames->data() + rowStart[chunk] * NUMBER_OF_PITCHCLASSES;
+        std::size_t *chunkNumberOfFrames = &numberOfFrames[chunk];
+        char *chunkParsed = &parsed[chunk];
+        if (numberOfChunks == 1) {
+            *chunkParsed = parseLines(
+                first, last, chunkTimestamps, chunkFrames,
+                chunkNumberOfFrames);
+            break;
+        }
+        std::thread thread([=]() {
+            *chunkParsed = parseLines(
+                first, last, chunkTimestamps, chunkFrames,
+                chunkNumberOfFrames);
+        });
+        threads.push_back(std::move(thread));
+    }
+    for (std::size_t thread = 0; thread < threads.size(); thread++) {
+        threads[thread].join();
+    }
+    // Close the gaps left by blank lines, in order
+    std::size_t row = 0;
+    for (std::size_t chunk = 0; chunk < numberOfChunks; chunk++) {
+        if (!parsed[chunk]) {
+            return false;
+        }
+        if (row != rowStart[chunk]) {
+            std::copy(
+                timestamps->begin() + rowStart[chunk],
+                timestamps->begin() + rowStart[chunk] + numberOfFrames[chunk],
+                timestamps->begin() + row);
+            std::copy(
+                frames->begin() + rowStart[chunk] * NUMBER_OF_PITCHCLASSES,
+                frames->begin() +
+                    (rowStart[chunk] + numberOfFrames[chunk]) *
+                    NUMBER_OF_PITCHCLASSES,
+                frames->begin() + row * NUMBER_OF_PITCHCLASSES);
+        }
+        row += numberOfFrames[chunk];
+    }
+    timestamps->resize(row);
+    frames->resize(row * NUMBER_OF_PITCHCLASSES);
+    return true;
+}
+
+int ChromagramCsvReader::getStatus() const {
+    return m_status;
+}
+
+const ChromagramBuffer &ChromagramCsvReader::getChromagramBuffer() const {
+    return m_chromagramBuffer;
+}
+
+std::size_t ChromagramCsvReader::getNumberOfBytes() const {
+    return m_numberOfBytes;
+}
+
+double ChromagramCsvReader::getSeconds() const {
+    return m_seconds;
+}
+
+double ChromagramCsvReader::getMegabytesPerSecond() const {
+    if (m_seconds <= 0.0) {
+        return 0.0;
+    }
+    return m_numberOfBytes / 1e6 / m_seconds;
+}
+
+}  // namespace justkeydding
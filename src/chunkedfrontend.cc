@@ -0,0 +1,197 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Spectral front end of NNLS Chroma, run on chunks of a signal at once
+
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include<thread>
+#include<algorithm>
+
+#include "./chunkedfrontend.h"
+
+namespace justkeydding {
+
+ChunkedFrontEnd::ChunkedFrontEnd(
+    int sampleRate,
+    int blockSize,
+    int numberOfFrontEnds,
+    int blocksPerChunk) :
+    m_ready(false),
+    m_sampleRate(sampleRate),
+    m_blockSize(blockSize),
+    m_blocksPerChunk(blocksPerChunk),
+    m_overlapBlocks(0),
+    m_firstBlock(0),
+    m_numberOfBlocks(0),
+    m_nextBlock(0),
+    m_endOfSignal(false) {
+    for (int thread = 0; thread < numberOfFrontEnds; thread++) {
+        NNLSChroma *chroma = new NNLSChroma(sampleRate);
+        chroma->setLogSpectrumOnly(true);
+        if (thread == 0) {
+            // Two analysis windows, and a block for the rounding
+            int windowBlocks = (chroma->getPreferredBlockSize() +
+                blockSize - 1) / blockSize;
+            m_overlapBlocks = 2 * windowBlocks + 1;
+        }
+        FrontEnd frontEnd;
+        frontEnd.adapter = makeAdapter(chroma);
+        frontEnd.logSpectrumFeatureNo = -1;
+        m_frontEnds.push_back(frontEnd);
+        if (!frontEnd.adapter->initialise(1, blockSize, blockSize)) {
+            return;
+        }
+        Vamp::Plugin::OutputList outputs =
+            frontEnd.adapter->getOutputDescriptors();
+        for (int i = 0; i < static_cast<int>(outputs.size()); ++i) {
+            if (outputs[i].identifier == "logfreqspec") {
+                m_frontEnds.back().logSpectrumFeatureNo = i;
+            }
+        }
+        if (m_frontEnds.back().logSpectrumFeatureNo < 0) {
+            return;
+        }
+    }
+    m_ready = !m_frontEnds.empty() && blocksPerChunk > 0;
+}
+
+ChunkedFrontEnd::~ChunkedFrontEnd() {
+    for (std::size_t i = 0; i < m_frontEnds.size(); i++) {
+        delete m_frontEnds[i].adapter;
+    }
+}
+
+Vamp::HostExt::PluginBufferingAdapter *ChunkedFrontEnd::makeAdapter(
+    NNLSChroma *chroma) {
+    Vamp::HostExt::PluginInputDomainAdapter *ia =
+    new Vamp::HostExt::PluginInputDomainAdapter(chroma);
+    ia->setProcessTimestampMethod(
+        Vamp::HostExt::PluginInputDomainAdapter::ShiftData);
+    return new Vamp::HostExt::PluginBufferingAdapter(ia);
+}
+
+bool ChunkedFrontEnd::isReady() const {
+    return m_ready;
+}
+
+bool ChunkedFrontEnd::needsBlocks() const {
+    // Every chunk of the round, and what its front end reads after it
+    return !m_endOfSignal && m_numberOfBlocks <
+        m_nextBlock + static_cast<std::int64_t>(m_frontEnds.size()) *
+        m_blocksPerChunk + m_overlapBlocks;
+}
+
+void ChunkedFrontEnd::appendBlock(const float *block) {
+    m_blocks.insert(m_blocks.end(), block, block + m_blockSize);
+    m_numberOfBlocks++;
+}
+
+void ChunkedFrontEnd::endSignal() {
+    m_endOfSignal = true;
+}
+
+bool ChunkedFrontEnd::isDone() const {
+    return m_endOfSignal && m_nextBlock == m_numberOfBlocks;
+}
+
+void ChunkedFrontEnd::process(Vamp::Plugin::FeatureList *logSpectra) {
+    if (!m_ready || isDone()) {
+        return;
+    }
+    const std::int64_t numberOfChunks = m_frontEnds.size();
+    const std::int64_t segmentEnd =
+        m_nextBlock + numberOfChunks * m_blocksPerChunk;
+    std::vector<Vamp::Plugin::FeatureList> chunkSpectra(numberOfChunks);
+    std::vector<std::thread> threads;
+    for (std::int64_t chunk = 0; chunk < numberOfChunks; chunk++) {
+        std::int64_t begin = m_nextBlock + chunk * m_blocksPerChunk;
+        std::int64_t end = std::min<std::int64_t>(
+            begin + m_blocksPerChunk, m_numberOfBlocks);
+        if (begin >= end) {
+            break;
+        }
+        threads.push_back(std::thread(&ChunkedFrontEnd::processChunk,
+            this, &m_frontEnds[chunk], begin, end, &chunkSpectra[chunk]));
+    }
+    for (std::size_t thread = 0; thread < threads.size(); thread++) {
+        threads[thread].join();
+    }
+    for (std::int64_t chunk = 0; chunk < numberOfChunks; chunk++) {
+        logSpectra->insert(logSpectra->end(),
+            chunkSpectra[chunk].begin(), chunkSpectra[chunk].end());
+    }
+    m_nextBlock = std::min(segmentEnd, m_numberOfBlocks);
+    if (isDone()) {
+        m_blocks.clear();
+    } else {
+        // The next front ends start reading before their chunks
+        std::int64_t firstBlock = std::max<std::int64_t>(
+            m_nextBlock - m_overlapBlocks, 0);
+        m_blocks.erase(m_blocks.begin(), m_blocks.begin() +
+            (firstBlock - m_firstBlock) * m_blockSize);
+        m_firstBlock = firstBlock;
+    }
+}
+
+void ChunkedFrontEnd::processChunk(
+    FrontEnd *frontEnd,
+    std::int64_t begin,
+    std::int64_t end,
+    Vamp::Plugin::FeatureList *logSpectrum) const {
+    const Vamp::RealTime chunkStart =
+        Vamp::RealTime::frame2RealTime(begin * m_blockSize, m_sampleRate);
+    const Vamp::RealTime chunkEnd =
+        Vamp::RealTime::frame2RealTime(end * m_blockSize, m_sampleRate);
+    // The last chunk also has the frames the front end pads with zeros
+    const bool lastChunk = m_endOfSignal && end == m_numberOfBlocks;
+    const std::int64_t first = std::max<std::int64_t>(
+        begin - m_overlapBlocks, 0);
+    const std::int64_t last = std::min<std::int64_t>(
+        end + m_overlapBlocks, m_numberOfBlocks);
+    frontEnd->adapter->reset();
+    Vamp::Plugin::FeatureSet fs;
+    for (std::int64_t block = first; block <= last; block++) {
+        if (block < last) {
+            const float *blockBuffer =
+                &m_blocks[(block - m_firstBlock) * m_blockSize];
+            fs = frontEnd->adapter->process(&blockBuffer,
+                Vamp::RealTime::frame2RealTime(
+                    block * m_blockSize, m_sampleRate));
+        } else if (m_endOfSignal && last == m_numberOfBlocks) {
+            fs = frontEnd->adapter->getRemainingFeatures();
+        } else {
+            break;
+        }
+        const Vamp::Plugin::FeatureList &frames =
+            fs[frontEnd->logSpectrumFeatureNo];
+        for (std::size_t i = 0; i < frames.size(); i++) {
+            if (!(frames[i].timestamp < chunkStart) &&
+                (lastChunk || frames[i].timestamp < chunkEnd)) {
+                logSpectrum->push_back(frames[i]);
+            }
+        }
+    }
+}
+
+}  // namespace justkeydding
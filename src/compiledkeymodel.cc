@@ -0,0 +1,274 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Log-domain key model compiled once from a key profile and key transition
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "./compiledkeymodel.h"
+
+using std::log10;
+
+namespace justkeydding {
+
+CompiledKeyModel::CompiledKeyModel(
+  KeyProfile keyProfile, KeyTransition keyTransition) {
+  KeyTransition::KeyTransitionArray symmetrical =
+    KeyTransition("symmetrical").getKeyTransitionArray();
+  // Every key is a state, in order, so the dense matrices of the
+  // profiles and transitions are already indexed by state
+  const KeyTransition::KeyTransitionMatrix &transition =
+    keyTransition.getKeyTransitionMatrix();
+  const KeyProfile::KeyProfileMatrix &emission =
+    keyProfile.getKeyProfileMatrix();
+  initStates(Key::getAllKeysVector());
+  compile(
+    std::vector<double>(symmetrical.begin(), symmetrical.end()),
+    std::vector<double>(transition.begin(), transition.end()),
+    std::vector<double>(emission.begin(), emission.end()),
+    PitchClass::NUMBER_OF_PITCHCLASSES);
+}
+
+CompiledKeyModel::CompiledKeyModel(
+  Key::KeyVector states,
+  std::map<Key, double> initialProbabilities,
+  std::map<Key, std::map<Key, double> > transitionProbabilities,
+  std::map<Key, std::map<PitchClass, double> > emissionProbabilities) {
+  initStates(states);
+  compile(
+    getInitialVector(initialProbabilities),
+    getTransitionMatrix(transitionProbabilities),
+    getEmissionMatrix(emissionProbabilities,
+      PitchClass::NUMBER_OF_PITCHCLASSES),
+    PitchClass::NUMBER_OF_PITCHCLASSES);
+}
+
+CompiledKeyModel::CompiledKeyModel(
+  Key::KeyVector states,
+  std::map<Key, double> initialProbabilities,
+  std::map<Key, std::map<Key, double> > transitionProbabilities,
+  std::map<Key, std::map<Key, double> > emissionProbabilities) {
+  initStates(states);
+  compile(
+    getInitialVector(initialProbabilities),
+    getTransitionMatrix(transitionProbabilities),
+    getEmissionMatrix(emissionProbabilities, Key::NUMBER_OF_KEYS),
+    Key::NUMBER_OF_KEYS);
+}
+
+CompiledKeyModel::CompiledKeyModel(
+  const double *tables,
+  std::shared_ptr<const void> owner) :
+  m_numberOfSymbols(PitchClass::NUMBER_OF_PITCHCLASSES),
+  m_tableOwner(owner) {
+  initStates(Key::getAllKeysVector());
+  setTables(tables);
+}
+
+std::size_t CompiledKeyModel::getNumberOfTableValues(
+  int numberOfStates,
+  int numberOfSymbols) {
+  return numberOfStates +
+    numberOfStates * numberOfStates +
+    2 * numberOfSymbols * numberOfStates +
+    numberOfSymbols * numberOfStates * numberOfStates;
+}
+
+void CompiledKeyModel::setTables(const double *tables) {
+  const std::size_t numberOfStates = m_states.size();
+  m_logInitial = tables;
+  m_logTransition = m_logInitial + numberOfStates;
+  m_logEmission = m_logTransition + numberOfStates * numberOfStates;
+  m_logStart = m_logEmission + m_numberOfSymbols * numberOfStates;
+  m_logStep = m_logStart + m_numberOfSymbols * numberOfStates;
+}
+
+void CompiledKeyModel::initStates(const Key::KeyVector &states) {
+  // States, and the reverse lookup from a key to its position
+  m_stateIndex.assign(Key::NUMBER_OF_KEYS, -1);
+  for (std::vector<Key>::const_iterator itState = states.begin();
+      itState != states.end(); itState++) {
+    m_stateIndex[itState->getInt()] = m_states.size();
+    m_states.push_back(itState->getInt());
+  }
+}
+
+std::vector<double> CompiledKeyModel::getInitialVector(
+  const std::map<Key, double> &initialProbabilities) const {
+  std::vector<double> initial(m_states.size(), 0.0);
+  for (std::map<Key, double>::const_iterator itInitial =
+      initialProbabilities.begin(); itInitial != initialProbabilities.end();
+      itInitial++) {
+    int state = m_stateIndex[(itInitial->first).getInt()];
+    if (state >= 0) {
+      initial[state] = itInitial->second;
+    }
+  }
+  return initial;
+}
+
+std::vector<double> CompiledKeyModel::getTransitionMatrix(
+  const std::map<Key, std::map<Key, double> > &transitionProbabilities)
+  const {
+  const int numberOfStates = m_states.size();
+  std::vector<double> transition(numberOfStates * numberOfStates, 0.0);
+  for (std::map<Key, std::map<Key,
+      double> >::const_iterator itTransition = transitionProbabilities.begin();
+      itTransition != transitionProbabilities.end(); itTransition++) {
+    int fromState = m_stateIndex[(itTransition->first).getInt()];
+    if (fromState < 0) {
+      continue;
+    }
+    const std::map<Key, double> &toKeyMap = itTransition->second;
+    for (std::map<Key, double>::const_iterator itToKey = toKeyMap.begin();
+        itToKey != toKeyMap.end(); itToKey++ ) {
+      int toState = m_stateIndex[(itToKey->first).getInt()];
+      if (toState >= 0) {
+        transition[fromState * numberOfStates + toState] = itToKey->second;
+      }
+    }
+  }
+  return transition;
+}
+
+template <typename Symbol>
+std::vector<double> CompiledKeyModel::getEmissionMatrix(
+  const std::map<Key, std::map<Symbol, double> > &emissionProbabilities,
+  int numberOfSymbols) const {
+  const int numberOfStates = m_states.size();
+  // [state][symbol], as given by the profiles
+  std::vector<double> emission(numberOfStates * numberOfSymbols, 0.0);
+  for (typename std::map<Key, std::map<Symbol,
+      double> >::const_iterator itEmission = emissionProbabilities.begin();
+      itEmission != emissionProbabilities.end(); itEmission++) {
+    int state = m_stateIndex[(itEmission->first).getInt()];
+    if (state < 0) {
+      continue;
+    }
+    const std::map<Symbol, double> &emitMap = itEmission->second;
+    for (typename std::map<Symbol, double>::const_iterator itEmit =
+        emitMap.begin(); itEmit != emitMap.end(); itEmit++) {
+      int symbol = (itEmit->first).getInt();
+      emission[state * numberOfSymbols + symbol] = itEmit->second;
+    }
+  }
+  return emission;
+}
+
+void CompiledKeyModel::compile(
+  const std::vector<double> &initialProbabilities,
+  const std::vector<double> &transitionProbabilities,
+  const std::vector<double> &emissionProbabilities,
+  int numberOfSymbols) {
+  const int numberOfStates = m_states.size();
+  m_numberOfSymbols = numberOfSymbols;
+  m_tableStorage.resize(
+    getNumberOfTableValues(numberOfStates, numberOfSymbols));
+  setTables(m_tableStorage.data());
+  // Writable views of the tables in the block
+  double *allLogInitial = m_tableStorage.data();
+  double *allLogTransition = allLogInitial + numberOfStates;
+  double *allLogEmission =
+    allLogTransition + numberOfStates * numberOfStates;
+  double *allLogStart = allLogEmission + numberOfSymbols * numberOfStates;
+  double *allLogStep = allLogStart + numberOfSymbols * numberOfStates;
+  for (int state = 0; state < numberOfStates; state++) {
+    allLogInitial[state] = log10(initialProbabilities[state]);
+  }
+  for (int i = 0; i < numberOfStates * numberOfStates; i++) {
+    allLogTransition[i] = log10(transitionProbabilities[i]);
+  }
+  for (int symbol = 0; symbol < numberOfSymbols; symbol++) {
+    double *logEmission = &allLogEmission[symbol * numberOfStates];
+    double *logStart = &allLogStart[symbol * numberOfStates];
+    double *logStep =
+      &allLogStep[symbol * numberOfStates * numberOfStates];
+    for (int toState = 0; toState < numberOfStates; toState++) {
+      double emission =
+        emissionProbabilities[toState * numberOfSymbols + symbol];
+      logEmission[toState] = log10(emission);
+      logStart[toState] = log10(initialProbabilities[toState] * emission);
+      for (int fromState = 0; fromState < numberOfStates; fromState++) {
+        logStep[fromState * numberOfStates + toState] = log10(
+          transitionProbabilities[fromState * numberOfStates + toState] *
+          emission);
+      }
+    }
+  }
+}
+
+int CompiledKeyModel::getNumberOfStates() const {
+  return m_states.size();
+}
+
+int CompiledKeyModel::getNumberOfSymbols() const {
+  return m_numberOfSymbols;
+}
+
+int CompiledKeyModel::getState(int state) const {
+  return m_states[state];
+}
+
+const double *CompiledKeyModel::getTables() const {
+  return m_logInitial;
+}
+
+const double *CompiledKeyModel::getLogInitial() const {
+  return m_logInitial;
+}
+
+const double *CompiledKeyModel::getLogTransition() const {
+  return m_logTransition;
+}
+
+const double *CompiledKeyModel::getLogEmission(int symbol) const {
+  return m_logEmission + symbol * m_states.size();
+}
+
+void CompiledKeyModel::getWeightedLogEmission(
+  const double *weights,
+  double *logEmission) const {
+  const int numberOfStates = m_states.size();
+  for (int state = 0; state < numberOfStates; state++) {
+    logEmission[state] = 0.0;
+  }
+  for (int symbol = 0; symbol < m_numberOfSymbols; symbol++) {
+    // Avoids 0 * log10(0), which is not a number
+    if (!(weights[symbol] > 0.0)) {
+      continue;
+    }
+    const double *symbolEmission = getLogEmission(symbol);
+    for (int state = 0; state < numberOfStates; state++) {
+      logEmission[state] += weights[symbol] * symbolEmission[state];
+    }
+  }
+}
+
+const double *CompiledKeyModel::getLogStart(int symbol) const {
+  return m_logStart + symbol * m_states.size();
+}
+
+const double *CompiledKeyModel::getLogStep(int symbol) const {
+  return m_logStep + symbol * m_states.size() * m_states.size();
+}
+
+}  // namespace justkeydding
@@ -0,0 +1,142 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Key detection under every model of an ensemble
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "./ensemble.h"
+
+#include<limits>
+
+namespace justkeydding {
+
+Ensemble::Ensemble(const ModelBundle &bundle, const std::string &name) :
+  m_status(Status::ENSEMBLE_UNINITIALIZED),
+  m_viterbiMode(HiddenMarkovModel::VITERBI_FULL),
+  m_numberOfThreads(0),
+  m_beamWidth(std::numeric_limits<double>::infinity()) {
+  std::vector<std::string> modelNames = bundle.getEnsemble(name);
+  if (modelNames.empty()) {
+    m_status = Status::ENSEMBLE_MODEL_ERROR;
+    return;
+  }
+  for (std::size_t i = 0; i < modelNames.size(); i++) {
+    CompiledKeyModel::ConstPointer model = bundle.getModel(modelNames[i]);
+    KeyTransition::KeyTransitionArray transition;
+    if (!model || !bundle.getKeyTransitionArray(
+        modelNames[i], &transition)) {
+      m_models.clear();
+      m_transitions.clear();
+      m_status = Status::ENSEMBLE_MODEL_ERROR;
+      return;
+    }
+    m_models.push_back(model);
+    m_transitions.push_back(transition);
+  }
+}
+
+void Ensemble::setViterbiMode(HiddenMarkovModel::enViterbiMode viterbiMode) {
+  m_viterbiMode = viterbiMode;
+}
+
+void Ensemble::setNumberOfThreads(int numberOfThreads) {
+  m_numberOfThreads = numberOfThreads;
+}
+
+void Ensemble::setBeamWidth(double beamWidth) {
+  m_beamWidth = beamWidth;
+}
+
+void Ensemble::estimate(const std::vector<PitchClass> &observations) {
+  if (m_status == Status::ENSEMBLE_MODEL_ERROR) {
+    return;
+  }
+  m_probabilityVectors.clear();
+  for (std::size_t i = 0; i < m_models.size(); i++) {
+    HiddenMarkovModel hmm(observations, m_models[i]);
+    estimate(&hmm, i);
+    if (m_status == Status::ENSEMBLE_DECODING_ERROR) {
+      return;
+    }
+  }
+  m_status = Status::ENSEMBLE_READY;
+}
+
+void Ensemble::estimate(
+  const HiddenMarkovModel::WeightedObservations &observations) {
+  if (m_status == Status::ENSEMBLE_MODEL_ERROR) {
+    return;
+  }
+  m_probabilityVectors.clear();
+  for (std::size_t i = 0; i < m_models.size(); i++) {
+    HiddenMarkovModel hmm(observations, m_models[i]);
+    estimate(&hmm, i);
+    if (m_status == Status::ENSEMBLE_DECODING_ERROR) {
+      return;
+    }
+  }
+  m_status = Status::ENSEMBLE_READY;
+}
+
+void Ensemble::estimate(HiddenMarkovModel *hmm, std::size_t model) {
+  hmm->setViterbiMode(m_viterbiMode);
+  if (m_numberOfThreads > 0) {
+    hmm->setNumberOfThreads(m_numberOfThreads);
+  }
+  hmm->setBeamWidth(m_beamWidth);
+  hmm->runViterbi();
+  if (hmm->getStatus() != Status::HIDDENMARKOVMODEL_VITERBI_READY) {
+    m_probabilityVectors.clear();
+    m_status = Status::ENSEMBLE_DECODING_ERROR;
+    return;
+  }
+  GlobalKeyEstimator globalKeyEstimator(GlobalKeyEstimator::compileModel(
+    KeyTransition("custom", m_transitions[model])));
+  globalKeyEstimator.estimate(hmm->getKeySequence());
+  if (globalKeyEstimator.getStatus() != Status::GLOBALKEYESTIMATOR_READY) {
+    m_probabilityVectors.clear();
+    m_status = Status::ENSEMBLE_DECODING_ERROR;
+    return;
+  }
+  m_probabilityVectors.push_back(globalKeyEstimator.getProbabilityVector());
+}
+
+std::size_t Ensemble::getNumberOfModels() const {
+  return m_models.size();
+}
+
+const std::vector<CompiledKeyModel::ConstPointer> &
+Ensemble::getModels() const {
+  return m_models;
+}
+
+std::vector<Ensemble::ProbabilityVector>
+Ensemble::getProbabilityVectors() const {
+  return m_probabilityVectors;
+}
+
+int Ensemble::getStatus() const {
+  return m_status;
+}
+
+}  // namespace justkeydding
@@ -0,0 +1,339 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Content-addressed on-disk cache of chromagrams and results
+
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "./featurecache.h"
+
+#include<sys/file.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<dirent.h>
+#include<fcntl.h>
+#include<unistd.h>
+#include<utime.h>
+
+#include<algorithm>
+#include<cctype>
+#include<cerrno>
+#include<cstdio>
+#include<fstream>
+#include<sstream>
+#include<vector>
+
+namespace justkeydding {
+
+const std::uint64_t FeatureCache::DEFAULT_MAXIMUM_BYTES;
+
+static const std::uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+static const std::uint64_t FNV_PRIME = 1099511628211ULL;
+
+static std::uint64_t fnv1a(
+    const void *data,
+    std::size_t size,
+    std::uint64_t state) {
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (std::size_t i = 0; i < size; i++) {
+        state = (state ^ bytes[i]) * FNV_PRIME;
+    }
+    return state;
+}
+
+static std::string toHexadecimal(std::uint64_t value) {
+    char buffer[17];
+    std::snprintf(buffer, sizeof(buffer), "%016llx",
+        static_cast<unsigned long long>(value));
+    return buffer;
+}
+
+static bool makeDirectory(const std::string &directory) {
+    struct stat fileStatus;
+    if (mkdir(directory.c_str(), 0777) != 0 && errno != EEXIST) {
+        return false;
+    }
+    return stat(directory.c_str(), &fileStatus) == 0 &&
+        S_ISDIR(fileStatus.st_mode);
+}
+
+// Readers refresh the entries they use, the oldest ones go first
+static void touch(const std::string &fileName) {
+    utime(fileName.c_str(), NULL);
+}
+
+// Files of other processes still being written are not entries
+static bool isTemporary(const std::string &fileName) {
+    return fileName.find(".tmp.") != std::string::npos;
+}
+
+struct CacheEntry {
+    std::string fileName;
+    std::uint64_t size;
+    struct timespec lastUse;
+    bool operator<(const CacheEntry &other) const {
+        if (lastUse.tv_sec != other.lastUse.tv_sec) {
+            return lastUse.tv_sec < other.lastUse.tv_sec;
+        }
+        return lastUse.tv_nsec < other.lastUse.tv_nsec;
+    }
+};
+
+static void listEntries(
+    const std::string &directory,
+    std::vector<CacheEntry> *entries) {
+    DIR *stream = opendir(directory.c_str());
+    if (!stream) {
+        return;
+    }
+    struct dirent *item;
+    while ((item = readdir(stream)) != NULL) {
+        std::string name = item->d_name;
+        if (name == "." || name == ".." || isTemporary(name)) {
+            continue;
+        }
+        CacheEntry entry;
+        entry.fileName = directory + "/" + name;
+        struct stat fileStatus;
+        if (stat(entry.fileName.c_str(), &fileStatus) != 0 ||
+            !S_ISREG(fileStatus.st_mode)) {
+            continue;
+        }
+        entry.size = fileStatus.st_size;
+        entry.lastUse = fileStatus.st_mtim;
+        entries->push_back(entry);
+    }
+    closedir(stream);
+}
+
+static std::uint64_t getTotalSize(const std::vector<CacheEntry> &entries) {
+    std::uint64_t totalSize = 0;
+    for (std::size_t i = 0; i < entries.size(); i++) {
+        totalSize += entries[i].size;
+    }
+    return totalSize;
+}
+
+FeatureCache::Statistics::Statistics() :
+    chromagramHits(0),
+    chromagramMisses(0),
+    resultHits(0),
+    resultMisses(0),
+    evictedEntries(0) {
+}
+
+FeatureCache::FeatureCache(
+    const std::string &directory,
+    std::uint64_t maximumBytes) :
+    m_status(Status::FEATURECACHE_UNINITIALIZED),
+    m_directory(directory),
+    m_maximumBytes(maximumBytes) {
+    if (!makeDirectory(m_directory) ||
+        !makeDirectory(m_directory + "/chroma") ||
+        !makeDirectory(m_directory + "/results")) {
+        m_status = Status::FEATURECACHE_DIRECTORY_ERROR;
+        return;
+    }
+    m_status = Status::FEATURECACHE_READY;
+}
+
+int FeatureCache::getStatus() const {
+    return m_status;
+}
+
+std::string FeatureCache::hash(const void *data, std::size_t size) {
+    return toHexadecimal(fnv1a(data, size, FNV_OFFSET_BASIS));
+}
+
+std::string FeatureCache::getKey(
+    const std::string &fileName,
+    const std::string &parameters) {
+    std::map<std::string, std::string>::const_iterator known =
+        m_contentHashes.find(fileName);
+    std::string contentHash;
+    if (known != m_contentHashes.end()) {
+        contentHash = known->second;
+    } else {
+        int fileDescriptor = open(fileName.c_str(), O_RDONLY);
+        if (fileDescriptor == -1) {
+            return "";
+        }
+        struct stat fileStatus;
+        if (fstat(fileDescriptor, &fileStatus) != 0) {
+            close(fileDescriptor);
+            return "";
+        }
+        const std::uint64_t fileSize = fileStatus.st_size;
+        std::uint64_t state = FNV_OFFSET_BASIS;
+        if (fileSize > 0) {
+            void *address = mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE,
+                fileDescriptor, 0);
+            if (address == MAP_FAILED) {
+                close(fileDescriptor);
+                return "";
+            }
+            madvise(address, fileSize, MADV_SEQUENTIAL);
+            state = fnv1a(address, fileSize, state);
+            munmap(address, fileSize);
+        }
+        close(fileDescriptor);
+        state = fnv1a(&fileSize, sizeof(fileSize), state);
+        contentHash = toHexadecimal(state);
+        m_contentHashes[fileName] = contentHash;
+    }
+    return contentHash + "-" + hash(parameters.data(), parameters.size());
+}
+
+bool FeatureCache::findChromagram(
+    const std::string &key,
+    ChromagramBuffer *chromagram,
+    ChromagramCache::Parameters *parameters) {
+    if (m_status != Status::FEATURECACHE_READY) {
+        return false;
+    }
+    std::string fileName = getChromagramFileName(key);
+    ChromagramCache cache(fileName);
+    if (cache.getStatus() != Status::CHROMAGRAMCACHE_READY) {
+        m_statistics.chromagramMisses++;
+        return false;
+    }
+    *chromagram = cache.getChromagramBuffer();
+    *parameters = cache.getParameters();
+    touch(fileName);
+    m_statistics.chromagramHits++;
+    return true;
+}
+
+bool FeatureCache::storeChromagram(
+    const std::string &key,
+    const ChromagramBuffer &chromagram,
+    const ChromagramCache::Parameters &parameters) {
+    if (m_status != Status::FEATURECACHE_READY ||
+        !ChromagramCache::write(
+            getChromagramFileName(key), chromagram, parameters)) {
+        return false;
+    }
+    evict();
+    return true;
+}
+
+bool FeatureCache::findResult(
+    const std::string &key,
+    const std::string &modelId,
+    std::string *result) {
+    if (m_status != Status::FEATURECACHE_READY) {
+        return false;
+    }
+    std::string fileName = getResultFileName(key, modelId);
+    std::ifstream infile(fileName.c_str(), std::ios::binary);
+    if (!infile.is_open()) {
+        m_statistics.resultMisses++;
+        return false;
+    }
+    std::ostringstream content;
+    content << infile.rdbuf();
+    *result = content.str();
+    touch(fileName);
+    m_statistics.resultHits++;
+    return true;
+}
+
+bool FeatureCache::storeResult(
+    const std::string &key,
+    const std::string &modelId,
+    const std::string &result) {
+    if (m_status != Status::FEATURECACHE_READY) {
+        return false;
+    }
+    std::string fileName = getResultFileName(key, modelId);
+    std::ostringstream temporaryFileName;
+    temporaryFileName << fileName << ".tmp." << getpid();
+    std::ofstream outfile(temporaryFileName.str().c_str(), std::ios::binary);
+    outfile << result;
+    outfile.close();
+    if (!outfile ||
+        std::rename(temporaryFileName.str().c_str(), fileName.c_str()) != 0) {
+        std::remove(temporaryFileName.str().c_str());
+        return false;
+    }
+    evict();
+    return true;
+}
+
+const FeatureCache::Statistics &FeatureCache::getStatistics() const {
+    return m_statistics;
+}
+
+std::string FeatureCache::getChromagramFileName(
+    const std::string &key) const {
+    return m_directory + "/chroma/" + key + ".chroma";
+}
+
+std::string FeatureCache::getResultFileName(
+    const std::string &key,
+    const std::string &modelId) const {
+    std::string name = modelId;
+    for (std::size_t i = 0; i < name.size(); i++) {
+        const char c = name[i];
+        if (!std::isalnum(static_cast<unsigned char>(c)) &&
+            c != '-' && c != '_') {
+            name[i] = '_';
+        }
+    }
+    return m_directory + "/results/" + key + "-" + name + ".txt";
+}
+
+void FeatureCache::evict() {
+    std::vector<CacheEntry> entries;
+    listEntries(m_directory + "/chroma", &entries);
+    listEntries(m_directory + "/results", &entries);
+    if (getTotalSize(entries) <= m_maximumBytes) {
+        return;
+    }
+    // One process evicts at a time, from a fresh listing
+    std::string lockFileName = m_directory + "/lock";
+    int lockDescriptor = open(lockFileName.c_str(), O_RDWR | O_CREAT, 0666);
+    if (lockDescriptor == -1 || flock(lockDescriptor, LOCK_EX) != 0) {
+        if (lockDescriptor != -1) {
+            close(lockDescriptor);
+        }
+        return;
+    }
+    entries.clear();
+    listEntries(m_directory + "/chroma", &entries);
+    listEntries(m_directory + "/results", &entries);
+    std::sort(entries.begin(), entries.end());
+    std::uint64_t totalSize = getTotalSize(entries);
+    for (std::size_t i = 0;
+        i < entries.size() && totalSize > m_maximumBytes; i++) {
+        // Processes that mapped the entry keep reading it
+        if (unlink(entries[i].fileName.c_str()) == 0) {
+            m_statistics.evictedEntries++;
+        }
+        totalSize -= entries[i].size;
+    }
+    flock(lockDescriptor, LOCK_UN);
+    close(lockDescriptor);
+}
+
+}  // namespace justkeydding
@@ -0,0 +1,195 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Scaled forward-backward algorithm for per-frame key posteriors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "./forwardbackward.h"
+
+#include<cmath>
+#include<algorithm>
+
+namespace justkeydding {
+
+ForwardBackward::ForwardBackward(
+  std::vector<PitchClass> observations,
+  CompiledKeyModel::ConstPointer model) :
+  m_model(model) {
+  initObservations(observations);
+}
+
+ForwardBackward::ForwardBackward(
+  std::vector<Key> observations,
+  CompiledKeyModel::ConstPointer model) :
+  m_model(model) {
+  initObservations(observations);
+}
+
+template <typename Symbol>
+void ForwardBackward::initObservations(
+  const std::vector<Symbol> &observations) {
+  m_observations.reserve(observations.size());
+  for (typename std::vector<Symbol>::const_iterator itObs =
+      observations.begin(); itObs != observations.end(); itObs++) {
+    m_observations.push_back(itObs->getInt());
+  }
+  // Back to the linear domain, once
+  const int numberOfStates = m_model->getNumberOfStates();
+  const int numberOfSymbols = m_model->getNumberOfSymbols();
+  m_start.resize(numberOfSymbols * numberOfStates);
+  m_step.resize(numberOfSymbols * numberOfStates * numberOfStates);
+  for (int symbol = 0; symbol < numberOfSymbols; symbol++) {
+    const double *logStart = m_model->getLogStart(symbol);
+    const double *logStep = m_model->getLogStep(symbol);
+    for (int i = 0; i < numberOfStates; i++) {
+      m_start[symbol * numberOfStates + i] = std::pow(10.0, logStart[i]);
+    }
+    for (int i = 0; i < numberOfStates * numberOfStates; i++) {
+      m_step[symbol * numberOfStates * numberOfStates + i] =
+        std::pow(10.0, logStep[i]);
+    }
+  }
+  m_logLikelihood = -HUGE_VAL;
+  m_status = Status::FORWARDBACKWARD_UNINITIALIZED;
+}
+
+void ForwardBackward::run() {
+  const int numberOfStates = m_model->getNumberOfStates();
+  const std::size_t numberOfObservations = m_observations.size();
+  const int numberOfKeys = Key::NUMBER_OF_KEYS;
+  if (numberOfStates == 0 || numberOfObservations == 0) {
+    return;
+  }
+  // The forward variables of frame t are stored in the first
+  // numberOfStates entries of row t, and replaced by the posteriors
+  m_posteriors.assign(numberOfObservations * numberOfKeys, 0.0);
+  double logLikelihood = 0.0;
+  // Forward
+  for (std::size_t t = 0; t < numberOfObservations; t++) {
+    double *alpha = &m_posteriors[t * numberOfKeys];
+    const int symbol = m_observations[t];
+    if (t == 0) {
+      std::copy(&m_start[symbol * numberOfStates],
+        &m_start[(symbol + 1) * numberOfStates], alpha);
+    } else {
+      const double *previousAlpha = &m_posteriors[(t - 1) * numberOfKeys];
+      const double *step =
+        &m_step[symbol * numberOfStates * numberOfStates];
+      for (int from = 0; from < numberOfStates; from++) {
+        const double alphaFrom = previousAlpha[from];
+        const double *stepFrom = &step[from * numberOfStates];
+        for (int to = 0; to < numberOfStates; to++) {
+          alpha[to] += alphaFrom * stepFrom[to];
+        }
+      }
+    }
+    double scale = 0.0;
+    for (int state = 0; state < numberOfStates; state++) {
+      scale += alpha[state];
+    }
+    if (!(scale > 0.0)) {
+      // Every path is impossible under this model
+      m_posteriors.clear();
+      return;
+    }
+    for (int state = 0; state < numberOfStates; state++) {
+      alpha[state] /= scale;
+    }
+    logLikelihood += std::log10(scale);
+  }
+  // Backward, combined with the forward variables into posteriors
+  AlignedDoubleVector beta(numberOfStates, 1.0);
+  AlignedDoubleVector previousBeta(numberOfStates);
+  std::vector<double> posterior(numberOfKeys);
+  std::vector<double> totalPosterior(numberOfKeys, 0.0);
+  for (std::size_t t = numberOfObservations; t > 0; t--) {
+    double *row = &m_posteriors[(t - 1) * numberOfKeys];
+    if (t < numberOfObservations) {
+      const double *step =
+        &m_step[m_observations[t] * numberOfStates * numberOfStates];
+      double scale = 0.0;
+      for (int from = 0; from < numberOfStates; from++) {
+        const double *stepFrom = &step[from * numberOfStates];
+        double sum = 0.0;
+        for (int to = 0; to < numberOfStates; to++) {
+          sum += stepFrom[to] * beta[to];
+        }
+        previousBeta[from] = sum;
+        scale += sum;
+      }
+      for (int from = 0; from < numberOfStates; from++) {
+        beta[from] = previousBeta[from] / scale;
+      }
+    }
+    double normalization = 0.0;
+    std::fill(posterior.begin(), posterior.end(), 0.0);
+    for (int state = 0; state < numberOfStates; state++) {
+      double gamma = row[state] * beta[state];
+      posterior[m_model->getState(state)] = gamma;
+      normalization += gamma;
+    }
+    for (int key = 0; key < numberOfKeys; key++) {
+      row[key] = posterior[key] / normalization;
+      totalPosterior[key] += row[key];
+    }
+  }
+  m_averagePosterior.resize(numberOfKeys);
+  for (int key = 0; key < numberOfKeys; key++) {
+    m_averagePosterior[key] = totalPosterior[key] / numberOfObservations;
+  }
+  m_logLikelihood = logLikelihood;
+  m_status = Status::FORWARDBACKWARD_READY;
+}
+
+std::size_t ForwardBackward::getNumberOfObservations() const {
+  return m_observations.size();
+}
+
+ForwardBackward::ProbabilityVector ForwardBackward::getPosterior(
+  std::size_t frame) const {
+  if ((frame + 1) * Key::NUMBER_OF_KEYS > m_posteriors.size()) {
+    return ProbabilityVector();
+  }
+  return ProbabilityVector(
+    m_posteriors.begin() + frame * Key::NUMBER_OF_KEYS,
+    m_posteriors.begin() + (frame + 1) * Key::NUMBER_OF_KEYS);
+}
+
+const std::vector<double> &ForwardBackward::getPosteriors() const {
+  return m_posteriors;
+}
+
+ForwardBackward::ProbabilityVector
+ForwardBackward::getAveragePosterior() const {
+  return m_averagePosterior;
+}
+
+double ForwardBackward::getLogLikelihood() const {
+  return m_logLikelihood;
+}
+
+int ForwardBackward::getStatus() const {
+  return m_status;
+}
+
+}  // namespace justkeydding
@@ -0,0 +1,133 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Global key of a piece from the histogram of its local keys
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "./globalkeyestimator.h"
+
+#include<cmath>
+#include<iterator>
+#include<limits>
+#include<map>
+#include<memory>
+
+namespace justkeydding {
+
+GlobalKeyEstimator::GlobalKeyEstimator(
+  CompiledKeyModel::ConstPointer model) :
+  m_status(Status::GLOBALKEYESTIMATOR_UNINITIALIZED),
+  m_model(model),
+  m_stayOnly(true),
+  m_globalKey(-1) {
+  const int numberOfStates = m_model->getNumberOfStates();
+  const double *logTransition = m_model->getLogTransition();
+  for (int from = 0; from < numberOfStates; from++) {
+    for (int to = 0; to < numberOfStates; to++) {
+      if (from != to &&
+          logTransition[from * numberOfStates + to] !=
+          -std::numeric_limits<double>::infinity()) {
+        m_stayOnly = false;
+      }
+    }
+  }
+}
+
+CompiledKeyModel::ConstPointer GlobalKeyEstimator::compileModel(
+  KeyTransition keyTransition) {
+  Key::KeyVector keyVector = Key::getAllKeysVector();
+  KeyTransition::KeyTransitionArray symmetrical =
+    KeyTransition("symmetrical").getKeyTransitionArray();
+  std::map<Key, double> initialProbabilities;
+  for (Key::KeyVector::iterator it = keyVector.begin();
+      it != keyVector.end(); it++) {
+    initialProbabilities[*it] = symmetrical[it->getInt()];
+  }
+  return std::make_shared<CompiledKeyModel>(
+    keyVector,
+    initialProbabilities,
+    KeyTransition("zero").getKeyTransitionMap(),
+    keyTransition.getKeyTransitionMap());
+}
+
+void GlobalKeyEstimator::estimate(const Key::KeySequence &localKeys) {
+  if (localKeys.empty()) {
+    return;
+  }
+  KeyHistogram histogram(m_model->getNumberOfSymbols(), 0);
+  for (Key::KeySequence::const_iterator itKey = std::next(localKeys.begin());
+      itKey != localKeys.end(); itKey++) {
+    histogram[itKey->getInt()]++;
+  }
+  estimate(localKeys.front().getInt(), histogram);
+}
+
+void GlobalKeyEstimator::estimate(
+  int firstKey, const KeyHistogram &histogram) {
+  const int numberOfStates = m_model->getNumberOfStates();
+  if (!m_stayOnly || numberOfStates == 0) {
+    return;
+  }
+  const double *logStart = m_model->getLogStart(firstKey);
+  ProbabilityVector probabilities(Key::NUMBER_OF_KEYS, 0);
+  double maximumProbability = -std::numeric_limits<double>::infinity();
+  int globalState = -1;
+  for (int state = 0; state < numberOfStates; state++) {
+    double score = logStart[state];
+    for (std::size_t symbol = 0; symbol < histogram.size(); symbol++) {
+      // An unseen symbol adds nothing, even where its step is -inf
+      if (histogram[symbol] == 0) {
+        continue;
+      }
+      const double *logStep = m_model->getLogStep(symbol);
+      score += histogram[symbol] * logStep[state * numberOfStates + state];
+    }
+    probabilities[m_model->getState(state)] = score;
+    if (score > maximumProbability) {
+      maximumProbability = score;
+      globalState = state;
+    }
+  }
+  if (globalState == -1) {
+    // Every path is impossible under this model
+    return;
+  }
+  m_globalKey = m_model->getState(globalState);
+  m_probabilityVector = probabilities;
+  m_status = Status::GLOBALKEYESTIMATOR_READY;
+}
+
+Key GlobalKeyEstimator::getGlobalKey() const {
+  return Key(m_globalKey);
+}
+
+GlobalKeyEstimator::ProbabilityVector
+GlobalKeyEstimator::getProbabilityVector() const {
+  return m_probabilityVector;
+}
+
+int GlobalKeyEstimator::getStatus() const {
+  return m_status;
+}
+
+}  // namespace justkeydding
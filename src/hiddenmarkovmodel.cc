@@ -32,55 +32,21 @@ using std::log10;
 
 namespace justkeydding {
 
+const std::size_t HiddenMarkovModel::OBSERVATION_BLOCK;
+const std::size_t HiddenMarkovModel::MINIMUM_CHUNK;
+
 HiddenMarkovModel::HiddenMarkovModel(
   std::vector<PitchClass> observations,
   Key::KeyVector states,
   std::map<Key, double> initialProbabilities,
   std::map<Key, std::map<Key, double> > transitionProbabilities,
-  std::map<Key, std::map<PitchClass, double> > emissionProbabilities) {
-  // Observations
-  for (std::vector<PitchClass>::const_iterator itObs = observations.begin();
-      itObs != observations.end(); itObs++) {
-    m_observations.push_back(itObs->getInt());
-  }
-  // States
-  for (std::vector<Key>::const_iterator itState = states.begin();
-      itState != states.end(); itState++) {
-    m_states.push_back(itState->getInt());
-  }
-  // Initial probabilities
-  for (std::map<Key, double>::const_iterator itInitial =
-      initialProbabilities.begin(); itInitial != initialProbabilities.end();
-      itInitial++) {
-    int key = (itInitial->first).getInt();
-    m_initialProbabilities[key] =
-        itInitial->second;
-  }
-  // Transition probabilities
-  for (std::map<Key, std::map<Key,
-      double> >::const_iterator itTransition = transitionProbabilities.begin();
-      itTransition != transitionProbabilities.end(); itTransition++) {
-    int fromKey = (itTransition->first).getInt();
-    std::map<Key, double> toKeyMap = itTransition->second;
-    for (std::map<Key, double>::const_iterator itToKey = toKeyMap.begin();
-        itToKey != toKeyMap.end(); itToKey++ ) {
-      int toKey = (itToKey->first).getInt();
-      m_transitionProbabilities[fromKey][toKey] = itToKey->second;
-    }
-  }
-  // Emission probabilities
-  for (std::map<Key, std::map<PitchClass,
-      double> >::const_iterator itEmission = emissionProbabilities.begin();
-      itEmission != emissionProbabilities.end(); itEmission++) {
-    int fromKey = (itEmission->first).getInt();
-    std::map<PitchClass, double> emitPcMap = itEmission->second;
-    for (std::map<PitchClass, double>::const_iterator itEmitPc =
-        emitPcMap.begin(); itEmitPc != emitPcMap.end(); itEmitPc++) {
-      int emitPc = (itEmitPc->first).getInt();
-      m_emissionProbabilities[fromKey][emitPc] = itEmitPc->second;
-    }
-  }
-  m_status = Status::HIDDENMARKOVMODEL_UNINITIALIZED;
+  std::map<Key, std::map<PitchClass, double> > emissionProbabilities) :
+  m_model(std::make_shared<CompiledKeyModel>(
+    states,
+    initialProbabilities,
+    transitionProbabilities,
+    emissionProbabilities)) {
+  initObservations(observations);
 }
 
 HiddenMarkovModel::HiddenMarkovModel(
@@ -88,62 +54,123 @@ HiddenMarkovModel::HiddenMarkovModel(
   Key::KeyVector states,
   std::map<Key, double> initialProbabilities,
   std::map<Key, std::map<Key, double> > transitionProbabilities,
-  std::map<Key, std::map<Key, double> > emissionProbabilities) {
-  // Observations
-  for (std::vector<Key>::const_iterator itObs = observations.begin();
-      itObs != observations.end(); itObs++) {
-    m_observations.push_back(itObs->getInt());
-  }
-  // States
-  for (std::vector<Key>::const_iterator itState = states.begin();
-      itState != states.end(); itState++) {
-    m_states.push_back(itState->getInt());
-  }
-  // Initial probabilities
-  for (std::map<Key, double>::const_iterator itInitial =
-      initialProbabilities.begin(); itInitial != initialProbabilities.end();
-      itInitial++) {
-    int key = (itInitial->first).getInt();
-    m_initialProbabilities[key] =
-        itInitial->second;
-  }
-  // Transition probabilities
-  for (std::map<Key, std::map<Key,
-      double> >::const_iterator itTransition = transitionProbabilities.begin();
-      itTransition != transitionProbabilities.end(); itTransition++) {
-    int fromKey = (itTransition->first).getInt();
-    std::map<Key, double> toKeyMap = itTransition->second;
-    for (std::map<Key, double>::const_iterator itToKey = toKeyMap.begin();
-        itToKey != toKeyMap.end(); itToKey++ ) {
-      int toKey = (itToKey->first).getInt();
-      m_transitionProbabilities[fromKey][toKey] = itToKey->second;
+  std::map<Key, std::map<Key, double> > emissionProbabilities) :
+  m_model(std::make_shared<CompiledKeyModel>(
+    states,
+    initialProbabilities,
+    transitionProbabilities,
+    emissionProbabilities)) {
+  initObservations(observations);
+}
+
+HiddenMarkovModel::HiddenMarkovModel(
+  std::vector<PitchClass> observations,
+  CompiledKeyModel::ConstPointer model) :
+  m_model(model) {
+  initObservations(observations);
+}
+
+HiddenMarkovModel::HiddenMarkovModel(
+  std::vector<Key> observations,
+  CompiledKeyModel::ConstPointer model) :
+  m_model(model) {
+  initObservations(observations);
+}
+
+HiddenMarkovModel::HiddenMarkovModel(
+  const ObservationRuns &observationRuns,
+  CompiledKeyModel::ConstPointer model) :
+  m_status(Status::HIDDENMARKOVMODEL_UNINITIALIZED),
+  m_viterbiMode(VITERBI_FULL),
+  m_numberOfThreads(std::thread::hardware_concurrency()),
+  m_beamWidth(std::numeric_limits<double>::infinity()),
+  m_pruningStatistics(),
+  m_model(model) {
+  // Kept as runs, merging the adjacent ones of the same symbol; only the
+  // modes other than VITERBI_RUNLENGTH expand them (see runViterbi)
+  for (ObservationRuns::const_iterator itRun = observationRuns.begin();
+      itRun != observationRuns.end(); itRun++) {
+    if (itRun->second == 0) {
+      continue;
     }
-  }
-  // Emission probabilities
-  for (std::map<Key, std::map<Key,
-      double> >::const_iterator itEmission = emissionProbabilities.begin();
-      itEmission != emissionProbabilities.end(); itEmission++) {
-    int fromKey = (itEmission->first).getInt();
-    std::map<Key, double> emitKeyMap = itEmission->second;
-    for (std::map<Key, double>::const_iterator itEmitKey =
-        emitKeyMap.begin(); itEmitKey != emitKeyMap.end(); itEmitKey++) {
-      int emitKey = (itEmitKey->first).getInt();
-      m_emissionProbabilities[fromKey][emitKey] = itEmitKey->second;
+    if (!m_observationRuns.empty() &&
+        m_observationRuns.back().first == itRun->first) {
+      m_observationRuns.back().second += itRun->second;
+    } else {
+      m_observationRuns.push_back(*itRun);
     }
   }
+}
+
+HiddenMarkovModel::HiddenMarkovModel(
+  const WeightedObservations &weightedObservations,
+  CompiledKeyModel::ConstPointer model) :
+  m_status(Status::HIDDENMARKOVMODEL_UNINITIALIZED),
+  m_viterbiMode(VITERBI_FULL),
+  m_numberOfThreads(std::thread::hardware_concurrency()),
+  m_beamWidth(std::numeric_limits<double>::infinity()),
+  m_pruningStatistics(),
+  m_weightedObservations(weightedObservations),
+  m_model(model) {
+}
+
+template <typename Symbol>
+void HiddenMarkovModel::initObservations(
+  const std::vector<Symbol> &observations) {
+  m_observations = toObservations(observations);
   m_status = Status::HIDDENMARKOVMODEL_UNINITIALIZED;
+  m_viterbiMode = VITERBI_FULL;
+  m_numberOfThreads = std::thread::hardware_concurrency();
+  m_beamWidth = std::numeric_limits<double>::infinity();
+  m_pruningStatistics = PruningStatistics();
+}
+
+void HiddenMarkovModel::expandObservationRuns() {
+  for (ObservationRuns::const_iterator itRun = m_observationRuns.begin();
+      itRun != m_observationRuns.end(); itRun++) {
+    m_observations.insert(
+      m_observations.end(), itRun->second, itRun->first);
+  }
+  ObservationRuns().swap(m_observationRuns);
+}
+
+void HiddenMarkovModel::setViterbiMode(enViterbiMode viterbiMode) {
+  m_viterbiMode = viterbiMode;
+}
+
+void HiddenMarkovModel::setNumberOfThreads(int numberOfThreads) {
+  m_numberOfThreads = numberOfThreads;
+}
+
+void HiddenMarkovModel::setBeamWidth(double beamWidth) {
+  m_beamWidth = beamWidth;
+}
+
+template <typename Symbol>
+HiddenMarkovModel::Observations HiddenMarkovModel::toObservations(
+  const std::vector<Symbol> &symbols) {
+  Observations observations;
+  observations.reserve(symbols.size());
+  for (typename std::vector<Symbol>::const_iterator itObs =
+      symbols.begin(); itObs != symbols.end(); itObs++) {
+    observations.push_back(itObs->getInt());
+  }
+  return observations;
 }
 
 void HiddenMarkovModel::printOutput() {
+  const int numberOfStates = m_model->getNumberOfStates();
+  const double *logInitial = m_model->getLogInitial();
+  const double *logTransition = m_model->getLogTransition();
   // print states
   std::cout << "States:" << std::endl;
-  for (States::const_iterator i = m_states.begin();
-    i != m_states.end(); i++) {
-    std::cout << "S: " << (*i) << std::endl;
+  for (int i = 0; i < numberOfStates; i++) {
+    std::cout << "S: " << m_model->getState(i) << std::endl;
   }
 
   // print observations
   std::cout << "Observations:" << std::endl;
+  expandObservationRuns();
   for (Observations::const_iterator i = m_observations.begin();
       i != m_observations.end(); i++) {
     std::cout << "O: " << (*i) << std::endl;
@@ -151,100 +178,688 @@ void HiddenMarkovModel::printOutput() {
 
   // print start probabilities
   std::cout << "Start probabilities:" << std::endl;
-  for (InitialProbabilities::const_iterator i =
-    m_initialProbabilities.begin(); i != m_initialProbabilities.end(); i++) {
-    std::cout << "S: " << (*i).first << " P: " << (*i).second << std::endl;
+  for (int i = 0; i < numberOfStates; i++) {
+    std::cout << "S: " << m_model->getState(i)
+      << " P: " << std::pow(10.0, logInitial[i]) << std::endl;
   }
 
   // print transition_probability
   std::cout << "Transition probabilities:" << std::endl;
-  for (TransitionProbabilities::const_iterator i =
-    m_transitionProbabilities.begin();
-    i != m_transitionProbabilities.end(); i++) {
-    for (TransitionProbability::const_iterator j =
-        (*i).second.begin(); j != (*i).second.end(); j++) {
-      std::cout << "FS: " << (*i).first << " TS: " <<
-      (*j).first << " P: " << (*j).second << std::endl;
+  for (int i = 0; i < numberOfStates; i++) {
+    for (int j = 0; j < numberOfStates; j++) {
+      std::cout << "FS: " << m_model->getState(i)
+        << " TS: " << m_model->getState(j)
+        << " P: " << std::pow(10.0, logTransition[i * numberOfStates + j])
+        << std::endl;
     }
   }
 
   // print emission probabilities
   std::cout << "Emission probabilities:" << std::endl;
-  for (int i=0; i < m_states.size(); i++) {
-    for (int j=0; j < m_observations.size(); j++) {
+  for (int i = 0; i < numberOfStates; i++) {
+    for (std::size_t j = 0; j < m_observations.size(); j++) {
       std::cout
-        << "FS: " << m_states[i] << " TO: " << m_observations[j] << " P: "
-        << m_emissionProbabilities[m_states[i]][m_observations[j]]
+        << "FS: " << m_model->getState(i)
+        << " TO: " << m_observations[j] << " P: "
+        << std::pow(10.0, m_model->getLogEmission(m_observations[j])[i])
         << std::endl;
     }
   }
 }
 
 void HiddenMarkovModel::runViterbi() {
-  std::vector<ViterbiLayer> m_viterbi;
-  ViterbiLayer currentLayer;
-  ViterbiNode currentNode;
-  double transition, emission, trialProbability;
-  double maximumProbability = -std::numeric_limits<double>::infinity();
-  for (std::vector<int>::const_iterator itState=m_states.begin();
-      itState != m_states.end(); itState++) {
-    int firstObservation = m_observations[0];
-    transition = m_initialProbabilities[*itState];
-    emission = m_emissionProbabilities[*itState][firstObservation];
-    currentNode.probability = log10(transition * emission);
-    currentLayer[*itState] = currentNode;
-  }
-  m_viterbi.push_back(currentLayer);
-  for (std::vector<int>::const_iterator itObservation =
-      std::next(m_observations.begin());
-      itObservation != m_observations.end(); itObservation++) {
-    ViterbiLayer nextLayer;
-    for (std::vector<int>::const_iterator itNextState=m_states.begin();
-        itNextState != m_states.end(); itNextState++) {
-      ViterbiNode nextNode;
-      for (std::vector<int>::const_iterator itCurrentState=m_states.begin();
-      itCurrentState != m_states.end(); itCurrentState++) {
-        currentNode = currentLayer[*itCurrentState];
-        transition = m_transitionProbabilities[*itCurrentState][*itNextState];
-        emission = m_emissionProbabilities[*itNextState][*itObservation];
-        trialProbability =
-          currentNode.probability + log10(transition * emission);
-        if (trialProbability > nextNode.probability) {
-          nextNode.probability = trialProbability;
-          nextNode.previousState = *itCurrentState;
+  m_keySequence.clear();
+  if (!m_observationRuns.empty() && m_viterbiMode != VITERBI_RUNLENGTH) {
+    expandObservationRuns();
+  }
+  std::size_t numberOfFrames = m_weightedObservations.empty() ?
+    m_observations.size() : m_weightedObservations.size();
+  for (ObservationRuns::const_iterator itRun = m_observationRuns.begin();
+      itRun != m_observationRuns.end(); itRun++) {
+    numberOfFrames += itRun->second;
+  }
+  if (m_model->getNumberOfStates() == 0 || numberOfFrames == 0) {
+    return;
+  }
+  if (!m_weightedObservations.empty() &&
+      m_model->getNumberOfSymbols() != PitchClass::NUMBER_OF_PITCHCLASSES) {
+    // The weights are indexed by pitch class
+    m_status = Status::HIDDENMARKOVMODEL_INVALID_OBSERVATIONS;
+    return;
+  }
+  States states(numberOfFrames);
+  bool decoded;
+  if (!m_weightedObservations.empty()) {
+    // Only the full lattice handles weighted observations
+    decoded = decodeWeighted(&states);
+  } else {
+    switch (m_viterbiMode) {
+      case VITERBI_CHECKPOINT:
+        decoded = decodeCheckpoint(&states);
+        break;
+      case VITERBI_RUNLENGTH:
+        decoded = decodeRunLength(&states);
+        break;
+      case VITERBI_PARALLEL:
+        decoded = decodeParallel(&states);
+        break;
+      case VITERBI_BEAM:
+        decoded = decodeBeam(&states);
+        break;
+      default:
+        decoded = decodeFull(&states);
+        break;
+    }
+  }
+  if (!decoded) {
+    // Every path is impossible under this model
+    return;
+  }
+  m_keySequence.reserve(states.size());
+  for (States::const_iterator itState = states.begin();
+      itState != states.end(); itState++) {
+    m_keySequence.push_back(Key(m_model->getState(*itState)));
+  }
+  m_status = Status::HIDDENMARKOVMODEL_VITERBI_READY;
+}
+
+bool HiddenMarkovModel::decodeFull(States *states) {
+  const int numberOfStates = m_model->getNumberOfStates();
+  const std::size_t numberOfObservations = m_observations.size();
+  // Flat lattice, one row of numberOfStates entries per observation
+  AlignedDoubleVector scores(numberOfObservations * numberOfStates);
+  AlignedStateVector backPointers(numberOfObservations * numberOfStates, -1);
+  // First layer
+  const double *logStart = m_model->getLogStart(m_observations[0]);
+  for (int state = 0; state < numberOfStates; state++) {
+    scores[state] = logStart[state];
+  }
+  // Remaining layers
+  for (std::size_t t = 1; t < numberOfObservations; t++) {
+    const double *currentLayer = &scores[(t - 1) * numberOfStates];
+    double *nextLayer = &scores[t * numberOfStates];
+    signed char *nextBackPointers = &backPointers[t * numberOfStates];
+    MaxPlus::step(
+      currentLayer,
+      m_model->getLogStep(m_observations[t]),
+      numberOfStates,
+      nextLayer,
+      nextBackPointers);
+  }
+  int lastState = selectLastState(
+    &scores[(numberOfObservations - 1) * numberOfStates]);
+  if (lastState == -1) {
+    return false;
+  }
+  // Backtrace
+  for (std::size_t t = numberOfObservations - 1; t > 0; t--) {
+    (*states)[t] = lastState;
+    lastState = backPointers[t * numberOfStates + lastState];
+  }
+  (*states)[0] = lastState;
+  return true;
+}
+
+bool HiddenMarkovModel::decodeCheckpoint(States *states) {
+  const int numberOfStates = m_model->getNumberOfStates();
+  const std::size_t numberOfObservations = m_observations.size();
+  const std::size_t segmentLength = std::max<std::size_t>(1,
+    static_cast<std::size_t>(std::ceil(std::sqrt(
+      static_cast<double>(numberOfObservations)))));
+  // Layers 0, segmentLength, 2 * segmentLength, ...
+  AlignedDoubleVector checkpoints(
+    ((numberOfObservations - 1) / segmentLength + 1) * numberOfStates);
+  AlignedDoubleVector currentLayer(numberOfStates);
+  AlignedDoubleVector nextLayer(numberOfStates);
+  const double *logStart = m_model->getLogStart(m_observations[0]);
+  for (int state = 0; state < numberOfStates; state++) {
+    currentLayer[state] = checkpoints[state] = logStart[state];
+  }
+  for (std::size_t t = 1; t < numberOfObservations; t++) {
+    MaxPlus::product(
+      &currentLayer[0],
+      m_model->getLogStep(m_observations[t]),
+      numberOfStates,
+      &nextLayer[0]);
+    currentLayer.swap(nextLayer);
+    if (t % segmentLength == 0) {
+      std::copy(currentLayer.begin(), currentLayer.end(),
+        checkpoints.begin() + (t / segmentLength) * numberOfStates);
+    }
+  }
+  int lastState = selectLastState(&currentLayer[0]);
+  if (lastState == -1) {
+    return false;
+  }
+  // Backtrace, one segment at a time from its checkpoint. The segment
+  // starting at layer "first" holds the back-pointers of the layers
+  // first + 1 to last
+  AlignedStateVector backPointers((segmentLength + 1) * numberOfStates);
+  for (std::size_t segment = numberOfObservations > 1 ?
+      (numberOfObservations - 2) / segmentLength + 1 : 0;
+      segment > 0; segment--) {
+    const std::size_t first = (segment - 1) * segmentLength;
+    const std::size_t last =
+      std::min(first + segmentLength, numberOfObservations - 1);
+    std::copy(checkpoints.begin() + (segment - 1) * numberOfStates,
+      checkpoints.begin() + segment * numberOfStates, currentLayer.begin());
+    for (std::size_t t = first + 1; t <= last; t++) {
+      MaxPlus::step(
+        &currentLayer[0],
+        m_model->getLogStep(m_observations[t]),
+        numberOfStates,
+        &nextLayer[0],
+        &backPointers[(t - first) * numberOfStates]);
+      currentLayer.swap(nextLayer);
+    }
+    for (std::size_t t = last; t > first; t--) {
+      (*states)[t] = lastState;
+      lastState = backPointers[(t - first) * numberOfStates + lastState];
+    }
+  }
+  (*states)[0] = lastState;
+  return true;
+}
+
+bool HiddenMarkovModel::decodeRunLength(States *states) {
+  const int numberOfStates = m_model->getNumberOfStates();
+  ObservationRuns runs = getObservationRuns();
+  StepPowers powers(m_model);
+  // One segment per power applied, with the back-pointers at its end
+  std::vector<int> segmentSymbols;
+  std::vector<int> segmentPowers;
+  AlignedStateVector backPointers;
+  // First observation
+  const double *logStart = m_model->getLogStart(runs[0].first);
+  AlignedDoubleVector currentLayer(logStart, logStart + numberOfStates);
+  AlignedDoubleVector nextLayer(numberOfStates);
+  runs[0].second--;
+  // Every run, as the product of the powers given by the bits of its
+  // length, largest first
+  for (ObservationRuns::const_iterator itRun = runs.begin();
+      itRun != runs.end(); itRun++) {
+    const int symbol = itRun->first;
+    const std::size_t length = itRun->second;
+    int power = 0;
+    while ((length >> power) > 1) {
+      power++;
+    }
+    for (; power >= 0 && length; power--) {
+      if (!((length >> power) & 1)) {
+        continue;
+      }
+      segmentSymbols.push_back(symbol);
+      segmentPowers.push_back(power);
+      backPointers.resize(backPointers.size() + numberOfStates);
+      MaxPlus::step(
+        &currentLayer[0],
+        powers.getPower(symbol, power),
+        numberOfStates,
+        &nextLayer[0],
+        &backPointers[backPointers.size() - numberOfStates]);
+      currentLayer.swap(nextLayer);
+    }
+  }
+  int lastState = selectLastState(&currentLayer[0]);
+  if (lastState == -1) {
+    return false;
+  }
+  // Backtrace, expanding every power into the states it crossed
+  std::size_t t = states->size();
+  for (std::size_t segment = segmentSymbols.size(); segment > 0;
+      segment--) {
+    const int symbol = segmentSymbols[segment - 1];
+    const int power = segmentPowers[segment - 1];
+    const int fromState =
+      backPointers[(segment - 1) * numberOfStates + lastState];
+    t -= static_cast<std::size_t>(1) << power;
+    powers.expandPath(symbol, power, fromState, lastState, &(*states)[t]);
+    lastState = fromState;
+  }
+  (*states)[0] = lastState;
+  return true;
+}
+
+// How far the true layer is from the speculative one plus a constant,
+// together with what rounding the next step of both can add: a decision
+// of the next speculative step that wins by more than twice this is
+// also the decision of the true step. Infinite when the two layers do
+// not have the same impossible states.
+static double getDeviation(
+  const double *trueLayer, const double *speculativeLayer,
+  int numberOfStates, double stepMagnitude) {
+  const double impossible = -std::numeric_limits<double>::infinity();
+  double offset = 0.0;
+  double deviation = 0.0;
+  double magnitude = 0.0;
+  bool first = true;
+  for (int state = 0; state < numberOfStates; state++) {
+    bool finite = trueLayer[state] != impossible;
+    if (finite != (speculativeLayer[state] != impossible)) {
+      return std::numeric_limits<double>::infinity();
+    }
+    if (!finite) {
+      continue;
+    }
+    double difference = trueLayer[state] - speculativeLayer[state];
+    if (first) {
+      offset = difference;
+      first = false;
+    }
+    deviation = std::max(deviation, std::abs(difference - offset));
+    magnitude = std::max(magnitude, std::max(
+      std::abs(trueLayer[state]), std::abs(speculativeLayer[state])));
+  }
+  if (first) {
+    return std::numeric_limits<double>::infinity();
+  }
+  // Twice the rounding of the differences and of both candidates
+  return deviation + std::numeric_limits<double>::epsilon() *
+    (2 * (magnitude + stepMagnitude) + std::abs(offset));
+}
+
+bool HiddenMarkovModel::decodeParallel(States *states) {
+  const int numberOfStates = m_model->getNumberOfStates();
+  const std::size_t numberOfObservations = m_observations.size();
+  std::size_t numberOfChunks = std::min<std::size_t>(
+    std::max(m_numberOfThreads, 1),
+    numberOfObservations / MINIMUM_CHUNK);
+  if (numberOfChunks <= 1) {
+    return decodeFull(states);
+  }
+  const double impossible = -std::numeric_limits<double>::infinity();
+  AlignedDoubleVector scores(numberOfObservations * numberOfStates);
+  AlignedStateVector backPointers(numberOfObservations * numberOfStates, -1);
+  // Best candidate minus the runner-up, of every speculative decision
+  AlignedDoubleVector margins(numberOfObservations * numberOfStates);
+  const double *logStart = m_model->getLogStart(m_observations[0]);
+  std::copy(logStart, logStart + numberOfStates, scores.begin());
+  double stepMagnitude = 0.0;
+  for (int symbol = 0; symbol < m_model->getNumberOfSymbols(); symbol++) {
+    const double *logStep = m_model->getLogStep(symbol);
+    for (int i = 0; i < numberOfStates * numberOfStates; i++) {
+      if (logStep[i] != impossible) {
+        stepMagnitude = std::max(stepMagnitude, std::abs(logStep[i]));
+      }
+    }
+  }
+  // Chunk c holds the layers chunkStart[c] to chunkStart[c + 1] - 1
+  std::vector<std::size_t> chunkStart(numberOfChunks + 1);
+  for (std::size_t chunk = 0; chunk <= numberOfChunks; chunk++) {
+    chunkStart[chunk] =
+      1 + (numberOfObservations - 1) * chunk / numberOfChunks;
+  }
+  // Speculative pass, the first chunk is exact
+  std::vector<std::thread> threads;
+  AlignedDoubleVector uniformLayer(numberOfStates, 0.0);
+  for (std::size_t chunk = 0; chunk < numberOfChunks; chunk++) {
+    const double *firstLayer =
+      chunk == 0 ? &scores[0] : &uniformLayer[0];
+    double *chunkScores = &scores[chunkStart[chunk] * numberOfStates];
+    signed char *chunkBackPointers =
+      &backPointers[chunkStart[chunk] * numberOfStates];
+    double *chunkMargins = &margins[chunkStart[chunk] * numberOfStates];
+    const int *chunkObservations = &m_observations[chunkStart[chunk]];
+    const std::size_t chunkLength =
+      chunkStart[chunk + 1] - chunkStart[chunk];
+    const bool exact = chunk == 0;
+    CompiledKeyModel::ConstPointer model = m_model;
+    std::thread thread([=]() {
+      const double *currentLayer = firstLayer;
+      for (std::size_t t = 0; t < chunkLength; t++) {
+        if (exact) {
+          MaxPlus::step(
+            currentLayer,
+            model->getLogStep(chunkObservations[t]),
+            numberOfStates,
+            &chunkScores[t * numberOfStates],
+            &chunkBackPointers[t * numberOfStates]);
+        } else {
+          MaxPlus::stepWithMargins(
+            currentLayer,
+            model->getLogStep(chunkObservations[t]),
+            numberOfStates,
+            &chunkScores[t * numberOfStates],
+            &chunkBackPointers[t * numberOfStates],
+            &chunkMargins[t * numberOfStates]);
         }
+        currentLayer = &chunkScores[t * numberOfStates];
       }
-      nextLayer[*itNextState] = nextNode;
+    });
+    threads.push_back(std::move(thread));
+  }
+  for (std::size_t chunk = 0; chunk < numberOfChunks; chunk++) {
+    threads[chunk].join();
+  }
+  // Fix-up, in order, of the true layers. Once they are parallel to the
+  // speculative ones, most speculative decisions win by more than the
+  // rounding can change, and only their scores are added; the others
+  // are taken again from every candidate, as the full recursion does
+  AlignedDoubleVector trueLayer(
+    scores.begin() + (chunkStart[1] - 1) * numberOfStates,
+    scores.begin() + chunkStart[1] * numberOfStates);
+  AlignedDoubleVector nextLayer(numberOfStates);
+  for (std::size_t chunk = 1; chunk < numberOfChunks; chunk++) {
+    const double *speculativeLayer = &uniformLayer[0];
+    for (std::size_t t = chunkStart[chunk]; t < chunkStart[chunk + 1];
+        t++) {
+      const double *logStep = m_model->getLogStep(m_observations[t]);
+      const double *layerMargins = &margins[t * numberOfStates];
+      signed char *layerBackPointers = &backPointers[t * numberOfStates];
+      const double threshold = 2 * getDeviation(&trueLayer[0],
+        speculativeLayer, numberOfStates, stepMagnitude);
+      // Without a finite candidate (a NaN margin) there is none either
+      // in the true step, once both layers have the same impossible states
+      int uncertain = 0;
+      for (int state = 0; state < numberOfStates; state++) {
+        uncertain += !(layerMargins[state] > threshold) &&
+          !std::isnan(layerMargins[state]);
+      }
+      speculativeLayer = &scores[t * numberOfStates];
+      if (threshold == std::numeric_limits<double>::infinity() ||
+          uncertain > numberOfStates / 2) {
+        MaxPlus::step(
+          &trueLayer[0], logStep, numberOfStates,
+          &nextLayer[0], layerBackPointers);
+        trueLayer.swap(nextLayer);
+        continue;
+      }
+      for (int state = 0; state < numberOfStates; state++) {
+        if (layerMargins[state] > threshold) {
+          int from = layerBackPointers[state];
+          nextLayer[state] =
+            trueLayer[from] + logStep[from * numberOfStates + state];
+          continue;
+        }
+        if (std::isnan(layerMargins[state])) {
+          nextLayer[state] = impossible;
+          continue;
+        }
+        double best = impossible;
+        int bestState = -1;
+        for (int from = 0; from < numberOfStates; from++) {
+          double trial =
+            trueLayer[from] + logStep[from * numberOfStates + state];
+          if (trial > best) {
+            best = trial;
+            bestState = from;
+          }
+        }
+        nextLayer[state] = best;
+        layerBackPointers[state] = static_cast<signed char>(bestState);
+      }
+      trueLayer.swap(nextLayer);
     }
-    currentLayer = nextLayer;
-    m_viterbi.push_back(currentLayer);
   }
-  ViterbiLayer lastLayer;
-  int lastState = -1;
-  ProbabilityVector probabilities = ProbabilityVector(24, 0);
-  while (!m_viterbi.empty()) {
-    lastLayer = m_viterbi.back();
-    if (lastState == -1) {
-      for (ViterbiLayer::const_iterator itLastState = lastLayer.begin();
-          itLastState != lastLayer.end(); itLastState++) {
-        ViterbiNode lastNode = itLastState->second;
-        probabilities[itLastState->first] = lastNode.probability;
-        if (lastNode.probability > maximumProbability) {
-          maximumProbability = lastNode.probability;
-          lastState = itLastState->first;
+  int lastState = selectLastState(&trueLayer[0]);
+  if (lastState == -1) {
+    return false;
+  }
+  for (std::size_t t = numberOfObservations - 1; t > 0; t--) {
+    (*states)[t] = lastState;
+    lastState = backPointers[t * numberOfStates + lastState];
+  }
+  (*states)[0] = lastState;
+  return true;
+}
+
+// Keeps the finite states of a layer within the beam of the best one,
+// in increasing order, and returns the number of dropped ones
+static std::size_t selectActiveStates(
+  const double *layer,
+  int numberOfStates,
+  double beamWidth,
+  std::vector<int> *activeStates) {
+  double best = -std::numeric_limits<double>::infinity();
+  int numberOfFiniteStates = 0;
+  for (int state = 0; state < numberOfStates; state++) {
+    if (layer[state] > best) {
+      best = layer[state];
+    }
+  }
+  activeStates->clear();
+  if (best == -std::numeric_limits<double>::infinity()) {
+    return 0;
+  }
+  const double threshold = best - beamWidth;
+  for (int state = 0; state < numberOfStates; state++) {
+    if (layer[state] == -std::numeric_limits<double>::infinity()) {
+      continue;
+    }
+    numberOfFiniteStates++;
+    if (layer[state] >= threshold) {
+      activeStates->push_back(state);
+    }
+  }
+  return numberOfFiniteStates - activeStates->size();
+}
+
+bool HiddenMarkovModel::decodeBeam(States *states) {
+  const int numberOfStates = m_model->getNumberOfStates();
+  const std::size_t numberOfObservations = m_observations.size();
+  const double impossible = -std::numeric_limits<double>::infinity();
+  AlignedDoubleVector scores(numberOfObservations * numberOfStates);
+  AlignedStateVector backPointers(numberOfObservations * numberOfStates, -1);
+  std::vector<int> activeStates;
+  activeStates.reserve(numberOfStates);
+  m_pruningStatistics = PruningStatistics();
+  // First layer
+  const double *logStart = m_model->getLogStart(m_observations[0]);
+  for (int state = 0; state < numberOfStates; state++) {
+    scores[state] = logStart[state];
+  }
+  m_pruningStatistics.numberOfBeamPrunedStates += selectActiveStates(
+    &scores[0], numberOfStates, m_beamWidth, &activeStates);
+  m_pruningStatistics.numberOfActiveStates += activeStates.size();
+  // Remaining layers, same visiting order and strict comparison as
+  // MaxPlus::step, so that ties go to the lowest state
+  for (std::size_t t = 1; t < numberOfObservations; t++) {
+    if (activeStates.empty()) {
+      break;
+    }
+    const double *currentLayer = &scores[(t - 1) * numberOfStates];
+    double *nextLayer = &scores[t * numberOfStates];
+    signed char *nextBackPointers = &backPointers[t * numberOfStates];
+    const double *logEmission = m_model->getLogEmission(m_observations[t]);
+    const double *logStep = m_model->getLogStep(m_observations[t]);
+    for (int to = 0; to < numberOfStates; to++) {
+      if (logEmission[to] == impossible) {
+        nextLayer[to] = impossible;
+        m_pruningStatistics.numberOfImpossibleStates++;
+        continue;
+      }
+      double best = impossible;
+      int bestState = -1;
+      for (std::vector<int>::const_iterator itFrom = activeStates.begin();
+          itFrom != activeStates.end(); itFrom++) {
+        double trial =
+          currentLayer[*itFrom] + logStep[*itFrom * numberOfStates + to];
+        if (trial > best) {
+          best = trial;
+          bestState = *itFrom;
         }
       }
+      nextLayer[to] = best;
+      nextBackPointers[to] = static_cast<signed char>(bestState);
     }
-    m_keySequence.push_back(Key(lastState));
-    currentNode = lastLayer.at(lastState);
-    lastState = currentNode.previousState;
-    m_viterbi.pop_back();
-  }
-  std::reverse(m_keySequence.begin(), m_keySequence.end());
-  m_maximumProbability = maximumProbability;
-  m_probabilityVector = probabilities;
-  m_status = Status::HIDDENMARKOVMODEL_VITERBI_READY;
-  return;
+    m_pruningStatistics.numberOfBeamPrunedStates += selectActiveStates(
+      nextLayer, numberOfStates, m_beamWidth, &activeStates);
+    m_pruningStatistics.numberOfActiveStates += activeStates.size();
+  }
+  m_pruningStatistics.numberOfFrames = numberOfObservations;
+  m_pruningStatistics.averageActiveStates =
+    static_cast<double>(m_pruningStatistics.numberOfActiveStates) /
+    numberOfObservations;
+  if (activeStates.empty()) {
+    return false;
+  }
+  int lastState = selectLastState(
+    &scores[(numberOfObservations - 1) * numberOfStates]);
+  // Backtrace
+  for (std::size_t t = numberOfObservations - 1; t > 0; t--) {
+    (*states)[t] = lastState;
+    lastState = backPointers[t * numberOfStates + lastState];
+  }
+  (*states)[0] = lastState;
+  return true;
+}
+
+bool HiddenMarkovModel::decodeWeighted(States *states) {
+  const int numberOfStates = m_model->getNumberOfStates();
+  const std::size_t numberOfObservations = m_weightedObservations.size();
+  const double *logInitial = m_model->getLogInitial();
+  const double *logTransition = m_model->getLogTransition();
+  AlignedDoubleVector scores(numberOfObservations * numberOfStates);
+  AlignedStateVector backPointers(numberOfObservations * numberOfStates, -1);
+  std::vector<double> logEmission(numberOfStates);
+  // First layer
+  m_model->getWeightedLogEmission(
+    m_weightedObservations[0].data(), &logEmission[0]);
+  for (int state = 0; state < numberOfStates; state++) {
+    scores[state] = logInitial[state] + logEmission[state];
+  }
+  // Remaining layers, the emission does not depend on the previous
+  // state, so it is added after the maximization
+  for (std::size_t t = 1; t < numberOfObservations; t++) {
+    const double *currentLayer = &scores[(t - 1) * numberOfStates];
+    double *nextLayer = &scores[t * numberOfStates];
+    MaxPlus::step(
+      currentLayer,
+      logTransition,
+      numberOfStates,
+      nextLayer,
+      &backPointers[t * numberOfStates]);
+    m_model->getWeightedLogEmission(
+      m_weightedObservations[t].data(), &logEmission[0]);
+    for (int state = 0; state < numberOfStates; state++) {
+      nextLayer[state] += logEmission[state];
+    }
+  }
+  int lastState = selectLastState(
+    &scores[(numberOfObservations - 1) * numberOfStates]);
+  if (lastState == -1) {
+    return false;
+  }
+  // Backtrace
+  for (std::size_t t = numberOfObservations - 1; t > 0; t--) {
+    (*states)[t] = lastState;
+    lastState = backPointers[t * numberOfStates + lastState];
+  }
+  (*states)[0] = lastState;
+  return true;
+}
+
+HiddenMarkovModel::ObservationRuns
+HiddenMarkovModel::getObservationRuns() const {
+  if (!m_observationRuns.empty()) {
+    return m_observationRuns;
+  }
+  ObservationRuns runs;
+  for (Observations::const_iterator itObs = m_observations.begin();
+      itObs != m_observations.end(); itObs++) {
+    if (runs.empty() || runs.back().first != *itObs) {
+      runs.push_back(std::make_pair(*itObs, 0));
+    }
+    runs.back().second++;
+  }
+  return runs;
+}
+
+// Fills the probability vector with the last layer and returns the
+// most likely last state, ties are resolved towards the lowest state
+int HiddenMarkovModel::selectLastState(const double *lastLayer) {
+  const int numberOfStates = m_model->getNumberOfStates();
+  double maximumProbability = -std::numeric_limits<double>::infinity();
+  int lastState = -1;
+  ProbabilityVector probabilities = ProbabilityVector(Key::NUMBER_OF_KEYS, 0);
+  for (int state = 0; state < numberOfStates; state++) {
+    probabilities[m_model->getState(state)] = lastLayer[state];
+    if (lastLayer[state] > maximumProbability) {
+      maximumProbability = lastLayer[state];
+      lastState = state;
+    }
+  }
+  if (lastState != -1) {
+    m_maximumProbability = maximumProbability;
+    m_probabilityVector = probabilities;
+  }
+  return lastState;
+}
+
+std::vector<HiddenMarkovModel::ProbabilityVector>
+HiddenMarkovModel::runBatchedViterbi(
+  const std::vector<PitchClass> &observations,
+  const std::vector<CompiledKeyModel::ConstPointer> &models) {
+  return decodeBatch(toObservations(observations), models);
+}
+
+std::vector<HiddenMarkovModel::ProbabilityVector>
+HiddenMarkovModel::runBatchedViterbi(
+  const std::vector<Key> &observations,
+  const std::vector<CompiledKeyModel::ConstPointer> &models) {
+  return decodeBatch(toObservations(observations), models);
+}
+
+// Same recursion as runViterbi() without the back-pointers. The
+// observations are swept in blocks, and every model consumes the
+// block while it is still in cache. Each result holds the last layer
+// of scores indexed by key, i.e., what getProbabilityVector() returns
+// after runViterbi() with the same model. Models without states (or a
+// NULL model) and an empty observation stream give an empty vector.
+std::vector<HiddenMarkovModel::ProbabilityVector>
+HiddenMarkovModel::decodeBatch(
+  const Observations &observations,
+  const std::vector<CompiledKeyModel::ConstPointer> &models) {
+  const std::size_t numberOfModels = models.size();
+  const std::size_t numberOfObservations = observations.size();
+  std::vector<ProbabilityVector> probabilities(numberOfModels);
+  if (numberOfObservations == 0) {
+    return probabilities;
+  }
+  // Two layers per model, swapped after every step
+  std::vector<AlignedDoubleVector> currentLayers(numberOfModels);
+  std::vector<AlignedDoubleVector> nextLayers(numberOfModels);
+  for (std::size_t model = 0; model < numberOfModels; model++) {
+    if (!models[model] || models[model]->getNumberOfStates() == 0) {
+      continue;
+    }
+    const int numberOfStates = models[model]->getNumberOfStates();
+    const double *logStart = models[model]->getLogStart(observations[0]);
+    currentLayers[model].assign(logStart, logStart + numberOfStates);
+    nextLayers[model].resize(numberOfStates);
+  }
+  for (std::size_t blockStart = 1; blockStart < numberOfObservations;
+      blockStart += OBSERVATION_BLOCK) {
+    const std::size_t blockEnd =
+      std::min(blockStart + OBSERVATION_BLOCK, numberOfObservations);
+    for (std::size_t model = 0; model < numberOfModels; model++) {
+      if (currentLayers[model].empty()) {
+        continue;
+      }
+      const CompiledKeyModel &compiledModel = *models[model];
+      const int numberOfStates = compiledModel.getNumberOfStates();
+      for (std::size_t t = blockStart; t < blockEnd; t++) {
+        MaxPlus::product(
+          &currentLayers[model][0],
+          compiledModel.getLogStep(observations[t]),
+          numberOfStates,
+          &nextLayers[model][0]);
+        currentLayers[model].swap(nextLayers[model]);
+      }
+    }
+  }
+  for (std::size_t model = 0; model < numberOfModels; model++) {
+    if (currentLayers[model].empty()) {
+      continue;
+    }
+    probabilities[model].assign(Key::NUMBER_OF_KEYS, 0);
+    for (int state = 0; state < models[model]->getNumberOfStates();
+        state++) {
+      probabilities[model][models[model]->getState(state)] =
+        currentLayers[model][state];
+    }
+  }
+  return probabilities;
 }
 
 Key::KeySequence HiddenMarkovModel::getKeySequence() {
@@ -259,6 +874,11 @@ double HiddenMarkovModel::getMaximumProbability() const {
   return m_maximumProbability;
 }
 
+HiddenMarkovModel::PruningStatistics
+HiddenMarkovModel::getPruningStatistics() const {
+  return m_pruningStatistics;
+}
+
 int HiddenMarkovModel::getStatus() const {
   return m_status;
 }
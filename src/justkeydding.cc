@@ -31,10 +31,201 @@ using justkeydding::Key;
 using justkeydding::KeyProfile;
 using justkeydding::KeyTransition;
 using justkeydding::HiddenMarkovModel;
+using justkeydding::CompiledKeyModel;
+using justkeydding::GlobalKeyEstimator;
+using justkeydding::ForwardBackward;
+using justkeydding::StreamingViterbiDecoder;
+using justkeydding::AudioChromaStream;
+using justkeydding::ChromagramBuffer;
+using justkeydding::ModelBundle;
+using justkeydding::Ensemble;
+using justkeydding::FeatureCache;
 using justkeydding::Chromagram;
 using justkeydding::Status;
 using justkeydding::Midi;
 
+static void printCacheStatistics(const FeatureCache *featureCache) {
+    if (!featureCache) {
+        return;
+    }
+    const FeatureCache::Statistics &statistics =
+        featureCache->getStatistics();
+    std::cerr << "Cache: "
+        << statistics.chromagramHits << " chromagram hits, "
+        << statistics.chromagramMisses << " misses, "
+        << statistics.resultHits << " result hits, "
+        << statistics.resultMisses << " misses, "
+        << statistics.evictedEntries << " evicted" << std::endl;
+}
+
+// Work of the NNLS of the chroma extraction, with another solver than
+// the default one
+static void printNNLSStatistics(
+    const NNLSChroma::NNLSStatistics &statistics,
+    int nnlsSolver) {
+    if (nnlsSolver == NNLSChroma::LawsonHansonSolver) {
+        return;
+    }
+    std::cerr << "NNLS: " << statistics.solves << " solves, "
+        << static_cast<double>(statistics.iterations) /
+            std::max(statistics.solves, 1L)
+        << " iterations per solve";
+    if (nnlsSolver == NNLSChroma::WarmStartSolver) {
+        std::cerr << ", " << statistics.warmStartHits << " of "
+            << statistics.warmStarts << " warm starts kept whole ("
+            << 100.0 * statistics.warmStartHits /
+                std::max(statistics.warmStarts, 1L)
+            << "%), "
+            << static_cast<double>(statistics.seededColumnsKept) /
+                std::max(statistics.solves, 1L)
+            << " seeded columns kept per solve";
+    }
+    std::cerr << ", " << statistics.unconverged
+        << " stopped at the iteration limit" << std::endl;
+}
+
+// Prints the result of the run and keeps it in the cache, if any
+static int printResult(
+    const std::string &result,
+    FeatureCache *featureCache,
+    const std::string &resultKey,
+    const std::string &modelId) {
+    std::cout << result;
+    if (featureCache && !resultKey.empty()) {
+        featureCache->storeResult(resultKey, modelId, result);
+    }
+    printCacheStatistics(featureCache);
+    return 0;
+}
+
+// Observations a frame of the streaming decoder may wait for its key
+static const std::size_t STREAMING_MAXIMUM_LAG = 4096;
+
+// Adds the keys just committed by the streaming decoder to the first
+// local key (-1 until there is one) and the histogram of the others,
+// which is all the second stage needs
+static void countLocalKeys(
+    const Key::KeySequence &committed,
+    int *firstKey,
+    GlobalKeyEstimator::KeyHistogram *histogram) {
+    for (Key::KeySequence::const_iterator itKey = committed.begin();
+        itKey != committed.end(); itKey++) {
+        if (*firstKey == -1) {
+            *firstKey = itKey->getInt();
+        } else {
+            (*histogram)[itKey->getInt()]++;
+        }
+    }
+}
+
+// Local keys of an audio file, decoded while it is read: each chroma
+// frame goes to the incremental decoder as soon as it is extracted, so
+// that only the frames and keys not out yet are kept in memory, and the
+// keys out are only counted (see countLocalKeys)
+static int decodeAudioStream(
+    const std::string &filename,
+    double warmUpSeconds,
+    int numberOfThreads,
+    int nnlsSolver,
+    CompiledKeyModel::ConstPointer keyModel,
+    int *firstKey,
+    GlobalKeyEstimator::KeyHistogram *histogram) {
+    AudioChromaStream stream(filename, warmUpSeconds, numberOfThreads,
+        nnlsSolver);
+    StreamingViterbiDecoder decoder(keyModel, STREAMING_MAXIMUM_LAG);
+    ChromagramBuffer frames;
+    PitchClass::PitchClassSequence pitchClassSequence;
+    std::size_t numberOfFrames = 0;
+    while (stream.read(&frames)) {
+        if (frames.isEmpty()) {
+            continue;
+        }
+        // As in Chromagram::getPitchClassSequence, only the last frame
+        // of a run with the same discrete values counts, so the last
+        // one waits for the next read
+        const std::size_t last = frames.getNumberOfFrames() - 1;
+        pitchClassSequence.clear();
+        for (std::size_t frame = 0; frame < last; frame++) {
+            if (!frames.isSameDiscreteFrame(frame, frame + 1)) {
+                Chromagram::appendPitchClasses(
+                    frames, frame, &pitchClassSequence);
+            }
+        }
+        for (std::size_t i = 0; i < pitchClassSequence.size(); i++) {
+            decoder.addObservation(pitchClassSequence[i]);
+        }
+        numberOfFrames += last;
+        ChromagramBuffer pending;
+        const float *chrVector = frames.getFrame(last);
+        std::copy(chrVector, chrVector + PitchClass::NUMBER_OF_PITCHCLASSES,
+            pending.appendFrame(frames.getTimestamp(last)));
+        frames = pending;
+        countLocalKeys(decoder.takeCommittedKeys(), firstKey, histogram);
+    }
+    if (stream.getStatus() != Status::AUDIOCHROMASTREAM_READY) {
+        return stream.getStatus();
+    }
+    if (!frames.isEmpty()) {
+        pitchClassSequence.clear();
+        Chromagram::appendPitchClasses(frames, 0, &pitchClassSequence);
+        for (std::size_t i = 0; i < pitchClassSequence.size(); i++) {
+            decoder.addObservation(pitchClassSequence[i]);
+        }
+        numberOfFrames++;
+    }
+    decoder.finish();
+    countLocalKeys(decoder.takeCommittedKeys(), firstKey, histogram);
+    StreamingViterbiDecoder::LatencyStatistics latencyStatistics =
+        decoder.getLatencyStatistics();
+    std::cerr << "Streamed " << numberOfFrames << " frames tuned to "
+        << stream.getParameters().tuning << " Hz, "
+        << decoder.getNumberOfObservations() << " observations, mean lag "
+        << latencyStatistics.meanLag << " ("
+        << latencyStatistics.numberOfForcedCommits
+        << " forced commits)" << std::endl;
+    printNNLSStatistics(stream.getNNLSStatistics(), nnlsSolver);
+    return decoder.getStatus();
+}
+
+// Local keys of the observations, the weighted ones if any, under
+// keyModel
+static int decodeLocalKeys(
+    const PitchClass::PitchClassSequence &pitchClassSequence,
+    const HiddenMarkovModel::WeightedObservations &chromagramSequence,
+    CompiledKeyModel::ConstPointer keyModel,
+    HiddenMarkovModel::enViterbiMode viterbiMode,
+    int numberOfThreads,
+    double beamWidth,
+    Key::KeySequence *keySequence) {
+    HiddenMarkovModel hmm = chromagramSequence.empty() ?
+        HiddenMarkovModel(pitchClassSequence, keyModel) :
+        HiddenMarkovModel(chromagramSequence, keyModel);
+    hmm.setViterbiMode(viterbiMode);
+    if (numberOfThreads > 0) {
+        hmm.setNumberOfThreads(numberOfThreads);
+    }
+    hmm.setBeamWidth(beamWidth);
+    hmm.runViterbi();
+    int status = hmm.getStatus();
+    if (status != Status::HIDDENMARKOVMODEL_VITERBI_READY) {
+        return status;
+    }
+    if (viterbiMode == HiddenMarkovModel::VITERBI_BEAM &&
+        chromagramSequence.empty()) {
+        HiddenMarkovModel::PruningStatistics pruningStatistics =
+            hmm.getPruningStatistics();
+        std::cerr << "Active states per frame: "
+            << pruningStatistics.averageActiveStates << " of "
+            << keyModel->getNumberOfStates() << " ("
+            << pruningStatistics.numberOfImpossibleStates
+            << " impossible, "
+            << pruningStatistics.numberOfBeamPrunedStates
+            << " outside of the beam)" << std::endl;
+    }
+    *keySequence = hmm.getKeySequence();
+    return status;
+}
+
 int main(int argc, char *argv[]) {
     optparse::OptionParserExcept parser;
     initOptionParser(&parser);
@@ -46,10 +237,24 @@ int main(int argc, char *argv[]) {
     KeyProfile::KeyProfileArray minorCustomKeyProfile;
     KeyTransition::KeyTransitionArray customKeyTransition;
     std::string filename;
+    std::string bundleFilename;
+    std::string chromaCacheFilename;
+    std::string cacheDirectory;
+    std::uint64_t cacheSize = FeatureCache::DEFAULT_MAXIMUM_BYTES;
+    std::string modelName;
+    std::string ensembleName;
     int status;
     bool justEvaluation;
     bool justProbabilities;
+    bool justPosteriors;
     bool chromaOnly;
+    bool weightedObservations;
+    bool localScores;
+    double streamingWarmUp = -1;
+    HiddenMarkovModel::enViterbiMode viterbiMode;
+    int numberOfThreads = 0;
+    int nnlsSolver = NNLSChroma::LawsonHansonSolver;
+    double beamWidth = std::numeric_limits<double>::infinity();
     try {
         const optparse::Values &options = parser.parse_args(argc, argv);
         const std::vector<std::string> args = parser.args();
@@ -63,12 +268,14 @@ int main(int argc, char *argv[]) {
             // What kind of file are we reading
             std::string format = static_cast<std::string>(
                 options.get("inputformat"));
-            if (format == ".wav") {
+            if (format == "wav") {
                 inputType = justkeydding::INPUT_WAV;
-            } else if (format == ".csv") {
+            } else if (format == "csv") {
                 inputType = justkeydding::INPUT_CSV;
-            } else if (format == ".midi") {
+            } else if (format == "midi") {
                 inputType = justkeydding::INPUT_MIDI;
+            } else if (format == "chroma") {
+                inputType = justkeydding::INPUT_CHROMA;
             }
         } else {
             // The user did not provide a file format, let's find out
@@ -85,12 +292,33 @@ int main(int argc, char *argv[]) {
                 inputType = justkeydding::INPUT_CSV;
             } else if (extension == ".midi" || extension == ".mid") {
                 inputType = justkeydding::INPUT_MIDI;
+            } else if (extension == ".chroma") {
+                inputType = justkeydding::INPUT_CHROMA;
             } else {
-                std::cout << "It seems the input is neither a wav, csv, nor midi file. If it is, please specify explicitly using -f." << std::endl;
+                std::cout << "It seems the input is neither a wav, csv, chroma, nor midi file. If it is, please specify explicitly using -f." << std::endl;
                 parser.print_help();
                 return 0;
             }
         }
+        if (options.is_set("bundle")) {
+            // The model comes precompiled from a bundle file
+            bundleFilename = static_cast<std::string>(
+                options.get("bundle"));
+            if (options.is_set("ensemble")) {
+                ensembleName = static_cast<std::string>(
+                    options.get("ensemble"));
+            } else if (options.is_set("model")) {
+                modelName = static_cast<std::string>(options.get("model"));
+            } else {
+                std::cout << "You must select a model of the bundle with -n, or an ensemble with -E." << std::endl;
+                parser.print_help();
+                return 0;
+            }
+        } else if (options.is_set("ensemble")) {
+            std::cout << "Ensembles come from a bundle, given with -B." << std::endl;
+            parser.print_help();
+            return 0;
+        }
         if (options.is_set("customkeyprofiles")) {
             // The user wants to define custom key profiles
             std::string arrayStr = static_cast<std::string>(
@@ -146,15 +374,183 @@ int main(int argc, char *argv[]) {
         }
         justEvaluation = options.is_set_by_user("evaluate");
         justProbabilities = options.is_set_by_user("probabilities");
+        justPosteriors = options.is_set_by_user("posteriors");
         chromaOnly = options.is_set_by_user("chromaonly");
+        localScores = options.is_set_by_user("localscores");
+        if (options.is_set("cache")) {
+            cacheDirectory = static_cast<std::string>(options.get("cache"));
+        }
+        if (options.is_set("cachesize")) {
+            cacheSize = static_cast<std::uint64_t>(
+                static_cast<double>(options.get("cachesize")) * 1e6);
+        }
+        if (options.is_set("chromacache")) {
+            chromaCacheFilename = static_cast<std::string>(
+                options.get("chromacache"));
+        }
+        weightedObservations = static_cast<std::string>(
+            options.get("observations")) == "weighted";
+        if (options.is_set("streaming")) {
+            streamingWarmUp = static_cast<double>(options.get("streaming"));
+            if (streamingWarmUp < 0 || inputType != justkeydding::INPUT_WAV ||
+                chromaOnly || justPosteriors) {
+                std::cout << "Streaming needs a wav input, a warm-up of zero or more seconds, and neither -c nor -P." << std::endl;
+                parser.print_help();
+                return 0;
+            }
+        }
+        std::string viterbi = static_cast<std::string>(
+            options.get("viterbi"));
+        if (options.is_set("threads")) {
+            numberOfThreads = static_cast<int>(options.get("threads"));
+        }
+        if (options.is_set("beam")) {
+            beamWidth = static_cast<double>(options.get("beam"));
+        }
+        std::string nnls = static_cast<std::string>(options.get("nnls"));
+        if (nnls == "warmstart") {
+            nnlsSolver = NNLSChroma::WarmStartSolver;
+        } else if (nnls == "gram") {
+            nnlsSolver = NNLSChroma::GramActiveSetSolver;
+        }
+        if (viterbi == "checkpoint") {
+            viterbiMode = HiddenMarkovModel::VITERBI_CHECKPOINT;
+        } else if (viterbi == "runlength") {
+            viterbiMode = HiddenMarkovModel::VITERBI_RUNLENGTH;
+        } else if (viterbi == "parallel") {
+            viterbiMode = HiddenMarkovModel::VITERBI_PARALLEL;
+        } else if (viterbi == "beam") {
+            viterbiMode = HiddenMarkovModel::VITERBI_BEAM;
+        } else {
+            viterbiMode = HiddenMarkovModel::VITERBI_FULL;
+        }
+        // Weighted observations are chroma frames, only decoded by the
+        // full lattice; the posteriors and the streaming decoder are
+        // those of the expanded observations
+        if (weightedObservations && (inputType == justkeydding::INPUT_MIDI ||
+            viterbiMode != HiddenMarkovModel::VITERBI_FULL ||
+            justPosteriors || streamingWarmUp >= 0)) {
+            std::cout << "Weighted observations need an audio input (not MIDI) and the full Viterbi decoder, and neither -P nor -S." << std::endl;
+            parser.print_help();
+            return 0;
+        }
+        if (!ensembleName.empty() &&
+            (streamingWarmUp >= 0 || justPosteriors)) {
+            std::cout << "Ensembles need neither -S nor -P." << std::endl;
+            parser.print_help();
+            return 0;
+        }
+        // The local scores of an ensemble come from a single sweep over
+        // the expanded observations, shared by every model
+        if (localScores && (ensembleName.empty() || weightedObservations)) {
+            std::cout << "Local scores need an ensemble (-E) and expanded observations." << std::endl;
+            parser.print_help();
+            return 0;
+        }
     }
     catch (int ret_code) {
         std::cerr << "Error " << ret_code << std::endl;
         return ret_code;
     }
+    // Transition and emission probabilities, compiled once
+    CompiledKeyModel::ConstPointer keyModel;
+    // Or the models of an ensemble, with their transitions
+    std::unique_ptr<Ensemble> ensemble;
+    if (!bundleFilename.empty()) {
+        // Or already compiled, straight from the mapped bundle
+        ModelBundle bundle(bundleFilename);
+        if ((status = bundle.getStatus()) != Status::MODELBUNDLE_READY) {
+            std::cerr << "There was an error while"
+                        " reading the model bundle." << std::endl;
+            return status;
+        }
+        if (!ensembleName.empty()) {
+            ensemble.reset(new Ensemble(bundle, ensembleName));
+            if ((status = ensemble->getStatus()) ==
+                Status::ENSEMBLE_MODEL_ERROR) {
+                std::cerr << "The bundle has no ensemble called "
+                    << ensembleName << ", or not all of its models."
+                    << std::endl;
+                return status;
+            }
+            keyModel = ensemble->getModels().front();
+        } else {
+            keyModel = bundle.getModel(modelName);
+            if (!keyModel || !bundle.getKeyTransitionArray(
+                    modelName, &customKeyTransition)) {
+                std::cerr << "The bundle has no model called "
+                    << modelName << "." << std::endl;
+                return Status::MODELBUNDLE_FORMAT_ERROR;
+            }
+        }
+        keyTransition = "custom";
+    }
+    KeyTransition transitions(keyTransition, customKeyTransition);
+    if (!keyModel) {
+        keyModel = std::make_shared<CompiledKeyModel>(
+            KeyProfile(
+                majorKeyProfile,
+                minorKeyProfile,
+                majorCustomKeyProfile,
+                minorCustomKeyProfile),
+            transitions);
+    }
+    // Opt-in cache of chromagrams and results of audio files
+    std::unique_ptr<FeatureCache> featureCache;
+    std::string resultKey;
+    std::string modelId;
+    if (!cacheDirectory.empty()) {
+        featureCache.reset(new FeatureCache(cacheDirectory, cacheSize));
+        if ((status = featureCache->getStatus()) !=
+            Status::FEATURECACHE_READY) {
+            std::cerr << "There was an error while"
+                        " opening the cache directory." << std::endl;
+            return status;
+        }
+    }
+    if (featureCache && inputType == justkeydding::INPUT_WAV &&
+        !chromaOnly && !justEvaluation && streamingWarmUp < 0 &&
+        ensembleName.empty()) {
+        // Everything the printed result depends on, besides the audio
+        std::ostringstream settings;
+        settings.precision(std::numeric_limits<double>::max_digits10);
+        settings << "viterbi " << viterbiMode
+            << " beam " << beamWidth
+            << " weighted " << weightedObservations
+            << " posteriors " << justPosteriors
+            << " probabilities " << justProbabilities;
+        modelId = FeatureCache::hash(keyModel->getTables(),
+            sizeof(double) * CompiledKeyModel::getNumberOfTableValues(
+                keyModel->getNumberOfStates(),
+                keyModel->getNumberOfSymbols())) + "-" +
+            FeatureCache::hash(settings.str().data(), settings.str().size());
+        resultKey = featureCache->getKey(
+            filename, Chromagram::getExtractionSignature(nnlsSolver));
+        std::string result;
+        if (!resultKey.empty() &&
+            featureCache->findResult(resultKey, modelId, &result)) {
+            std::cout << result;
+            printCacheStatistics(featureCache.get());
+            return 0;
+        }
+    }
     // Receiving MIDI input
     PitchClass::PitchClassSequence pitchClassSequence;
-    if (inputType == justkeydding::INPUT_MIDI) {
+    HiddenMarkovModel::WeightedObservations chromagramSequence;
+    Key::KeySequence keySequence;
+    int firstKey = -1;
+    GlobalKeyEstimator::KeyHistogram keyHistogram(Key::NUMBER_OF_KEYS, 0);
+    if (streamingWarmUp >= 0) {
+        // Receiving audio decoded while it is read
+        if ((status = decodeAudioStream(filename, streamingWarmUp,
+                numberOfThreads, nnlsSolver, keyModel,
+                &firstKey, &keyHistogram)) !=
+            Status::STREAMINGVITERBIDECODER_READY) {
+            std::cerr << "There was an error while"
+                        " reading the input file." << std::endl;
+            return status;
+        }
+    } else if (inputType == justkeydding::INPUT_MIDI) {
         Midi midi = Midi(filename);
         if  ((status = midi.getStatus()) != Status::MIDI_READY) {
             std::cerr << "There was an error while"
@@ -170,83 +566,144 @@ int main(int argc, char *argv[]) {
             fileType = Chromagram::FILETYPE_CSV;
         } else if (inputType == justkeydding::INPUT_WAV) {
             fileType = Chromagram::FILETYPE_AUDIO;
+        } else if (inputType == justkeydding::INPUT_CHROMA) {
+            fileType = Chromagram::FILETYPE_CACHE;
         }
         // Get the chromagrams
-        Chromagram chr = Chromagram(filename, fileType);
+        Chromagram chr = Chromagram(filename, fileType,
+            featureCache.get(), numberOfThreads, nnlsSolver);
         if ((status = chr.getStatus()) != Status::CHROMAGRAM_DISCRETE_READY) {
             std::cerr << "There was an error while"
                         " reading the input file." << std::endl;
             return status;
         }
+        printNNLSStatistics(chr.getNNLSStatistics(), nnlsSolver);
         if (chromaOnly) {
+            if (!chromaCacheFilename.empty()) {
+                if (!chr.writeChromagramCache(chromaCacheFilename)) {
+                    std::cerr << "There was an error while"
+                                " writing the chromagram cache." << std::endl;
+                    return Status::CHROMAGRAMCACHE_INPUTFILE_ERROR;
+                }
+                printCacheStatistics(featureCache.get());
+                return 0;
+            }
             bool startOnANatural = true;
             chr.printOriginalChromagram(startOnANatural);
+            printCacheStatistics(featureCache.get());
             return 0;
         }
-        // Turn into a PitchcClassSequence
-        pitchClassSequence = chr.getPitchClassSequence();
+        if (weightedObservations) {
+            // One weighted observation per chroma frame
+            chromagramSequence = chr.getChromagramSequence();
+        } else {
+            // Turn into a PitchcClassSequence
+            pitchClassSequence = chr.getPitchClassSequence();
+        }
     }
-    // States section
-    Key::KeyVector keyVector =
-        Key::getAllKeysVector();
-    // Initial probabilities
-    KeyTransition::KeyTransitionArray symmetrical =
-        KeyTransition("symmetrical").getKeyTransitionArray();
-    std::map<Key, double> initialProbabilities;
-    for (Key::KeyVector::iterator it = keyVector.begin();
-        it != keyVector.end(); it++) {
-        initialProbabilities[*it] = symmetrical[it->getInt()];
+    std::ostringstream output;
+    if (justPosteriors) {
+        // Time-averaged key posteriors of the first model
+        ForwardBackward forwardBackward(pitchClassSequence, keyModel);
+        forwardBackward.run();
+        if ((status = forwardBackward.getStatus()) !=
+            Status::FORWARDBACKWARD_READY) {
+            std::cerr << "There was an error while"
+                        " running the model." << std::endl;
+            return status;
+        }
+        ForwardBackward::ProbabilityVector averagePosterior =
+            forwardBackward.getAveragePosterior();
+        for (ForwardBackward::ProbabilityVector::const_iterator itKeyProb =
+        averagePosterior.begin(); itKeyProb != averagePosterior.end();
+        itKeyProb++) {
+            output << *itKeyProb << " ";
+        }
+        output << std::endl;
+        return printResult(
+            output.str(), featureCache.get(), resultKey, modelId);
     }
-    // Transition probabilities
-    KeyTransition::KeyTransitionMap transitionProbabilities =
-        KeyTransition(
-            keyTransition,
-            customKeyTransition).getKeyTransitionMap();
-    // Emission probabilities
-    KeyProfile::KeyProfileMap emissionProbabilities =
-        KeyProfile(
-            majorKeyProfile,
-            minorKeyProfile,
-            majorCustomKeyProfile,
-            minorCustomKeyProfile).getKeyProfileMap();
-    Key::KeySequence keySequence;
-    double maximumProbability;
-    HiddenMarkovModel hmm(
-        pitchClassSequence,
-        keyVector,
-        initialProbabilities,
-        transitionProbabilities,
-        emissionProbabilities);
-    hmm.runViterbi();
-    if ((status = hmm.getStatus()) !=
-        Status::HIDDENMARKOVMODEL_VITERBI_READY) {
-        std::cerr << "There was an error while"
-                    " running the model." << std::endl;
-        return status;
+    if (localScores) {
+        // The last layer of every model of the ensemble, one line each,
+        // decoded together without back-pointers
+        std::vector<HiddenMarkovModel::ProbabilityVector> scores =
+            HiddenMarkovModel::runBatchedViterbi(
+                pitchClassSequence, ensemble->getModels());
+        for (std::size_t i = 0; i < scores.size(); i++) {
+            if (scores[i].empty()) {
+                std::cerr << "There was an error while"
+                            " running the model." << std::endl;
+                return Status::HIDDENMARKOVMODEL_UNINITIALIZED;
+            }
+            for (std::size_t key = 0; key < scores[i].size(); key++) {
+                output << scores[i][key] << " ";
+            }
+            output << std::endl;
+        }
+        return printResult(output.str(), featureCache.get(), "", "");
+    }
+    if (ensemble) {
+        // The global key probabilities of every model of the ensemble,
+        // one line each, from the same observations
+        ensemble->setViterbiMode(viterbiMode);
+        ensemble->setNumberOfThreads(numberOfThreads);
+        ensemble->setBeamWidth(beamWidth);
+        if (chromagramSequence.empty()) {
+            ensemble->estimate(pitchClassSequence);
+        } else {
+            ensemble->estimate(chromagramSequence);
+        }
+        if ((status = ensemble->getStatus()) != Status::ENSEMBLE_READY) {
+            std::cerr << "There was an error while"
+                        " running the model." << std::endl;
+            return status;
+        }
+        std::vector<Ensemble::ProbabilityVector> probabilityVectors =
+            ensemble->getProbabilityVectors();
+        for (std::size_t i = 0; i < probabilityVectors.size(); i++) {
+            for (std::size_t key = 0; key < probabilityVectors[i].size();
+                key++) {
+                output << probabilityVectors[i][key] << " ";
+            }
+            output << std::endl;
+        }
+        return printResult(output.str(), featureCache.get(), "", "");
+    }
+    if (streamingWarmUp < 0) {
+        if ((status = decodeLocalKeys(pitchClassSequence, chromagramSequence,
+                keyModel, viterbiMode, numberOfThreads, beamWidth,
+                &keySequence)) != Status::HIDDENMARKOVMODEL_VITERBI_READY) {
+            std::cerr << "There was an error while"
+                        " running the model." << std::endl;
+            return status;
+        }
     }
-    keySequence = hmm.getKeySequence();
     /////////////////////////////
     // Second Hidden Markov Model
     /////////////////////////////
-    KeyTransition::KeyTransitionMap zeroTransiionProbabilities =
-        KeyTransition("zero").getKeyTransitionMap();
-    HiddenMarkovModel hmm2(
-        keySequence,
-        keyVector,
-        initialProbabilities,
-        zeroTransiionProbabilities,
-        transitionProbabilities);
-    hmm2.runViterbi();
-    keySequence = hmm2.getKeySequence();
-    HiddenMarkovModel::ProbabilityVector probabilityVector = hmm2.getProbabilityVector();
-    Key mainKey = keySequence.front();
+    GlobalKeyEstimator globalKeyEstimator(
+        GlobalKeyEstimator::compileModel(transitions));
+    if (streamingWarmUp < 0) {
+        globalKeyEstimator.estimate(keySequence);
+    } else if (firstKey != -1) {
+        globalKeyEstimator.estimate(firstKey, keyHistogram);
+    }
+    if ((status = globalKeyEstimator.getStatus()) !=
+        Status::GLOBALKEYESTIMATOR_READY) {
+        std::cerr << "There was an error while"
+                    " running the model." << std::endl;
+        return status;
+    }
+    GlobalKeyEstimator::ProbabilityVector probabilityVector =
+        globalKeyEstimator.getProbabilityVector();
+    Key mainKey = globalKeyEstimator.getGlobalKey();
     if (justProbabilities) {
-        for (HiddenMarkovModel::ProbabilityVector::const_iterator itKeyProb =
+        for (GlobalKeyEstimator::ProbabilityVector::const_iterator itKeyProb =
         probabilityVector.begin(); itKeyProb != probabilityVector.end();
         itKeyProb++) {
-            std::cout << *itKeyProb << " ";
+            output << *itKeyProb << " ";
         }
-        std::cout << std::endl;
+        output << std::endl;
     }
     else if (justEvaluation) {
         std::size_t underscore = filename.find_last_of("_");
@@ -266,7 +723,7 @@ int main(int argc, char *argv[]) {
             } else if (mainKey == groundTruth.getParallelKey()) {
                 score = 0.2;
             }
-            std::cout << score << std::endl;
+            output << score << std::endl;
         }
     }
     else {
@@ -276,12 +733,12 @@ int main(int argc, char *argv[]) {
             std::next(mainKeyStr.begin()),
             mainKeyStr.begin(),
             ::toupper);
-        std::cout
+        output
             << mainKeyStr << '\t'
             << (mainKey.isMajorKey() ? "major" : "minor")
             << std::endl;
     }
-    return 0;
+    return printResult(output.str(), featureCache.get(), resultKey, modelId);
 }
 
 void initOptionParser(optparse::OptionParserExcept *parser) {
@@ -298,12 +755,12 @@ void initOptionParser(optparse::OptionParserExcept *parser) {
             "Audio Key Detection program based on NNLS-Chroma"
             " features and a Hidden Markov Model");
 
-    std::array<std::string, 3> formatOptions =
-        {"wav", "csv", "midi"};
+    std::array<std::string, 4> formatOptions =
+        {"wav", "csv", "midi", "chroma"};
     (*parser).add_option("-f", "--inputformat")
         .choices(formatOptions.begin(), formatOptions.end())
-        .help("Type of input")
-        .metavar("wav|csv|midi");
+        .help("Type of input, chroma is the binary chromagram cache")
+        .metavar("wav|csv|midi|chroma");
 
     std::array<std::string, 5> majorKeyProfiles =
         {"krumhansl_kessler", "aarden_essen",
@@ -336,13 +793,108 @@ void initOptionParser(optparse::OptionParserExcept *parser) {
         .help("Provide your own key transitions")
         .metavar("Array[24]");
 
+    (*parser).add_option("-B", "--bundle")
+        .help("Model bundle file, replaces the key profiles and"
+            " transitions by a precompiled model")
+        .metavar("FILE");
+
+    (*parser).add_option("-n", "--model")
+        .help("Name of the model of the bundle")
+        .metavar("NAME");
+
+    (*parser).add_option("-E", "--ensemble")
+        .help("Name of an ensemble of the bundle: prints the global key"
+            " probabilities (as -p) of each of its models, one line"
+            " each, all from the same chromagram")
+        .metavar("NAME");
+
+    (*parser).add_option("-L", "--localscores")
+        .action("store_true")
+        .help("With -E, print the final log probabilities of the local"
+            " keys of each model instead, all models decoded in a single"
+            " pass without back-pointers");
+
+    (*parser).add_option("-d", "--cache")
+        .help("Cache directory of the chromagrams and results of audio"
+            " files, shared by every run that uses it")
+        .metavar("DIR");
+
+    (*parser).add_option("-s", "--cachesize")
+        .type("double")
+        .help("Size bound of the cache directory in MB, the least"
+            " recently used entries are removed beyond it (1000"
+            " by default)")
+        .metavar("MB");
+
     (*parser).add_option("-e", "--evaluate")
         .action("store_true");
 
     (*parser).add_option("-p", "--probabilities")
         .action("store_true");
+
+    (*parser).add_option("-P", "--posteriors")
+        .action("store_true")
+        .help("Print the key posteriors averaged over every frame");
     
     (*parser).add_option("-c", "--chromaonly")
         .action("store_true");
+
+    (*parser).add_option("-C", "--chromacache")
+        .help("With --chromaonly, write the chromagram to this binary"
+            " cache instead of printing it as CSV")
+        .metavar("FILE");
+
+    std::array<std::string, 5> viterbiModes =
+        {"full", "checkpoint", "runlength", "parallel", "beam"};
+    (*parser).add_option("-V", "--viterbi")
+        .choices(viterbiModes.begin(), viterbiModes.end())
+        .set_default("full")
+        .help("Viterbi decoder, checkpoint keeps sqrt(T) layers in"
+            " memory, runlength applies repeated observations as"
+            " matrix powers, parallel splits the observations into"
+            " chunks decoded concurrently, beam only visits the states"
+            " close to the best one");
+
+    std::array<std::string, 2> observationTypes =
+        {"expanded", "weighted"};
+    (*parser).add_option("-O", "--observations")
+        .choices(observationTypes.begin(), observationTypes.end())
+        .set_default("expanded")
+        .help("Observations of the audio input, expanded repeats every"
+            " pitch class as many times as its discretized magnitude (the"
+            " behaviour of the published results and of the pre-trained"
+            " ensemble), weighted uses one chroma vector per frame and"
+            " needs an audio input, the full Viterbi decoder and neither"
+            " -P nor -S");
+
+    (*parser).add_option("-S", "--streaming")
+        .type("double")
+        .help("Decode a wav input while it is read, in constant memory:"
+            " the tuning is estimated on its first SECONDS, and every"
+            " chroma frame goes to an incremental decoder as expanded"
+            " observations")
+        .metavar("SECONDS");
+
+    (*parser).add_option("-j", "--threads")
+        .type("int")
+        .help("Threads of the parallel decoder and of the chroma"
+            " extraction, all the cores by default")
+        .metavar("N");
+
+    std::array<std::string, 3> nnlsSolvers =
+        {"lawsonhanson", "warmstart", "gram"};
+    (*parser).add_option("-N", "--nnls")
+        .choices(nnlsSolvers.begin(), nnlsSolvers.end())
+        .set_default("lawsonhanson")
+        .help("NNLS solver of the chroma extraction, warmstart begins"
+            " every frame with the notes of the previous one, gram"
+            " solves the normal equations with the Gram matrix of the"
+            " dictionary; both agree with lawsonhanson to rounding");
+
+    (*parser).add_option("-b", "--beam")
+        .type("double")
+        .help("Beam of the beam decoder in log10 units, states further"
+            " below the best one are dropped (exact by default)")
+        .metavar("WIDTH");
 }
 
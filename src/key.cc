@@ -26,21 +26,30 @@ SOFTWARE.
 
 #include "./key.h"
 
+#include<cctype>
+#include<type_traits>
+
+#include "./pitchclass.h"
+
 namespace justkeydding {
 
-Key::Key(std::string keyString) {
-    initStringToIntMap();
-    if (m_stringToIntMap.find(keyString) != m_stringToIntMap.end()) {
-        m_key = m_stringToIntMap.at(keyString);
-        m_keyString = keyString;
+static_assert(sizeof(Key) == 1, "Key must fit in one byte");
+static_assert(std::is_trivially_copyable<Key>::value,
+    "Key must be trivially copyable");
+
+constexpr const char *Key::KEY_NAMES[];
+
+Key::Key(std::string keyString) : m_key(NUMBER_OF_KEYS) {
+    int pitchClass = PitchClass::parse(keyString);
+    if (pitchClass != -1) {
+        bool isMinor = std::islower(static_cast<unsigned char>(keyString[0]));
+        m_key = pitchClass + (isMinor ? FIRST_MINOR_KEY : FIRST_MAJOR_KEY);
     }
 }
 
-Key::Key(int key) {
-    initStringToIntMap();
+Key::Key(int key) : m_key(NUMBER_OF_KEYS) {
     if (static_cast<unsigned int>(key) < NUMBER_OF_KEYS) {
         m_key = key;
-        m_keyString = m_allKeyStrings[m_key];
     }
 }
 
@@ -52,57 +61,15 @@ Key::KeyVector Key::getAllKeysVector() {
     return keyVector;
 }
 
-void Key::initStringToIntMap() {
-    m_stringToIntMap["B#"] = KEY_B_SHARP_MAJOR;
-    m_stringToIntMap["C"] = KEY_C_NATURAL_MAJOR;
-    m_stringToIntMap["C#"] = KEY_C_SHARP_MAJOR;
-    m_stringToIntMap["Db"] = KEY_D_FLAT_MAJOR;
-    m_stringToIntMap["D"] = KEY_D_NATURAL_MAJOR;
-    m_stringToIntMap["D#"] = KEY_D_SHARP_MAJOR;
-    m_stringToIntMap["Eb"] = KEY_E_FLAT_MAJOR;
-    m_stringToIntMap["E"] = KEY_E_NATURAL_MAJOR;
-    m_stringToIntMap["Fb"] = KEY_F_FLAT_MAJOR;
-    m_stringToIntMap["E#"] = KEY_E_SHARP_MAJOR;
-    m_stringToIntMap["F"] = KEY_F_NATURAL_MAJOR;
-    m_stringToIntMap["F#"] = KEY_F_SHARP_MAJOR;
-    m_stringToIntMap["Gb"] = KEY_G_FLAT_MAJOR;
-    m_stringToIntMap["G"] = KEY_G_NATURAL_MAJOR;
-    m_stringToIntMap["G#"] = KEY_G_SHARP_MAJOR;
-    m_stringToIntMap["Ab"] = KEY_A_FLAT_MAJOR;
-    m_stringToIntMap["A"] = KEY_A_NATURAL_MAJOR;
-    m_stringToIntMap["A#"] = KEY_A_SHARP_MAJOR;
-    m_stringToIntMap["Bb"] = KEY_B_FLAT_MAJOR;
-    m_stringToIntMap["B"] = KEY_B_NATURAL_MAJOR;
-    m_stringToIntMap["Cb"] = KEY_C_FLAT_MAJOR;
-    m_stringToIntMap["b#"] = KEY_B_SHARP_MINOR;
-    m_stringToIntMap["c"] = KEY_C_NATURAL_MINOR;
-    m_stringToIntMap["c#"] = KEY_C_SHARP_MINOR;
-    m_stringToIntMap["db"] = KEY_D_FLAT_MINOR;
-    m_stringToIntMap["d"] = KEY_D_NATURAL_MINOR;
-    m_stringToIntMap["d#"] = KEY_D_SHARP_MINOR;
-    m_stringToIntMap["eb"] = KEY_E_FLAT_MINOR;
-    m_stringToIntMap["e"] = KEY_E_NATURAL_MINOR;
-    m_stringToIntMap["fb"] = KEY_F_FLAT_MINOR;
-    m_stringToIntMap["e#"] = KEY_E_SHARP_MINOR;
-    m_stringToIntMap["f"] = KEY_F_NATURAL_MINOR;
-    m_stringToIntMap["f#"] = KEY_F_SHARP_MINOR;
-    m_stringToIntMap["gb"] = KEY_G_FLAT_MINOR;
-    m_stringToIntMap["g"] = KEY_G_NATURAL_MINOR;
-    m_stringToIntMap["g#"] = KEY_G_SHARP_MINOR;
-    m_stringToIntMap["ab"] = KEY_A_FLAT_MINOR;
-    m_stringToIntMap["a"] = KEY_A_NATURAL_MINOR;
-    m_stringToIntMap["a#"] = KEY_A_SHARP_MINOR;
-    m_stringToIntMap["bb"] = KEY_B_FLAT_MINOR;
-    m_stringToIntMap["b"] = KEY_B_NATURAL_MINOR;
-    m_stringToIntMap["cb"] = KEY_C_FLAT_MINOR;
-}
-
 int Key::getInt() const {
     return m_key;
 }
 
 std::string Key::getString() const {
-    return m_keyString;
+    if (m_key >= NUMBER_OF_KEYS) {
+        return std::string();
+    }
+    return KEY_NAMES[m_key];
 }
 
 bool Key::isMajorKey() const {
@@ -127,12 +94,6 @@ bool Key::operator<(const Key &key) const {
     return m_key < key.getInt();
 }
 
-Key& Key::operator=(const Key &key) {
-    m_key = key.getInt();
-    m_keyString = key.getString();
-    return *this;
-}
-
 Key Key::getRelativeKey() const {
     int relative;
     if (this->isMajorKey()) {
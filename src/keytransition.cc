@@ -28,41 +28,25 @@ SOFTWARE.
 
 namespace justkeydding {
 
-KeyTransition::KeyTransition() :
-    KeyTransition("exponential10") {}
-
-KeyTransition::KeyTransition(std::string keyTransition) :
-    KeyTransition(
-        keyTransition,
-        {0,0,0,0,0,0,0,0,0,0,0,0,
-        0,0,0,0,0,0,0,0,0,0,0,0}) {}
-
+struct NamedKeyTransition {
+    const char *name;
+    KeyTransition::KeyTransitionArray keyTransition;
+};
 
-KeyTransition::KeyTransition(std::string keyTransition,
-        KeyTransitionArray customKeyTransition) {
-    initKeyTransitionArrays();
-    if (keyTransition == "custom") {
-        m_keyTransitions[keyTransition] = customKeyTransition;
-    }
-    if (isValidKeyTransition(keyTransition)) {
-        m_keyTransition = keyTransition;
-    }
-}
-
-void KeyTransition::initKeyTransitionArrays() {
-    m_keyTransitions["linear"] = {
+static const NamedKeyTransition KEY_TRANSITIONS[] = {
+    {"linear", {{
         9.0/132, 4.0/132, 6.0/132, 6.0/132, 5.0/132, 8.0/132,
         1.0/132, 8.0/132, 5.0/132, 6.0/132, 6.0/132, 4.0/132,
         8.0/132, 2.0/132, 7.0/132, 3.0/132, 7.0/132, 7.0/132,
-        3.0/132, 7.0/132, 2.0/132, 8.0/132, 5.0/132, 5.0/132,
-    };
-    m_keyTransitions["exponential2"] = {
+        3.0/132, 7.0/132, 2.0/132, 8.0/132, 5.0/132, 5.0/132
+    }}},
+    {"exponential2", {{
         256.0/1245, 8.0/1245, 32.0/1245, 32.0/1245, 16.0/1245, 128.0/1245,
         1.0/1245, 128.0/1245, 16.0/1245, 32.0/1245, 32.0/1245, 8.0/1245,
         128.0/1245, 2.0/1245, 64.0/1245, 4.0/1245, 64.0/1245, 64.0/1245,
-        4.0/1245, 64.0/1245, 2.0/1245, 128.0/1245, 16.0/1245, 16.0/1245,
-    };
-    m_keyTransitions["exponential10"] = {
+        4.0/1245, 64.0/1245, 2.0/1245, 128.0/1245, 16.0/1245, 16.0/1245
+    }}},
+    {"exponential10", {{
         100000000.0/144442221, 1000.0/144442221, 100000.0/144442221,
         100000.0/144442221, 10000.0/144442221, 10000000.0/144442221,
         1.0/144442221, 10000000.0/144442221, 10000.0/144442221,
@@ -70,26 +54,88 @@ void KeyTransition::initKeyTransitionArrays() {
         10000000.0/144442221, 10.0/144442221, 1000000.0/144442221,
         100.0/144442221, 1000000.0/144442221, 1000000.0/144442221,
         100.0/144442221, 1000000.0/144442221, 10.0/144442221,
-        10000000.0/144442221, 10000.0/144442221, 10000.0/144442221,
-    };
-    m_keyTransitions["zero"] = {
+        10000000.0/144442221, 10000.0/144442221, 10000.0/144442221
+    }}},
+    {"zero", {{
         1.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0,
-        0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0,
-    };
-    m_keyTransitions["symmetrical"] = {
-        1.0/24.0, 1.0/24.0, 1.0/24.0, 1.0/24.0, 1.0/24.0, 1.0/24.0,
+        0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0
+    }}},
+    {"symmetrical", {{
         1.0/24.0, 1.0/24.0, 1.0/24.0, 1.0/24.0, 1.0/24.0, 1.0/24.0,
         1.0/24.0, 1.0/24.0, 1.0/24.0, 1.0/24.0, 1.0/24.0, 1.0/24.0,
         1.0/24.0, 1.0/24.0, 1.0/24.0, 1.0/24.0, 1.0/24.0, 1.0/24.0,
-    };
-    m_keyTransitions["heatmap"] = {
+        1.0/24.0, 1.0/24.0, 1.0/24.0, 1.0/24.0, 1.0/24.0, 1.0/24.0
+    }}},
+    {"heatmap", {{
         1.0, 6.0, 4.0, 4.0, 5.0, 2.0, 9.0, 2.0, 5.0, 4.0, 4.0, 6.0,
-        2.0, 8.0, 3.0, 7.0, 3.0, 3.0, 7.0, 3.0, 8.0, 2.0, 5.0, 5.0,
-    };
+        2.0, 8.0, 3.0, 7.0, 3.0, 3.0, 7.0, 3.0, 8.0, 2.0, 5.0, 5.0
+    }}}
+};
+
+// Built-in transitions with this name, or NULL
+static const KeyTransition::KeyTransitionArray *findKeyTransition(
+    const std::string &name) {
+    for (std::size_t i = 0;
+        i < sizeof(KEY_TRANSITIONS) / sizeof(KEY_TRANSITIONS[0]); i++) {
+        if (name == KEY_TRANSITIONS[i].name) {
+            return &KEY_TRANSITIONS[i].keyTransition;
+        }
+    }
+    return NULL;
+}
+
+KeyTransition::KeyTransition() :
+    KeyTransition("exponential10") {}
+
+KeyTransition::KeyTransition(std::string keyTransition) :
+    KeyTransition(
+        keyTransition,
+        {0,0,0,0,0,0,0,0,0,0,0,0,
+        0,0,0,0,0,0,0,0,0,0,0,0}) {}
+
+
+KeyTransition::KeyTransition(std::string keyTransition,
+        KeyTransitionArray customKeyTransition) :
+    m_hasCustomKeyTransition(keyTransition == "custom") {
+    m_keyTransitionArray.fill(0.0);
+    if (isValidKeyTransition(keyTransition)) {
+        m_keyTransition = keyTransition;
+        m_keyTransitionArray = m_hasCustomKeyTransition ?
+            customKeyTransition : *findKeyTransition(keyTransition);
+    }
+    initKeyTransitionMatrix();
+}
+
+void KeyTransition::initKeyTransitionMatrix() {
+    const int n = PitchClass::NUMBER_OF_PITCHCLASSES;
+    for (int fromKey = 0; fromKey < Key::NUMBER_OF_KEYS; fromKey++) {
+        int tonic = fromKey % n;
+        double *row = &m_keyTransitionMatrix[fromKey * Key::NUMBER_OF_KEYS];
+        for (int pc = 0; pc < n; pc++) {
+            // Interval from the tonic of the origin to the destination
+            int interval = (pc + n - tonic) % n;
+            if (Key(fromKey).isMajorKey()) {
+                row[Key::FIRST_MAJOR_KEY + pc] =
+                    m_keyTransitionArray[Key::FIRST_MAJOR_KEY + interval];
+                row[Key::FIRST_MINOR_KEY + pc] =
+                    m_keyTransitionArray[Key::FIRST_MINOR_KEY + interval];
+            } else {
+                // Seen from the relative major, a minor third above
+                row[Key::FIRST_MAJOR_KEY + pc] = m_keyTransitionArray[
+                    Key::FIRST_MINOR_KEY +
+                    (interval + PitchClass::PITCHCLASS_A_NATURAL) % n];
+                row[Key::FIRST_MINOR_KEY + pc] =
+                    m_keyTransitionArray[Key::FIRST_MAJOR_KEY + interval];
+            }
+        }
+    }
 }
 
 bool KeyTransition::isValidKeyTransition(std::string keyTransition) {
-    return m_keyTransitions.find(keyTransition) != m_keyTransitions.end();
+    if (keyTransition == "custom") {
+        return m_hasCustomKeyTransition;
+    }
+    return findKeyTransition(keyTransition) != NULL;
 }
 
 std::string KeyTransition::whichKeyTransition() {
@@ -97,70 +143,22 @@ std::string KeyTransition::whichKeyTransition() {
 }
 
 KeyTransition::KeyTransitionArray KeyTransition::getKeyTransitionArray() {
-    return m_keyTransitions[m_keyTransition];
+    return m_keyTransitionArray;
+}
+
+const KeyTransition::KeyTransitionMatrix &
+KeyTransition::getKeyTransitionMatrix() const {
+    return m_keyTransitionMatrix;
 }
 
 KeyTransition::KeyTransitionMap KeyTransition::getKeyTransitionMap() {
-    KeyTransition::KeyTransitionArray ktArray = getKeyTransitionArray();
-    Key::KeyVector keyVector = Key::getAllKeysVector();
     KeyTransitionMap keyTransitionMap;
-    KeyTransition::KeyTransitionArray rotated;
-    for (Key::KeyVector::const_iterator itFromKey = keyVector.begin();
-            itFromKey != keyVector.end(); itFromKey++) {
-        int fromKey = itFromKey->getInt() % PitchClass::NUMBER_OF_PITCHCLASSES;
-        int keyRotation = PitchClass::NUMBER_OF_PITCHCLASSES - fromKey;
-        std::array<double, PitchClass::NUMBER_OF_PITCHCLASSES> tonic;
-        std::array<double, PitchClass::NUMBER_OF_PITCHCLASSES> relative;
-        if (itFromKey->isMajorKey()) {
-            std::copy(
-                ktArray.begin() + Key::FIRST_MAJOR_KEY,
-                ktArray.begin() + Key::LAST_MAJOR_KEY + 1,
-                tonic.begin());
-            std::copy(
-                ktArray.begin() + Key::FIRST_MINOR_KEY,
-                ktArray.begin() + Key::LAST_MINOR_KEY + 1,
-                relative.begin());
-        } else if (itFromKey->isMinorKey()) {
-            std::rotate_copy(
-                ktArray.begin() + Key::FIRST_MINOR_KEY,
-                ktArray.begin()
-                    + Key::FIRST_MINOR_KEY
-                    + PitchClass::PITCHCLASS_A_NATURAL,
-                ktArray.begin() + Key::LAST_MINOR_KEY + 1,
-                tonic.begin());
-            std::copy(
-                ktArray.begin() + Key::FIRST_MAJOR_KEY,
-                ktArray.begin() + Key::LAST_MAJOR_KEY + 1,
-                relative.begin());
-        }
-        std::rotate(
-            tonic.begin(),
-            tonic.begin() + keyRotation,
-            tonic.end());
-        std::rotate(
-            relative.begin(),
-            relative.begin() + keyRotation,
-            relative.end());
-        std::copy(
-            tonic.begin(),
-            tonic.end(),
-            rotated.begin() + Key::FIRST_MAJOR_KEY);
-        std::copy(
-            relative.begin(),
-            relative.end(),
-            rotated.begin() + Key::FIRST_MINOR_KEY);
-        for (Key::KeyVector::const_iterator itToKey = keyVector.begin();
-                itToKey != keyVector.end(); itToKey++) {
-            int toKey = itToKey->getInt();
-            keyTransitionMap[*itFromKey][*itToKey] =
-                *(rotated.begin() + toKey);
-            // std::cout
-            //     << itFromKey->getString()
-            //     << " -> " << itToKey->getString()
-            //     << " = " << *(rotated.begin() + toKey)
-            //     << std::endl;
+    for (int fromKey = 0; fromKey < Key::NUMBER_OF_KEYS; fromKey++) {
+        std::map<Key, double> &fromKeyMap = keyTransitionMap[Key(fromKey)];
+        for (int toKey = 0; toKey < Key::NUMBER_OF_KEYS; toKey++) {
+            fromKeyMap[Key(toKey)] =
+                m_keyTransitionMatrix[fromKey * Key::NUMBER_OF_KEYS + toKey];
         }
-        // std::cout << std::endl;
     }
     return keyTransitionMap;
 }
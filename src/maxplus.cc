@@ -0,0 +1,344 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Max-plus matrix-vector kernels for the Viterbi recurrence
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "./maxplus.h"
+
+#include<limits>
+#include<algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define JUSTKEYDDING_X86_KERNELS
+#include<immintrin.h>
+#endif
+
+namespace justkeydding {
+
+namespace {
+
+typedef void (*StepKernel)(
+    const double *, const double *, int, double *, signed char *, double *);
+
+// With MARGINS, second holds the runner-up candidate, which equals the
+// best one when they tie (a candidate equal to the best one is not taken)
+template <bool MARGINS>
+void stepScalar(
+    const double *current,
+    const double *matrix,
+    int numberOfStates,
+    double *next,
+    signed char *backPointers,
+    double *margins,
+    int firstState) {
+    for (int to = firstState; to < numberOfStates; to++) {
+        double best = -std::numeric_limits<double>::infinity();
+        double second = -std::numeric_limits<double>::infinity();
+        int bestState = -1;
+        for (int from = 0; from < numberOfStates; from++) {
+            double trial = current[from] + matrix[from * numberOfStates + to];
+            if (MARGINS) {
+                second = std::max(second, std::min(trial, best));
+            }
+            if (trial > best) {
+                best = trial;
+                bestState = from;
+            }
+        }
+        next[to] = best;
+        if (backPointers) {
+            backPointers[to] = static_cast<signed char>(bestState);
+        }
+        if (MARGINS) {
+            margins[to] = best - second;
+        }
+    }
+}
+
+template <bool MARGINS>
+void stepScalarKernel(
+    const double *current,
+    const double *matrix,
+    int numberOfStates,
+    double *next,
+    signed char *backPointers,
+    double *margins) {
+    stepScalar<MARGINS>(
+        current, matrix, numberOfStates, next, backPointers, margins, 0);
+}
+
+#ifdef JUSTKEYDDING_X86_KERNELS
+
+template <bool MARGINS>
+void stepSse2Kernel(
+    const double *current,
+    const double *matrix,
+    int numberOfStates,
+    double *next,
+    signed char *backPointers,
+    double *margins) {
+    const int vectorStates = numberOfStates - numberOfStates % 2;
+    for (int to = 0; to < vectorStates; to += 2) {
+        __m128d best = _mm_set1_pd(-std::numeric_limits<double>::infinity());
+        __m128d second = best;
+        __m128d bestState = _mm_set1_pd(-1.0);
+        for (int from = 0; from < numberOfStates; from++) {
+            __m128d trial = _mm_add_pd(
+                _mm_set1_pd(current[from]),
+                _mm_loadu_pd(matrix + from * numberOfStates + to));
+            if (MARGINS) {
+                second = _mm_max_pd(second, _mm_min_pd(trial, best));
+            }
+            __m128d greater = _mm_cmpgt_pd(trial, best);
+            best = _mm_or_pd(
+                _mm_and_pd(greater, trial), _mm_andnot_pd(greater, best));
+            bestState = _mm_or_pd(
+                _mm_and_pd(greater, _mm_set1_pd(from)),
+                _mm_andnot_pd(greater, bestState));
+        }
+        _mm_storeu_pd(next + to, best);
+        if (backPointers) {
+            double states[2];
+            _mm_storeu_pd(states, bestState);
+            backPointers[to] = static_cast<signed char>(states[0]);
+            backPointers[to + 1] = static_cast<signed char>(states[1]);
+        }
+        if (MARGINS) {
+            _mm_storeu_pd(margins + to, _mm_sub_pd(best, second));
+        }
+    }
+    stepScalar<MARGINS>(current, matrix, numberOfStates, next, backPointers,
+        margins, vectorStates);
+}
+
+template <bool MARGINS>
+__attribute__((target("avx2")))
+void stepAvx2Kernel(
+    const double *current,
+    const double *matrix,
+    int numberOfStates,
+    double *next,
+    signed char *backPointers,
+    double *margins) {
+    const int vectorStates = numberOfStates - numberOfStates % 4;
+    for (int to = 0; to < vectorStates; to += 4) {
+        __m256d best =
+            _mm256_set1_pd(-std::numeric_limits<double>::infinity());
+        __m256d second = best;
+        __m256d bestState = _mm256_set1_pd(-1.0);
+        for (int from = 0; from < numberOfStates; from++) {
+            __m256d trial = _mm256_add_pd(
+                _mm256_set1_pd(current[from]),
+                _mm256_loadu_pd(matrix + from * numberOfStates + to));
+            if (MARGINS) {
+                second = _mm256_max_pd(second, _mm256_min_pd(trial, best));
+            }
+            __m256d greater = _mm256_cmp_pd(trial, best, _CMP_GT_OQ);
+            best = _mm256_blendv_pd(best, trial, greater);
+            bestState = _mm256_blendv_pd(
+                bestState, _mm256_set1_pd(from), greater);
+        }
+        _mm256_storeu_pd(next + to, best);
+        if (backPointers) {
+            double states[4];
+            _mm256_storeu_pd(states, bestState);
+            for (int lane = 0; lane < 4; lane++) {
+                backPointers[to + lane] =
+                    static_cast<signed char>(states[lane]);
+            }
+        }
+        if (MARGINS) {
+            _mm256_storeu_pd(margins + to, _mm256_sub_pd(best, second));
+        }
+    }
+    stepScalar<MARGINS>(current, matrix, numberOfStates, next, backPointers,
+        margins, vectorStates);
+}
+
+template <bool MARGINS>
+__attribute__((target("avx512f")))
+void stepAvx512Kernel(
+    const double *current,
+    const double *matrix,
+    int numberOfStates,
+    double *next,
+    signed char *backPointers,
+    double *margins) {
+    const int vectorStates = numberOfStates - numberOfStates % 8;
+    for (int to = 0; to < vectorStates; to += 8) {
+        __m512d best =
+            _mm512_set1_pd(-std::numeric_limits<double>::infinity());
+        __m512d second = best;
+        __m512d bestState = _mm512_set1_pd(-1.0);
+        for (int from = 0; from < numberOfStates; from++) {
+            __m512d trial = _mm512_add_pd(
+                _mm512_set1_pd(current[from]),
+                _mm512_loadu_pd(matrix + from * numberOfStates + to));
+            if (MARGINS) {
+                second = _mm512_max_pd(second, _mm512_min_pd(trial, best));
+            }
+            __mmask8 greater = _mm512_cmp_pd_mask(trial, best, _CMP_GT_OQ);
+            best = _mm512_mask_mov_pd(best, greater, trial);
+            bestState = _mm512_mask_mov_pd(
+                bestState, greater, _mm512_set1_pd(from));
+        }
+        _mm512_storeu_pd(next + to, best);
+        if (backPointers) {
+            double states[8];
+            _mm512_storeu_pd(states, bestState);
+            for (int lane = 0; lane < 8; lane++) {
+                backPointers[to + lane] =
+                    static_cast<signed char>(states[lane]);
+            }
+        }
+        if (MARGINS) {
+            _mm512_storeu_pd(margins + to, _mm512_sub_pd(best, second));
+        }
+    }
+    stepScalar<MARGINS>(current, matrix, numberOfStates, next, backPointers,
+        margins, vectorStates);
+}
+
+#endif  // JUSTKEYDDING_X86_KERNELS
+
+const StepKernel stepKernels[MaxPlus::NUMBER_OF_INSTRUCTIONSETS] = {
+    stepScalarKernel<false>,
+#ifdef JUSTKEYDDING_X86_KERNELS
+    stepSse2Kernel<false>,
+    stepAvx2Kernel<false>,
+    stepAvx512Kernel<false>
+#else
+    stepScalarKernel<false>,
+    stepScalarKernel<false>,
+    stepScalarKernel<false>
+#endif
+};
+
+const StepKernel marginKernels[MaxPlus::NUMBER_OF_INSTRUCTIONSETS] = {
+    stepScalarKernel<true>,
+#ifdef JUSTKEYDDING_X86_KERNELS
+    stepSse2Kernel<true>,
+    stepAvx2Kernel<true>,
+    stepAvx512Kernel<true>
+#else
+    stepScalarKernel<true>,
+    stepScalarKernel<true>,
+    stepScalarKernel<true>
+#endif
+};
+
+int detectInstructionSet() {
+    for (int instructionSet = MaxPlus::NUMBER_OF_INSTRUCTIONSETS - 1;
+        instructionSet > MaxPlus::INSTRUCTIONSET_SCALAR; instructionSet--) {
+        if (MaxPlus::isSupported(instructionSet)) {
+            return instructionSet;
+        }
+    }
+    return MaxPlus::INSTRUCTIONSET_SCALAR;
+}
+
+int currentInstructionSet = detectInstructionSet();
+
+}  // namespace
+
+void MaxPlus::step(
+    const double *current,
+    const double *matrix,
+    int numberOfStates,
+    double *next,
+    signed char *backPointers) {
+    stepKernels[currentInstructionSet](
+        current, matrix, numberOfStates, next, backPointers, NULL);
+}
+
+void MaxPlus::stepWithMargins(
+    const double *current,
+    const double *matrix,
+    int numberOfStates,
+    double *next,
+    signed char *backPointers,
+    double *margins) {
+    marginKernels[currentInstructionSet](
+        current, matrix, numberOfStates, next, backPointers, margins);
+}
+
+void MaxPlus::product(
+    const double *current,
+    const double *matrix,
+    int numberOfStates,
+    double *next) {
+    stepKernels[currentInstructionSet](
+        current, matrix, numberOfStates, next, NULL, NULL);
+}
+
+int MaxPlus::getInstructionSet() {
+    return currentInstructionSet;
+}
+
+bool MaxPlus::setInstructionSet(int instructionSet) {
+    if (!isSupported(instructionSet)) {
+        return false;
+    }
+    currentInstructionSet = instructionSet;
+    return true;
+}
+
+bool MaxPlus::isSupported(int instructionSet) {
+#ifdef JUSTKEYDDING_X86_KERNELS
+    // May run during static initialization, before libgcc has
+    // filled in the CPU model
+    __builtin_cpu_init();
+#endif
+    switch (instructionSet) {
+        case INSTRUCTIONSET_SCALAR:
+            return true;
+#ifdef JUSTKEYDDING_X86_KERNELS
+        case INSTRUCTIONSET_SSE2:
+            return __builtin_cpu_supports("sse2");
+        case INSTRUCTIONSET_AVX2:
+            return __builtin_cpu_supports("avx2");
+        case INSTRUCTIONSET_AVX512:
+            return __builtin_cpu_supports("avx512f");
+#endif
+        default:
+            return false;
+    }
+}
+
+const char *MaxPlus::getInstructionSetName(int instructionSet) {
+    switch (instructionSet) {
+        case INSTRUCTIONSET_SCALAR:
+            return "scalar";
+        case INSTRUCTIONSET_SSE2:
+            return "sse2";
+        case INSTRUCTIONSET_AVX2:
+            return "avx2";
+        case INSTRUCTIONSET_AVX512:
+            return "avx512";
+        default:
+            return "unknown";
+    }
+}
+
+}  // namespace justkeydding
@@ -52,6 +52,7 @@ PitchClass::PitchClassSequence Midi::getPitchClassSequence() {
          pcSequence.push_back(PitchClass(pitch % 12));
       }
    }
+   return pcSequence;
 }
 
 int Midi::getStatus() const {
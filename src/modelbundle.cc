@@ -0,0 +1,473 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Versioned binary bundle of named key models, memory-mapped on load
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "./modelbundle.h"
+
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<fcntl.h>
+#include<unistd.h>
+
+#include<cstdio>
+#include<cstring>
+#include<fstream>
+
+namespace justkeydding {
+
+const std::uint32_t ModelBundle::VERSION;
+const std::size_t ModelBundle::MAXIMUM_NAME_LENGTH;
+
+static const char MAGIC[8] = {'J', 'K', 'D', 'M', 'O', 'D', 'E', 'L'};
+static const std::size_t NAME_SIZE = ModelBundle::MAXIMUM_NAME_LENGTH + 1;
+static const std::size_t SECTION_ALIGNMENT = 64;
+
+struct ModelBundle::Header {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t numberOfStates;
+  std::uint32_t numberOfSymbols;
+  std::uint32_t numberOfProfiles;
+  std::uint32_t numberOfTransitions;
+  std::uint32_t numberOfModels;
+  std::uint32_t numberOfEnsembles;
+  std::uint32_t numberOfMembers;
+  std::uint64_t profilesOffset;
+  std::uint64_t transitionsOffset;
+  std::uint64_t modelsOffset;
+  std::uint64_t ensemblesOffset;
+  std::uint64_t membersOffset;
+  std::uint64_t fileSize;
+};
+
+struct ModelBundle::ProfileRecord {
+  char name[NAME_SIZE];
+  double major[PitchClass::NUMBER_OF_PITCHCLASSES];
+  double minor[PitchClass::NUMBER_OF_PITCHCLASSES];
+};
+
+struct ModelBundle::TransitionRecord {
+  char name[NAME_SIZE];
+  double transition[Key::NUMBER_OF_KEYS];
+};
+
+struct ModelBundle::ModelRecord {
+  char name[NAME_SIZE];
+  std::uint32_t profile;
+  std::uint32_t transition;
+  std::uint64_t tablesOffset;
+};
+
+struct ModelBundle::EnsembleRecord {
+  char name[NAME_SIZE];
+  std::uint32_t firstMember;
+  std::uint32_t numberOfMembers;
+};
+
+// Unmaps the file when the last model borrowing its tables is gone
+struct Unmapper {
+  std::size_t size;
+  void operator()(const void *address) const {
+    munmap(const_cast<void *>(address), size);
+  }
+};
+
+static bool isLittleEndian() {
+  const std::uint16_t one = 1;
+  return *reinterpret_cast<const unsigned char *>(&one) == 1;
+}
+
+static std::size_t align(std::size_t offset) {
+  return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT *
+    SECTION_ALIGNMENT;
+}
+
+static std::size_t getTablesSize() {
+  return sizeof(double) * CompiledKeyModel::getNumberOfTableValues(
+    Key::NUMBER_OF_KEYS, PitchClass::NUMBER_OF_PITCHCLASSES);
+}
+
+// Whether count records of this size starting at offset fit in the file
+static bool fits(
+  std::uint64_t offset,
+  std::uint64_t count,
+  std::size_t recordSize,
+  std::size_t fileSize) {
+  return offset % sizeof(double) == 0 && offset <= fileSize &&
+    count <= (fileSize - offset) / recordSize;
+}
+
+static bool isValidName(const char *name) {
+  return std::memchr(name, '\0', NAME_SIZE) != NULL;
+}
+
+static void copyName(const std::string &name, char *record) {
+  std::strncpy(record, name.c_str(), NAME_SIZE - 1);
+}
+
+template <typename Record>
+static int findName(
+  const Record *records,
+  std::size_t numberOfRecords,
+  const std::string &name) {
+  for (std::size_t i = 0; i < numberOfRecords; i++) {
+    if (name == records[i].name) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+template <typename Entry>
+static int findName(
+  const std::vector<Entry> &entries,
+  const std::string &name) {
+  for (std::size_t i = 0; i < entries.size(); i++) {
+    if (name == entries[i].name) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+ModelBundle::ModelBundle(const std::string &fileName) :
+  m_status(Status::MODELBUNDLE_UNINITIALIZED),
+  m_header(NULL),
+  m_profiles(NULL),
+  m_transitions(NULL),
+  m_models(NULL),
+  m_ensembles(NULL),
+  m_members(NULL) {
+  int fileDescriptor = open(fileName.c_str(), O_RDONLY);
+  if (fileDescriptor == -1) {
+    m_status = Status::MODELBUNDLE_INPUTFILE_ERROR;
+    return;
+  }
+  struct stat fileStatus;
+  if (fstat(fileDescriptor, &fileStatus) != 0) {
+    close(fileDescriptor);
+    m_status = Status::MODELBUNDLE_INPUTFILE_ERROR;
+    return;
+  }
+  const std::size_t fileSize = fileStatus.st_size;
+  if (fileSize < sizeof(Header)) {
+    close(fileDescriptor);
+    m_status = Status::MODELBUNDLE_FORMAT_ERROR;
+    return;
+  }
+  void *address =
+    mmap(NULL, fileSize, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+  close(fileDescriptor);
+  if (address == MAP_FAILED) {
+    m_status = Status::MODELBUNDLE_INPUTFILE_ERROR;
+    return;
+  }
+  Unmapper unmapper = {fileSize};
+  m_mapping = std::shared_ptr<const void>(address, unmapper);
+  if (!validate(fileSize)) {
+    m_mapping.reset();
+    m_status = Status::MODELBUNDLE_FORMAT_ERROR;
+    return;
+  }
+  m_status = Status::MODELBUNDLE_READY;
+}
+
+bool ModelBundle::validate(std::size_t fileSize) {
+  const char *base = static_cast<const char *>(m_mapping.get());
+  const Header *header = reinterpret_cast<const Header *>(base);
+  if (!isLittleEndian() ||
+      std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      header->version != VERSION ||
+      header->numberOfStates != Key::NUMBER_OF_KEYS ||
+      header->numberOfSymbols != PitchClass::NUMBER_OF_PITCHCLASSES ||
+      header->fileSize != fileSize ||
+      !fits(header->profilesOffset, header->numberOfProfiles,
+        sizeof(ProfileRecord), fileSize) ||
+      !fits(header->transitionsOffset, header->numberOfTransitions,
+        sizeof(TransitionRecord), fileSize) ||
+      !fits(header->modelsOffset, header->numberOfModels,
+        sizeof(ModelRecord), fileSize) ||
+      !fits(header->ensemblesOffset, header->numberOfEnsembles,
+        sizeof(EnsembleRecord), fileSize) ||
+      !fits(header->membersOffset, header->numberOfMembers,
+        sizeof(std::uint32_t), fileSize)) {
+    return false;
+  }
+  const ProfileRecord *profiles = reinterpret_cast<const ProfileRecord *>(
+    base + header->profilesOffset);
+  const TransitionRecord *transitions =
+    reinterpret_cast<const TransitionRecord *>(
+      base + header->transitionsOffset);
+  const ModelRecord *models = reinterpret_cast<const ModelRecord *>(
+    base + header->modelsOffset);
+  const EnsembleRecord *ensembles = reinterpret_cast<const EnsembleRecord *>(
+    base + header->ensemblesOffset);
+  const std::uint32_t *members = reinterpret_cast<const std::uint32_t *>(
+    base + header->membersOffset);
+  for (std::uint32_t i = 0; i < header->numberOfProfiles; i++) {
+    if (!isValidName(profiles[i].name)) {
+      return false;
+    }
+  }
+  for (std::uint32_t i = 0; i < header->numberOfTransitions; i++) {
+    if (!isValidName(transitions[i].name)) {
+      return false;
+    }
+  }
+  for (std::uint32_t i = 0; i < header->numberOfModels; i++) {
+    if (!isValidName(models[i].name) ||
+        models[i].profile >= header->numberOfProfiles ||
+        models[i].transition >= header->numberOfTransitions ||
+        !fits(models[i].tablesOffset, 1, getTablesSize(), fileSize)) {
+      return false;
+    }
+  }
+  for (std::uint32_t i = 0; i < header->numberOfEnsembles; i++) {
+    if (!isValidName(ensembles[i].name) ||
+        ensembles[i].firstMember > header->numberOfMembers ||
+        ensembles[i].numberOfMembers >
+        header->numberOfMembers - ensembles[i].firstMember) {
+      return false;
+    }
+  }
+  for (std::uint32_t i = 0; i < header->numberOfMembers; i++) {
+    if (members[i] >= header->numberOfModels) {
+      return false;
+    }
+  }
+  m_header = header;
+  m_profiles = profiles;
+  m_transitions = transitions;
+  m_models = models;
+  m_ensembles = ensembles;
+  m_members = members;
+  return true;
+}
+
+int ModelBundle::getStatus() const {
+  return m_status;
+}
+
+std::vector<std::string> ModelBundle::getModelNames() const {
+  std::vector<std::string> names;
+  if (m_status != Status::MODELBUNDLE_READY) {
+    return names;
+  }
+  for (std::uint32_t i = 0; i < m_header->numberOfModels; i++) {
+    names.push_back(m_models[i].name);
+  }
+  return names;
+}
+
+std::vector<std::string> ModelBundle::getEnsembleNames() const {
+  std::vector<std::string> names;
+  if (m_status != Status::MODELBUNDLE_READY) {
+    return names;
+  }
+  for (std::uint32_t i = 0; i < m_header->numberOfEnsembles; i++) {
+    names.push_back(m_ensembles[i].name);
+  }
+  return names;
+}
+
+int ModelBundle::findModel(const std::string &name) const {
+  if (m_status != Status::MODELBUNDLE_READY) {
+    return -1;
+  }
+  return findName(m_models, m_header->numberOfModels, name);
+}
+
+CompiledKeyModel::ConstPointer ModelBundle::getModel(
+  const std::string &name) const {
+  int model = findModel(name);
+  if (model == -1) {
+    return CompiledKeyModel::ConstPointer();
+  }
+  const double *tables = reinterpret_cast<const double *>(
+    static_cast<const char *>(m_mapping.get()) +
+    m_models[model].tablesOffset);
+  return std::make_shared<CompiledKeyModel>(tables, m_mapping);
+}
+
+bool ModelBundle::getKeyTransitionArray(
+  const std::string &name,
+  KeyTransition::KeyTransitionArray *keyTransitionArray) const {
+  int model = findModel(name);
+  if (model == -1) {
+    return false;
+  }
+  const TransitionRecord &transition =
+    m_transitions[m_models[model].transition];
+  std::copy(
+    transition.transition,
+    transition.transition + Key::NUMBER_OF_KEYS,
+    keyTransitionArray->begin());
+  return true;
+}
+
+std::vector<std::string> ModelBundle::getEnsemble(
+  const std::string &name) const {
+  std::vector<std::string> models;
+  if (m_status != Status::MODELBUNDLE_READY) {
+    return models;
+  }
+  int ensemble = findName(m_ensembles, m_header->numberOfEnsembles, name);
+  if (ensemble == -1) {
+    return models;
+  }
+  const EnsembleRecord &record = m_ensembles[ensemble];
+  for (std::uint32_t i = 0; i < record.numberOfMembers; i++) {
+    models.push_back(m_models[m_members[record.firstMember + i]].name);
+  }
+  return models;
+}
+
+bool ModelBundle::write(
+  const std::string &fileName,
+  const std::vector<Profile> &profiles,
+  const std::vector<Transition> &transitions,
+  const std::vector<Model> &models,
+  const std::vector<Ensemble> &ensembles) {
+  if (!isLittleEndian()) {
+    return false;
+  }
+  // Resolve every name to its record
+  std::vector<std::string> names;
+  std::vector<int> modelProfiles;
+  std::vector<int> modelTransitions;
+  std::vector<std::uint32_t> members;
+  for (std::size_t i = 0; i < profiles.size(); i++) {
+    names.push_back(profiles[i].name);
+  }
+  for (std::size_t i = 0; i < transitions.size(); i++) {
+    names.push_back(transitions[i].name);
+  }
+  for (std::size_t i = 0; i < models.size(); i++) {
+    names.push_back(models[i].name);
+    modelProfiles.push_back(findName(profiles, models[i].profile));
+    modelTransitions.push_back(findName(transitions, models[i].transition));
+    if (modelProfiles.back() == -1 || modelTransitions.back() == -1) {
+      return false;
+    }
+  }
+  for (std::size_t i = 0; i < ensembles.size(); i++) {
+    names.push_back(ensembles[i].name);
+    for (std::size_t j = 0; j < ensembles[i].models.size(); j++) {
+      int model = findName(models, ensembles[i].models[j]);
+      if (model == -1) {
+        return false;
+      }
+      members.push_back(model);
+    }
+  }
+  for (std::size_t i = 0; i < names.size(); i++) {
+    if (names[i].size() > MAXIMUM_NAME_LENGTH) {
+      return false;
+    }
+  }
+  // Sections
+  Header header = Header();
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.numberOfStates = Key::NUMBER_OF_KEYS;
+  header.numberOfSymbols = PitchClass::NUMBER_OF_PITCHCLASSES;
+  header.numberOfProfiles = profiles.size();
+  header.numberOfTransitions = transitions.size();
+  header.numberOfModels = models.size();
+  header.numberOfEnsembles = ensembles.size();
+  header.numberOfMembers = members.size();
+  header.profilesOffset = align(sizeof(Header));
+  header.transitionsOffset = align(
+    header.profilesOffset + profiles.size() * sizeof(ProfileRecord));
+  header.modelsOffset = align(
+    header.transitionsOffset + transitions.size() * sizeof(TransitionRecord));
+  header.ensemblesOffset = align(
+    header.modelsOffset + models.size() * sizeof(ModelRecord));
+  header.membersOffset = align(
+    header.ensemblesOffset + ensembles.size() * sizeof(EnsembleRecord));
+  const std::size_t tablesOffset = align(
+    header.membersOffset + members.size() * sizeof(std::uint32_t));
+  const std::size_t tablesSize = align(getTablesSize());
+  header.fileSize = tablesOffset + models.size() * tablesSize;
+  std::vector<char> buffer(header.fileSize, 0);
+  std::memcpy(&buffer[0], &header, sizeof(Header));
+  for (std::size_t i = 0; i < profiles.size(); i++) {
+    ProfileRecord *record = reinterpret_cast<ProfileRecord *>(
+      &buffer[header.profilesOffset + i * sizeof(ProfileRecord)]);
+    copyName(profiles[i].name, record->name);
+    std::copy(profiles[i].major.begin(), profiles[i].major.end(),
+      record->major);
+    std::copy(profiles[i].minor.begin(), profiles[i].minor.end(),
+      record->minor);
+  }
+  for (std::size_t i = 0; i < transitions.size(); i++) {
+    TransitionRecord *record = reinterpret_cast<TransitionRecord *>(
+      &buffer[header.transitionsOffset + i * sizeof(TransitionRecord)]);
+    copyName(transitions[i].name, record->name);
+    std::copy(transitions[i].transition.begin(),
+      transitions[i].transition.end(), record->transition);
+  }
+  for (std::size_t i = 0; i < models.size(); i++) {
+    ModelRecord *record = reinterpret_cast<ModelRecord *>(
+      &buffer[header.modelsOffset + i * sizeof(ModelRecord)]);
+    copyName(models[i].name, record->name);
+    record->profile = modelProfiles[i];
+    record->transition = modelTransitions[i];
+    record->tablesOffset = tablesOffset + i * tablesSize;
+    // Precompiled tables, the same as those of the detector
+    const Profile &profile = profiles[modelProfiles[i]];
+    const Transition &transition = transitions[modelTransitions[i]];
+    CompiledKeyModel compiled(
+      KeyProfile("custom", "custom", profile.major, profile.minor),
+      KeyTransition("custom", transition.transition));
+    std::memcpy(&buffer[record->tablesOffset], compiled.getTables(),
+      getTablesSize());
+  }
+  std::uint32_t firstMember = 0;
+  for (std::size_t i = 0; i < ensembles.size(); i++) {
+    EnsembleRecord *record = reinterpret_cast<EnsembleRecord *>(
+      &buffer[header.ensemblesOffset + i * sizeof(EnsembleRecord)]);
+    copyName(ensembles[i].name, record->name);
+    record->firstMember = firstMember;
+    record->numberOfMembers = ensembles[i].models.size();
+    firstMember += record->numberOfMembers;
+  }
+  if (!members.empty()) {
+    std::memcpy(&buffer[header.membersOffset], &members[0],
+      members.size() * sizeof(std::uint32_t));
+  }
+  // Written aside and renamed, so that readers never map half a file
+  std::string temporaryFileName = fileName + ".tmp";
+  std::ofstream outfile(temporaryFileName.c_str(), std::ios::binary);
+  outfile.write(&buffer[0], buffer.size());
+  outfile.close();
+  if (!outfile) {
+    std::remove(temporaryFileName.c_str());
+    return false;
+  }
+  return std::rename(temporaryFileName.c_str(), fileName.c_str()) == 0;
+}
+
+}  // namespace justkeydding
@@ -0,0 +1,155 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Writes a model bundle from a text description of its models
+
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include<string>
+#include<vector>
+#include<algorithm>
+#include<fstream>
+#include<sstream>
+#include<iostream>
+
+#include "./key.h"
+#include "./modelbundle.h"
+
+using justkeydding::Key;
+using justkeydding::ModelBundle;
+
+// One entry per line, values separated by spaces, e.g.:
+//
+//   profile sapp 0.2222 0 0.1111 ... (12 major and 12 minor values)
+//   transition ktg_exponential10 0.6 0.02 ... (24 values)
+//   model sapp_ktg_exponential10 sapp ktg_exponential10
+//   ensemble default sapp_ktg_exponential10 ...
+//
+// Empty lines and lines starting with # are skipped.
+static bool readDescription(
+    std::istream *description,
+    std::vector<ModelBundle::Profile> *profiles,
+    std::vector<ModelBundle::Transition> *transitions,
+    std::vector<ModelBundle::Model> *models,
+    std::vector<ModelBundle::Ensemble> *ensembles) {
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(*description, line)) {
+        lineNumber++;
+        std::istringstream fields(line);
+        std::string entry;
+        if (!(fields >> entry) || entry[0] == '#') {
+            continue;
+        }
+        std::string name;
+        fields >> name;
+        std::vector<double> values;
+        std::vector<std::string> names;
+        if (entry == "profile" || entry == "transition") {
+            double value;
+            while (fields >> value) {
+                values.push_back(value);
+            }
+        } else {
+            std::string member;
+            while (fields >> member) {
+                names.push_back(member);
+            }
+        }
+        bool valid = !name.empty() && fields.eof();
+        if (entry == "profile" && valid &&
+            values.size() == Key::NUMBER_OF_KEYS) {
+            ModelBundle::Profile profile;
+            profile.name = name;
+            std::copy(values.begin(), values.begin() + Key::FIRST_MINOR_KEY,
+                profile.major.begin());
+            std::copy(values.begin() + Key::FIRST_MINOR_KEY, values.end(),
+                profile.minor.begin());
+            profiles->push_back(profile);
+        } else if (entry == "transition" && valid &&
+            values.size() == Key::NUMBER_OF_KEYS) {
+            ModelBundle::Transition transition;
+            transition.name = name;
+            std::copy(values.begin(), values.end(),
+                transition.transition.begin());
+            transitions->push_back(transition);
+        } else if (entry == "model" && valid && names.size() == 2) {
+            ModelBundle::Model model;
+            model.name = name;
+            model.profile = names[0];
+            model.transition = names[1];
+            models->push_back(model);
+        } else if (entry == "ensemble" && valid && !names.empty()) {
+            ModelBundle::Ensemble ensemble;
+            ensemble.name = name;
+            ensemble.models = names;
+            ensembles->push_back(ensemble);
+        } else {
+            std::cerr << "Line " << lineNumber << " is not a valid"
+                " profile, transition, model or ensemble." << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Compiles the models of a description (a file, or - for the standard
+// input) into a bundle for the -B option of justkeydding, e.g.:
+//
+//   bin/modelbundler models.txt models.jkd
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        std::cout << "usage: " << argv[0]
+            << " description|- bundlefile" << std::endl;
+        return 1;
+    }
+    std::string descriptionFilename = argv[1];
+    std::ifstream descriptionFile;
+    std::istream *description = &std::cin;
+    if (descriptionFilename != "-") {
+        descriptionFile.open(descriptionFilename.c_str());
+        if (!descriptionFile) {
+            std::cerr << "Could not open " << descriptionFilename
+                << "." << std::endl;
+            return 1;
+        }
+        description = &descriptionFile;
+    }
+    std::vector<ModelBundle::Profile> profiles;
+    std::vector<ModelBundle::Transition> transitions;
+    std::vector<ModelBundle::Model> models;
+    std::vector<ModelBundle::Ensemble> ensembles;
+    if (!readDescription(
+        description, &profiles, &transitions, &models, &ensembles)) {
+        return 1;
+    }
+    if (!ModelBundle::write(
+        argv[2], profiles, transitions, models, ensembles)) {
+        std::cerr << "There was an error while"
+                    " writing the model bundle." << std::endl;
+        return 1;
+    }
+    std::cerr << models.size() << " models and " << ensembles.size()
+        << " ensembles written to " << argv[2] << std::endl;
+    return 0;
+}
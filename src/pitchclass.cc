@@ -26,24 +26,30 @@ SOFTWARE.
 
 #include "./pitchclass.h"
 
+#include<cctype>
+#include<type_traits>
+
 namespace justkeydding {
 
-PitchClass::PitchClass(std::string pitchClass) {
-    initStringToIntMap();
-    std::transform(
-        pitchClass.begin(), pitchClass.end(),
-        pitchClass.begin(), ::tolower);
-    if (m_stringToIntMap.find(pitchClass) != m_stringToIntMap.end()) {
-        m_pitchClass = m_stringToIntMap.at(pitchClass);
-        m_pitchClassString = m_allPitchClassStrings[m_pitchClass];
+static_assert(sizeof(PitchClass) == 1,
+    "PitchClass must fit in one byte");
+static_assert(std::is_trivially_copyable<PitchClass>::value,
+    "PitchClass must be trivially copyable");
+
+constexpr const char *PitchClass::PITCHCLASS_NAMES[];
+
+PitchClass::PitchClass(std::string pitchClass) :
+    m_pitchClass(NUMBER_OF_PITCHCLASSES) {
+    int parsed = parse(pitchClass);
+    if (parsed != -1) {
+        m_pitchClass = parsed;
     }
 }
 
-PitchClass::PitchClass(int pitchClass) {
-    initStringToIntMap();
+PitchClass::PitchClass(int pitchClass) :
+    m_pitchClass(NUMBER_OF_PITCHCLASSES) {
     if (pitchClass >= 0 && pitchClass < NUMBER_OF_PITCHCLASSES) {
         m_pitchClass = pitchClass;
-        m_pitchClassString = m_allPitchClassStrings[m_pitchClass];
     }
 }
 
@@ -56,28 +62,33 @@ PitchClass::PitchClassVector PitchClass::getAllPitchClassesVector() {
     return pitchClassVector;
 }
 
-void PitchClass::initStringToIntMap() {
-    m_stringToIntMap["b#"] = PITCHCLASS_B_SHARP;
-    m_stringToIntMap["c"] = PITCHCLASS_C_NATURAL;
-    m_stringToIntMap["c#"] = PITCHCLASS_C_SHARP;
-    m_stringToIntMap["db"] = PITCHCLASS_D_FLAT;
-    m_stringToIntMap["d"] = PITCHCLASS_D_NATURAL;
-    m_stringToIntMap["d#"] = PITCHCLASS_D_SHARP;
-    m_stringToIntMap["eb"] = PITCHCLASS_E_FLAT;
-    m_stringToIntMap["e"] = PITCHCLASS_E_NATURAL;
-    m_stringToIntMap["fb"] = PITCHCLASS_F_FLAT;
-    m_stringToIntMap["e#"] = PITCHCLASS_E_SHARP;
-    m_stringToIntMap["f"] = PITCHCLASS_F_NATURAL;
-    m_stringToIntMap["f#"] = PITCHCLASS_F_SHARP;
-    m_stringToIntMap["gb"] = PITCHCLASS_G_FLAT;
-    m_stringToIntMap["g"] = PITCHCLASS_G_NATURAL;
-    m_stringToIntMap["g#"] = PITCHCLASS_G_SHARP;
-    m_stringToIntMap["ab"] = PITCHCLASS_A_FLAT;
-    m_stringToIntMap["a"] = PITCHCLASS_A_NATURAL;
-    m_stringToIntMap["a#"] = PITCHCLASS_A_SHARP;
-    m_stringToIntMap["bb"] = PITCHCLASS_B_FLAT;
-    m_stringToIntMap["b"] = PITCHCLASS_B_NATURAL;
-    m_stringToIntMap["cb"] = PITCHCLASS_C_FLAT;
+int PitchClass::parse(const std::string &name) {
+    // Natural pitch classes of the letters a to g
+    static const int letters[] = {
+        PITCHCLASS_A_NATURAL, PITCHCLASS_B_NATURAL, PITCHCLASS_C_NATURAL,
+        PITCHCLASS_D_NATURAL, PITCHCLASS_E_NATURAL, PITCHCLASS_F_NATURAL,
+        PITCHCLASS_G_NATURAL
+    };
+    if (name.empty() || name.size() > 2) {
+        return -1;
+    }
+    int letter = std::tolower(static_cast<unsigned char>(name[0])) - 'a';
+    if (letter < 0 || letter >= 7) {
+        return -1;
+    }
+    int pitchClass = letters[letter];
+    if (name.size() == 2) {
+        char accidental =
+            std::tolower(static_cast<unsigned char>(name[1]));
+        if (accidental == '#') {
+            pitchClass += 1;
+        } else if (accidental == 'b') {
+            pitchClass += NUMBER_OF_PITCHCLASSES - 1;
+        } else {
+            return -1;
+        }
+    }
+    return pitchClass % NUMBER_OF_PITCHCLASSES;
 }
 
 int PitchClass::getInt() const {
@@ -85,7 +96,10 @@ int PitchClass::getInt() const {
 }
 
 std::string PitchClass::getString() const {
-    return m_pitchClassString;
+    if (m_pitchClass >= NUMBER_OF_PITCHCLASSES) {
+        return std::string();
+    }
+    return PITCHCLASS_NAMES[m_pitchClass];
 }
 
 bool PitchClass::operator==(const PitchClass &pitchClass) const {
@@ -0,0 +1,81 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Max-plus powers of the per-symbol step matrices
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "./steppowers.h"
+#include "./maxplus.h"
+
+namespace justkeydding {
+
+StepPowers::StepPowers(CompiledKeyModel::ConstPointer model) :
+  m_model(model),
+  m_numberOfStates(model->getNumberOfStates()),
+  m_powers(model->getNumberOfSymbols()),
+  m_midStates(model->getNumberOfSymbols()) {
+}
+
+const double *StepPowers::getPower(int symbol, int power) {
+  if (power == 0) {
+    return m_model->getLogStep(symbol);
+  }
+  std::vector<AlignedDoubleVector> &powers = m_powers[symbol];
+  std::vector<AlignedStateVector> &midStates = m_midStates[symbol];
+  const int squareSize = m_numberOfStates * m_numberOfStates;
+  while (static_cast<int>(powers.size()) < power) {
+    // Square the previous power, one row at a time
+    const double *previous = getPower(symbol, powers.size());
+    AlignedDoubleVector square(squareSize);
+    AlignedStateVector mid(squareSize);
+    for (int from = 0; from < m_numberOfStates; from++) {
+      MaxPlus::step(
+        &previous[from * m_numberOfStates],
+        previous,
+        m_numberOfStates,
+        &square[from * m_numberOfStates],
+        &mid[from * m_numberOfStates]);
+    }
+    powers.push_back(AlignedDoubleVector());
+    powers.back().swap(square);
+    midStates.push_back(AlignedStateVector());
+    midStates.back().swap(mid);
+  }
+  return &powers[power - 1][0];
+}
+
+void StepPowers::expandPath(
+  int symbol, int power, int from, int to, int *states) {
+  if (power == 0) {
+    states[0] = to;
+    return;
+  }
+  getPower(symbol, power);
+  const int mid =
+    m_midStates[symbol][power - 1][from * m_numberOfStates + to];
+  const std::size_t half = static_cast<std::size_t>(1) << (power - 1);
+  expandPath(symbol, power - 1, from, mid, states);
+  expandPath(symbol, power - 1, mid, to, states + half);
+}
+
+}  // namespace justkeydding
@@ -0,0 +1,242 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Fixed-lag Viterbi decoder for observations arriving incrementally
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "./streamingviterbidecoder.h"
+
+#include<limits>
+
+namespace justkeydding {
+
+StreamingViterbiDecoder::StreamingViterbiDecoder(
+  CompiledKeyModel::ConstPointer model,
+  std::size_t maximumLag) :
+  m_status(Status::STREAMINGVITERBIDECODER_UNINITIALIZED),
+  m_model(model),
+  m_numberOfStates(model->getNumberOfStates()),
+  m_maximumLag(maximumLag > 0 ? maximumLag : 1),
+  m_numberOfObservations(0),
+  m_numberOfCommittedFrames(0),
+  m_scores(m_numberOfStates),
+  m_nextScores(m_numberOfStates),
+  m_backPointers(m_maximumLag * m_numberOfStates, -1) {
+  m_latencyStatistics.numberOfCommits = 0;
+  m_latencyStatistics.numberOfForcedCommits = 0;
+  m_latencyStatistics.numberOfCommittedFrames = 0;
+  m_latencyStatistics.maximumLag = 0;
+  m_latencyStatistics.meanLag = 0.0;
+  m_latencyStatistics.lagHistogram.assign(m_maximumLag + 1, 0);
+}
+
+void StreamingViterbiDecoder::addObservation(const PitchClass &observation) {
+  addSymbol(observation.getInt());
+}
+
+void StreamingViterbiDecoder::addObservation(const Key &observation) {
+  addSymbol(observation.getInt());
+}
+
+void StreamingViterbiDecoder::addSymbol(int symbol) {
+  // Survivor sets are 32-bit masks
+  if (m_numberOfStates == 0 || m_numberOfStates > 32) {
+    return;
+  }
+  if (m_numberOfObservations == 0) {
+    const double *logStart = m_model->getLogStart(symbol);
+    std::copy(logStart, logStart + m_numberOfStates, m_scores.begin());
+  } else {
+    MaxPlus::step(
+      &m_scores[0],
+      m_model->getLogStep(symbol),
+      m_numberOfStates,
+      &m_nextScores[0],
+      &m_backPointers[
+        (m_numberOfObservations % m_maximumLag) * m_numberOfStates]);
+    m_scores.swap(m_nextScores);
+  }
+  m_numberOfObservations++;
+  m_status = Status::STREAMINGVITERBIDECODER_DECODING;
+  commitConverged();
+  if (m_numberOfObservations - m_numberOfCommittedFrames > m_maximumLag) {
+    commitOldest();
+  }
+}
+
+void StreamingViterbiDecoder::finish() {
+  if (m_numberOfCommittedFrames < m_numberOfObservations) {
+    int bestState = getBestState();
+    if (bestState == -1) {
+      // Every path is impossible under this model
+      return;
+    }
+    commit(m_numberOfObservations - 1, bestState, false);
+  }
+  if (m_numberOfObservations > 0) {
+    m_status = Status::STREAMINGVITERBIDECODER_READY;
+  }
+}
+
+int StreamingViterbiDecoder::getPredecessor(
+  std::size_t frame, int state) const {
+  return m_backPointers[
+    (frame % m_maximumLag) * m_numberOfStates + state];
+}
+
+// Ties are resolved towards the lowest state, as in HiddenMarkovModel
+int StreamingViterbiDecoder::getBestState() const {
+  double maximumProbability = -std::numeric_limits<double>::infinity();
+  int bestState = -1;
+  for (int state = 0; state < m_numberOfStates; state++) {
+    if (m_scores[state] > maximumProbability) {
+      maximumProbability = m_scores[state];
+      bestState = state;
+    }
+  }
+  return bestState;
+}
+
+void StreamingViterbiDecoder::commitConverged() {
+  uint32_t survivors = 0;
+  for (int state = 0; state < m_numberOfStates; state++) {
+    if (m_scores[state] != -std::numeric_limits<double>::infinity()) {
+      survivors |= static_cast<uint32_t>(1) << state;
+    }
+  }
+  if (!survivors) {
+    return;
+  }
+  // Walk the survivors back until they share a single ancestor
+  std::size_t frame = m_numberOfObservations - 1;
+  while ((survivors & (survivors - 1)) &&
+      frame > m_numberOfCommittedFrames) {
+    uint32_t predecessors = 0;
+    for (int state = 0; state < m_numberOfStates; state++) {
+      if (survivors & (static_cast<uint32_t>(1) << state)) {
+        predecessors |=
+          static_cast<uint32_t>(1) << getPredecessor(frame, state);
+      }
+    }
+    survivors = predecessors;
+    frame--;
+  }
+  if (survivors & (survivors - 1)) {
+    return;
+  }
+  int convergenceState = 0;
+  while (!(survivors & (static_cast<uint32_t>(1) << convergenceState))) {
+    convergenceState++;
+  }
+  commit(frame, convergenceState, false);
+}
+
+void StreamingViterbiDecoder::commitOldest() {
+  int bestState = getBestState();
+  if (bestState == -1) {
+    return;
+  }
+  // State of every survivor at the oldest uncommitted frame
+  const std::size_t oldestFrame = m_numberOfCommittedFrames;
+  std::vector<int> ancestors(m_numberOfStates);
+  for (int state = 0; state < m_numberOfStates; state++) {
+    ancestors[state] = state;
+  }
+  for (std::size_t frame = m_numberOfObservations - 1; frame > oldestFrame;
+      frame--) {
+    for (int state = 0; state < m_numberOfStates; state++) {
+      if (ancestors[state] >= 0) {
+        ancestors[state] = getPredecessor(frame, ancestors[state]);
+      }
+    }
+  }
+  // Keep only the paths that agree with the committed state
+  const int oldestState = ancestors[bestState];
+  for (int state = 0; state < m_numberOfStates; state++) {
+    if (ancestors[state] != oldestState) {
+      m_scores[state] = -std::numeric_limits<double>::infinity();
+    }
+  }
+  commit(oldestFrame, oldestState, true);
+}
+
+void StreamingViterbiDecoder::commit(
+  std::size_t lastFrame, int lastState, bool forced) {
+  const std::size_t firstFrame = m_numberOfCommittedFrames;
+  m_path.resize(lastFrame - firstFrame + 1);
+  for (std::size_t frame = lastFrame; frame > firstFrame; frame--) {
+    m_path[frame - firstFrame] = lastState;
+    lastState = getPredecessor(frame, lastState);
+  }
+  m_path[0] = lastState;
+  for (std::size_t frame = firstFrame; frame <= lastFrame; frame++) {
+    m_committedKeys.push_back(
+      Key(m_model->getState(m_path[frame - firstFrame])));
+    std::size_t lag = m_numberOfObservations - 1 - frame;
+    m_latencyStatistics.lagHistogram[lag]++;
+    if (lag > m_latencyStatistics.maximumLag) {
+      m_latencyStatistics.maximumLag = lag;
+    }
+  }
+  m_latencyStatistics.numberOfCommits++;
+  if (forced) {
+    m_latencyStatistics.numberOfForcedCommits++;
+  }
+  m_latencyStatistics.numberOfCommittedFrames += m_path.size();
+  m_numberOfCommittedFrames = lastFrame + 1;
+}
+
+Key::KeySequence StreamingViterbiDecoder::takeCommittedKeys() {
+  Key::KeySequence committedKeys;
+  committedKeys.swap(m_committedKeys);
+  return committedKeys;
+}
+
+std::size_t StreamingViterbiDecoder::getNumberOfObservations() const {
+  return m_numberOfObservations;
+}
+
+std::size_t StreamingViterbiDecoder::getNumberOfCommittedFrames() const {
+  return m_numberOfCommittedFrames;
+}
+
+StreamingViterbiDecoder::LatencyStatistics
+StreamingViterbiDecoder::getLatencyStatistics() const {
+  LatencyStatistics latencyStatistics = m_latencyStatistics;
+  double totalLag = 0.0;
+  for (std::size_t lag = 0; lag < latencyStatistics.lagHistogram.size();
+      lag++) {
+    totalLag += static_cast<double>(lag) * latencyStatistics.lagHistogram[lag];
+  }
+  if (latencyStatistics.numberOfCommittedFrames > 0) {
+    latencyStatistics.meanLag =
+      totalLag / latencyStatistics.numberOfCommittedFrames;
+  }
+  return latencyStatistics;
+}
+
+int StreamingViterbiDecoder::getStatus() const {
+  return m_status;
+}
+
+}  // namespace justkeydding
@@ -0,0 +1,94 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Benchmark of the multi-threaded chroma extraction
+
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include<chrono>
+#include<string>
+#include<vector>
+#include<thread>
+#include<iostream>
+#include<algorithm>
+
+#include "./chromagrambuffer.h"
+#include "./audiochromastream.h"
+#include "./status.h"
+
+using justkeydding::ChromagramBuffer;
+using justkeydding::AudioChromaStream;
+using justkeydding::Status;
+
+// Seconds to extract the chromagram of a file, offline
+static double extract(
+    const std::string &fileName,
+    int numberOfThreads,
+    ChromagramBuffer *chromagram) {
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    AudioChromaStream stream(fileName, -1, numberOfThreads,
+        NNLSChroma::LawsonHansonSolver, numberOfThreads);
+    while (stream.read(chromagram)) {
+    }
+    if (stream.getStatus() != Status::AUDIOCHROMASTREAM_READY) {
+        std::cout << "Could not read " << fileName << std::endl;
+    }
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+// Extracts every file on 1 to the number of cores threads, with as many
+// front ends, and checks that the chromagrams do not change, e.g.:
+//
+//   bin/benchmark_audiochromastream test_data/*.wav
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cout << "usage: " << argv[0]
+            << " file.wav [file.wav ...]" << std::endl;
+        return 1;
+    }
+    const int numberOfCores =
+        std::max(std::thread::hardware_concurrency(), 1u);
+    int mismatches = 0;
+    std::vector<ChromagramBuffer> reference(argc - 1);
+    for (int threads = 1; threads <= numberOfCores; threads++) {
+        double seconds = 0;
+        std::size_t numberOfFrames = 0;
+        for (int file = 1; file < argc; file++) {
+            ChromagramBuffer chromagram;
+            seconds += extract(argv[file], threads, &chromagram);
+            numberOfFrames += chromagram.getNumberOfFrames();
+            if (threads == 1) {
+                reference[file - 1] = chromagram;
+            } else if (chromagram.getFrames() !=
+                reference[file - 1].getFrames()) {
+                mismatches++;
+            }
+        }
+        std::cout << threads << " threads: " << numberOfFrames
+            << " frames in " << seconds << " s" << std::endl;
+    }
+    std::cout << mismatches << " mismatches" << std::endl;
+    return mismatches != 0;
+}
@@ -0,0 +1,125 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Benchmark of the chromagram CSV reader against the stream parser
+
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include<map>
+#include<array>
+#include<chrono>
+#include<string>
+#include<thread>
+#include<fstream>
+#include<sstream>
+#include<iostream>
+#include<algorithm>
+
+#include "./pitchclass.h"
+#include "./chromagramcsvreader.h"
+#include "./status.h"
+
+using justkeydding::PitchClass;
+using justkeydding::ChromagramCsvReader;
+using justkeydding::Status;
+
+typedef std::array<double, PitchClass::NUMBER_OF_PITCHCLASSES> Frame;
+
+// The getline and std::stof parser Chromagram used before the reader
+static std::size_t streamParse(const std::string &fileName) {
+    std::map<double, Frame> chromagram;
+    std::ifstream infile(fileName);
+    std::string line;
+    double timeStamp = 0.0;
+    while (std::getline(infile, line)) {
+        std::istringstream sstr(line);
+        std::string token;
+        int i = 0;
+        while (std::getline(sstr, token, ',')) {
+            if (i == 0) {
+                timeStamp = std::stof(token);
+            } else {
+                int pcIndex =
+                    (PitchClass::PITCHCLASS_A_NATURAL + (i-1))
+                    % PitchClass::NUMBER_OF_PITCHCLASSES;
+                chromagram[timeStamp][pcIndex] = std::stof(token);
+            }
+            i++;
+        }
+    }
+    return chromagram.size();
+}
+
+// Reads every file with the stream parser and with the memory-mapped
+// reader on 1 to the number of cores threads, e.g.:
+//
+//   bin/benchmark_chromagramcsvreader chroma/*.csv
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cout << "usage: " << argv[0]
+            << " file.csv [file.csv ...]" << std::endl;
+        return 0;
+    }
+    std::size_t numberOfBytes = 0;
+    std::size_t numberOfFrames = 0;
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    for (int i = 1; i < argc; i++) {
+        numberOfFrames += streamParse(argv[i]);
+    }
+    double streamTime = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    int numberOfCores = std::max(1u, std::thread::hardware_concurrency());
+    for (int threads = 0; threads <= numberOfCores; threads++) {
+        double seconds = 0.0;
+        std::size_t readerFrames = 0;
+        numberOfBytes = 0;
+        for (int i = 1; i < argc; i++) {
+            ChromagramCsvReader reader(argv[i]);
+            reader.setNumberOfThreads(threads);
+            reader.read();
+            if (reader.getStatus() != Status::CHROMAGRAMCSVREADER_READY) {
+                std::cerr << "Could not read " << argv[i] << std::endl;
+                return 1;
+            }
+            seconds += reader.getSeconds();
+            numberOfBytes += reader.getNumberOfBytes();
+            readerFrames +=
+                reader.getChromagramBuffer().getNumberOfFrames();
+        }
+        if (threads == 0) {
+            std::cout << numberOfBytes / 1e6 << " MB, "
+                << numberOfFrames << " frames" << std::endl
+                << "stream parser: "
+                << numberOfBytes / 1e6 / streamTime << " MB/s" << std::endl
+                << "reader, automatic threads: ";
+        } else {
+            std::cout << "reader, " << threads << " threads: ";
+        }
+        std::cout << numberOfBytes / 1e6 / seconds << " MB/s, speedup "
+            << streamTime / seconds
+            << (readerFrames == numberOfFrames ? "" : " (different frames)")
+            << std::endl;
+    }
+    return 0;
+}
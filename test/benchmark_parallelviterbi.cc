@@ -0,0 +1,115 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Speedup of the parallel Viterbi decoder versus the number of threads
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include<cmath>
+#include<chrono>
+#include<vector>
+#include<memory>
+#include<thread>
+#include<cstdlib>
+#include<iostream>
+
+#include "./pitchclass.h"
+#include "./key.h"
+#include "./keytransition.h"
+#include "./keyprofile.h"
+#include "./compiledkeymodel.h"
+#include "./hiddenmarkovmodel.h"
+#include "./midi.h"
+#include "./status.h"
+
+using justkeydding::PitchClass;
+using justkeydding::KeyTransition;
+using justkeydding::KeyProfile;
+using justkeydding::Key;
+using justkeydding::CompiledKeyModel;
+using justkeydding::HiddenMarkovModel;
+using justkeydding::Midi;
+using justkeydding::Status;
+
+// Decodes the concatenation of the given MIDI files (repeated to get
+// a long sequence) sequentially, then in parallel with 1 to the number
+// of cores threads, e.g.:
+//
+//   bin/benchmark_parallelviterbi 100 test_data/*.mid
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        std::cout << "usage: " << argv[0]
+            << " repetitions file.mid [file.mid ...]" << std::endl;
+        return 0;
+    }
+    const int repetitions = std::atoi(argv[1]);
+    PitchClass::PitchClassSequence corpus;
+    for (int i = 2; i < argc; i++) {
+        Midi midi(argv[i]);
+        if (midi.getStatus() != Status::MIDI_READY) {
+            std::cerr << "Could not read " << argv[i] << std::endl;
+            return 1;
+        }
+        PitchClass::PitchClassSequence sequence =
+            midi.getPitchClassSequence();
+        for (PitchClass::PitchClassSequence::const_iterator it =
+            sequence.begin(); it != sequence.end(); it++) {
+            corpus.push_back(*it);
+        }
+    }
+    PitchClass::PitchClassSequence pitchClassSequence;
+    for (int r = 0; r < repetitions; r++) {
+        for (PitchClass::PitchClassSequence::const_iterator it =
+            corpus.begin(); it != corpus.end(); it++) {
+            pitchClassSequence.push_back(*it);
+        }
+    }
+    CompiledKeyModel::ConstPointer model =
+        std::make_shared<CompiledKeyModel>(
+            KeyProfile("sapp", "sapp"), KeyTransition("exponential10"));
+    HiddenMarkovModel sequential(pitchClassSequence, model);
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    sequential.runViterbi();
+    double sequentialTime = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    std::cout << pitchClassSequence.size() << " observations" << std::endl
+        << "sequential: " << sequentialTime << " s" << std::endl;
+    int numberOfCores = std::max(1u, std::thread::hardware_concurrency());
+    bool identical = true;
+    for (int threads = 1; threads <= numberOfCores; threads++) {
+        HiddenMarkovModel parallel(pitchClassSequence, model);
+        parallel.setViterbiMode(HiddenMarkovModel::VITERBI_PARALLEL);
+        parallel.setNumberOfThreads(threads);
+        start = std::chrono::steady_clock::now();
+        parallel.runViterbi();
+        double parallelTime = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+        bool samePath =
+            parallel.getKeySequence() == sequential.getKeySequence();
+        identical = identical && samePath;
+        std::cout << threads << " threads: " << parallelTime << " s, "
+            << "speedup " << sequentialTime / parallelTime
+            << (samePath ? "" : " (different path)") << std::endl;
+    }
+    return identical ? 0 : 1;
+}
@@ -0,0 +1,137 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Test of the streaming chroma extraction
+
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include<string>
+#include<iostream>
+#include<algorithm>
+#include<cmath>
+
+#include "./chromagrambuffer.h"
+#include "./audiochromastream.h"
+#include "./status.h"
+
+using justkeydding::ChromagramBuffer;
+using justkeydding::AudioChromaStream;
+using justkeydding::Status;
+using justkeydding::PitchClass;
+
+static const int LAWSON_HANSON = NNLSChroma::LawsonHansonSolver;
+static const int WARM_START = NNLSChroma::WarmStartSolver;
+
+// Largest difference between the frames of a and b, relative to the
+// largest value of the frame of b
+static float getLargestDifference(
+    const ChromagramBuffer &a,
+    const ChromagramBuffer &b) {
+    float largestDifference = 0;
+    for (std::size_t frame = 0; frame < b.getNumberOfFrames(); frame++) {
+        const float *chrA = a.getFrame(frame);
+        const float *chrB = b.getFrame(frame);
+        float largest = *std::max_element(
+            chrB, chrB + PitchClass::NUMBER_OF_PITCHCLASSES);
+        for (int pc = 0; pc < PitchClass::NUMBER_OF_PITCHCLASSES; pc++) {
+            if (largest > 0) {
+                largestDifference = std::max(largestDifference,
+                    std::fabs(chrA[pc] - chrB[pc]) / largest);
+            }
+        }
+    }
+    return largestDifference;
+}
+
+// Every frame of the file, and the number of reads that gave frames
+static ChromagramBuffer extract(
+    const std::string &fileName,
+    double warmUpSeconds,
+    int numberOfThreads,
+    int nnlsSolver,
+    int numberOfFrontEnds,
+    int *numberOfReads) {
+    AudioChromaStream stream(fileName, warmUpSeconds, numberOfThreads,
+        nnlsSolver, numberOfFrontEnds);
+    ChromagramBuffer chromagram;
+    *numberOfReads = 0;
+    std::size_t numberOfFrames = 0;
+    while (stream.read(&chromagram)) {
+        if (chromagram.getNumberOfFrames() > numberOfFrames) {
+            (*numberOfReads)++;
+        }
+        numberOfFrames = chromagram.getNumberOfFrames();
+    }
+    if (stream.getStatus() != Status::AUDIOCHROMASTREAM_READY) {
+        std::cout << "Could not read " << fileName << std::endl;
+    }
+    std::cout << fileName << ", warm-up " << warmUpSeconds << " s, "
+        << numberOfThreads << " threads, " << numberOfFrontEnds
+        << " front ends: "
+        << chromagram.getNumberOfFrames() << " frames in "
+        << *numberOfReads << " reads, tuning "
+        << stream.getParameters().tuning << " Hz" << std::endl;
+    NNLSChroma::NNLSStatistics statistics = stream.getNNLSStatistics();
+    std::cout << "  NNLS solver " << nnlsSolver << ": "
+        << statistics.solves << " solves, "
+        << statistics.warmStartHits << " of " << statistics.warmStarts
+        << " warm starts kept whole, " << statistics.iterations
+        << " iterations, " << statistics.seededColumnsKept
+        << " seeded columns kept, " << statistics.unconverged
+        << " stopped at the iteration limit" << std::endl;
+    return chromagram;
+}
+
+int main(int argc, char *argv[]) {
+    const std::string fileName =
+        argc > 1 ? argv[1] : "test_data/01_C.wav";
+    int mismatches = 0;
+    int offlineReads, parallelReads, longReads, streamingReads;
+    ChromagramBuffer offline = extract(fileName, -1, 1, LAWSON_HANSON, 1, &offlineReads);
+    // Front ends on chunks of the file, as a single one
+    ChromagramBuffer parallel = extract(fileName, -1, 4, LAWSON_HANSON, 4, &parallelReads);
+    mismatches += parallel.getFrames() != offline.getFrames() ||
+        parallel.getTimestamps() != offline.getTimestamps();
+    // A warm-up longer than the file tunes on all of it, as offline
+    ChromagramBuffer longWarmUp = extract(fileName, 1e6, 1, LAWSON_HANSON, 1, &longReads);
+    mismatches += longWarmUp.getFrames() != offline.getFrames() ||
+        longWarmUp.getTimestamps() != offline.getTimestamps();
+    // A short one gives the frames while the file is read
+    ChromagramBuffer streaming = extract(fileName, 2, 0, LAWSON_HANSON, 1, &streamingReads);
+    mismatches += offline.isEmpty() || offlineReads != 1;
+    mismatches += streaming.getTimestamps() != offline.getTimestamps();
+    mismatches += streamingReads < 2;
+    // Warm starts agree with the default solver to rounding, and do not
+    // depend on the threads
+    int warmReads, parallelWarmReads;
+    ChromagramBuffer warm =
+        extract(fileName, -1, 1, WARM_START, 1, &warmReads);
+    ChromagramBuffer parallelWarm =
+        extract(fileName, -1, 4, WARM_START, 4, &parallelWarmReads);
+    mismatches += parallelWarm.getFrames() != warm.getFrames();
+    mismatches += warm.getTimestamps() != offline.getTimestamps() ||
+        getLargestDifference(warm, offline) > 1e-4;
+    std::cout << "audio chroma stream, "
+        << mismatches << " mismatches" << std::endl;
+    return mismatches != 0;
+}
@@ -0,0 +1,92 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Test of the contiguous chromagram storage
+
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include<vector>
+#include<iostream>
+
+#include "./pitchclass.h"
+#include "./chromagrambuffer.h"
+
+using justkeydding::PitchClass;
+using justkeydding::ChromagramBuffer;
+
+int main(int argc, char *argv[]) {
+    int mismatches = 0;
+    // Out of order, with a repeated timestamp
+    const double timestamps[] = {0.2, 0.0, 0.1, 0.2, 0.3};
+    ChromagramBuffer chromagram;
+    chromagram.reserve(5);
+    for (int frame = 0; frame < 5; frame++) {
+        float *chrVector = chromagram.appendFrame(timestamps[frame]);
+        for (int pc = 0; pc < PitchClass::NUMBER_OF_PITCHCLASSES; pc++) {
+            chrVector[pc] = frame + pc * 0.25f;
+        }
+    }
+    chromagram.sortByTimestamp();
+    // The second frame at 0.2 replaces the first one
+    const double sortedTimestamps[] = {0.0, 0.1, 0.2, 0.3};
+    const int sortedFrames[] = {1, 2, 3, 4};
+    if (chromagram.getNumberOfFrames() != 4) {
+        std::cout << chromagram.getNumberOfFrames()
+            << " frames instead of 4" << std::endl;
+        return 1;
+    }
+    for (int frame = 0; frame < 4; frame++) {
+        bool equal = chromagram.getTimestamp(frame) == sortedTimestamps[frame];
+        std::cout << chromagram.getTimestamp(frame);
+        for (int pc = 0; pc < PitchClass::NUMBER_OF_PITCHCLASSES; pc++) {
+            float value = chromagram.getFrame(frame)[pc];
+            int discrete = chromagram.getDiscreteChroma(frame, pc);
+            std::cout << " " << discrete;
+            equal = equal && value == sortedFrames[frame] + pc * 0.25f &&
+                discrete == sortedFrames[frame] + pc / 4;
+        }
+        std::cout << (equal ? " == " : " != ") << "frame "
+            << sortedFrames[frame] << std::endl;
+        mismatches += !equal;
+    }
+    // Same discrete values, different original ones
+    ChromagramBuffer::TimestampVector pairTimestamps(2);
+    pairTimestamps[1] = 1.0;
+    ChromagramBuffer::FrameMatrix pairFrames(
+        2 * PitchClass::NUMBER_OF_PITCHCLASSES, 1.5f);
+    pairFrames[PitchClass::NUMBER_OF_PITCHCLASSES] = 1.75f;
+    ChromagramBuffer pair(pairTimestamps, pairFrames);
+    bool same = pair.isSameDiscreteFrame(0, 1);
+    std::cout << "1.5" << (same ? " == " : " != ") << "1.75" << std::endl;
+    mismatches += !same;
+    pairFrames[PitchClass::NUMBER_OF_PITCHCLASSES] = 2.0f;
+    ChromagramBuffer different(pairTimestamps, pairFrames);
+    same = different.isSameDiscreteFrame(0, 1);
+    std::cout << "1.5" << (same ? " == " : " != ") << "2" << std::endl;
+    mismatches += same;
+    if (!ChromagramBuffer().isEmpty()) {
+        std::cout << "default buffer not empty" << std::endl;
+        mismatches++;
+    }
+    return mismatches == 0 ? 0 : 1;
+}
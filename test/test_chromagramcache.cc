@@ -0,0 +1,179 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Test of the binary chromagram cache and its CSV conversion
+
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<string>
+#include<vector>
+#include<fstream>
+#include<sstream>
+#include<iostream>
+
+#include "./pitchclass.h"
+#include "./chromagrambuffer.h"
+#include "./chromagramcsvreader.h"
+#include "./chromagramcache.h"
+#include "./status.h"
+
+using justkeydding::PitchClass;
+using justkeydding::ChromagramBuffer;
+using justkeydding::ChromagramCsvReader;
+using justkeydding::ChromagramCache;
+using justkeydding::Status;
+
+static bool sameFrames(const ChromagramBuffer &a, const ChromagramBuffer &b) {
+    return a.getNumberOfFrames() == b.getNumberOfFrames() &&
+        (a.isEmpty() || (
+        std::memcmp(&a.getTimestamps()[0], &b.getTimestamps()[0],
+            a.getNumberOfFrames() * sizeof(double)) == 0 &&
+        std::memcmp(&a.getFrames()[0], &b.getFrames()[0],
+            a.getFrames().size() * sizeof(float)) == 0));
+}
+
+static void writeCsv(const std::string &fileName, const ChromagramBuffer &c) {
+    std::ofstream outfile(fileName);
+    c.writeCsv(outfile, true);
+}
+
+int main(int argc, char *argv[]) {
+    const std::string cacheFileName = "test_chromagramcache.chroma";
+    const std::string csvFileName = "test_chromagramcache.csv";
+    int mismatches = 0;
+    // Timestamps as read from text (floats), any normal chroma value
+    std::srand(1);
+    ChromagramBuffer chromagram;
+    for (int frame = 0; frame < 1000; frame++) {
+        float *chrVector = chromagram.appendFrame(
+            static_cast<float>(frame * 0.046439909));
+        for (int pc = 0; pc < PitchClass::NUMBER_OF_PITCHCLASSES; pc++) {
+            unsigned int pattern = std::rand() * 2654435761u;
+            pattern = (pattern & 0x7e7fffffu) | 0x00800000u;
+            if (pc % 3 == 0) {
+                chrVector[pc] = static_cast<float>(std::rand()) / RAND_MAX;
+            } else {
+                std::memcpy(&chrVector[pc], &pattern, sizeof(float));
+            }
+        }
+    }
+    ChromagramCache::Parameters parameters;
+    parameters.sampleRate = 44100.0;
+    parameters.blockSize = 16384;
+    parameters.stepSize = 2048;
+    parameters.useNNLS = 1.0f;
+    parameters.whitening = 1.0f;
+    parameters.spectralShape = 0.7f;
+    parameters.rollOn = 0.0f;
+    parameters.boostN = 0.1f;
+    parameters.tuningMode = 0.0f;
+    parameters.chromaNormalize = 0.0f;
+    parameters.tuning = 441.3f;
+    if (!ChromagramCache::write(cacheFileName, chromagram, parameters)) {
+        std::cout << "Could not write " << cacheFileName << std::endl;
+        return 1;
+    }
+    ChromagramCache cache(cacheFileName);
+    if (cache.getStatus() != Status::CHROMAGRAMCACHE_READY) {
+        std::cout << "Could not read " << cacheFileName << std::endl;
+        return 1;
+    }
+    const ChromagramCache::Parameters &read = cache.getParameters();
+    bool equal = read.sampleRate == parameters.sampleRate &&
+        read.blockSize == parameters.blockSize &&
+        read.stepSize == parameters.stepSize &&
+        read.useNNLS == parameters.useNNLS &&
+        read.whitening == parameters.whitening &&
+        read.spectralShape == parameters.spectralShape &&
+        read.rollOn == parameters.rollOn &&
+        read.boostN == parameters.boostN &&
+        read.tuningMode == parameters.tuningMode &&
+        read.chromaNormalize == parameters.chromaNormalize &&
+        read.tuning == parameters.tuning;
+    // The mapped frames are the written ones
+    ChromagramBuffer cached = cache.getChromagramBuffer();
+    equal = equal && sameFrames(chromagram, cached) &&
+        std::memcmp(cache.getFrames(), &chromagram.getFrames()[0],
+            chromagram.getFrames().size() * sizeof(float)) == 0;
+    std::cout << cache.getNumberOfFrames() << " frames, tuning "
+        << read.tuning << " Hz" << (equal ? " == " : " != ")
+        << "written" << std::endl;
+    mismatches += !equal;
+    // Cache to CSV to cache, without losing a bit
+    writeCsv(csvFileName, cached);
+    ChromagramCsvReader reader(csvFileName);
+    reader.read();
+    std::ostringstream firstCsv;
+    std::ostringstream secondCsv;
+    cached.writeCsv(firstCsv, true);
+    ChromagramCache::write(cacheFileName, reader.getChromagramBuffer(),
+        ChromagramCache::Parameters());
+    ChromagramCache(cacheFileName).getChromagramBuffer().writeCsv(
+        secondCsv, true);
+    equal = sameFrames(chromagram, reader.getChromagramBuffer()) &&
+        firstCsv.str() == secondCsv.str();
+    std::cout << "through CSV" << (equal ? " == " : " != ")
+        << "written" << std::endl;
+    mismatches += !equal;
+    // An empty chromagram
+    ChromagramCache::write(cacheFileName, ChromagramBuffer(), parameters);
+    ChromagramCache empty(cacheFileName);
+    if (empty.getStatus() != Status::CHROMAGRAMCACHE_READY ||
+        empty.getNumberOfFrames() != 0) {
+        std::cout << "Empty cache not read" << std::endl;
+        mismatches++;
+    }
+    // Truncated, and not a cache at all
+    ChromagramCache::write(cacheFileName, chromagram, parameters);
+    std::vector<char> bytes;
+    {
+        std::ifstream infile(cacheFileName, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(infile),
+            std::istreambuf_iterator<char>());
+    }
+    {
+        std::ofstream outfile(cacheFileName, std::ios::binary);
+        outfile.write(&bytes[0], bytes.size() - 1);
+    }
+    if (ChromagramCache(cacheFileName).getStatus() !=
+        Status::CHROMAGRAMCACHE_FORMAT_ERROR) {
+        std::cout << "Truncated cache not detected" << std::endl;
+        mismatches++;
+    }
+    if (ChromagramCache(csvFileName).getStatus() !=
+        Status::CHROMAGRAMCACHE_FORMAT_ERROR) {
+        std::cout << "CSV file taken for a cache" << std::endl;
+        mismatches++;
+    }
+    std::remove(cacheFileName.c_str());
+    std::remove(csvFileName.c_str());
+    if (ChromagramCache(cacheFileName).getStatus() !=
+        Status::CHROMAGRAMCACHE_INPUTFILE_ERROR) {
+        std::cout << "Missing cache not detected" << std::endl;
+        mismatches++;
+    }
+    return mismatches == 0 ? 0 : 1;
+}
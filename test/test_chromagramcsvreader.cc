@@ -0,0 +1,210 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Test of the memory-mapped chromagram CSV reader
+
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<string>
+#include<vector>
+#include<map>
+#include<array>
+#include<fstream>
+#include<sstream>
+#include<iostream>
+
+#include "./pitchclass.h"
+#include "./chromagrambuffer.h"
+#include "./chromagramcsvreader.h"
+#include "./status.h"
+
+using justkeydding::PitchClass;
+using justkeydding::ChromagramBuffer;
+using justkeydding::ChromagramCsvReader;
+using justkeydding::Status;
+
+typedef std::array<double, PitchClass::NUMBER_OF_PITCHCLASSES> Frame;
+
+// The getline and std::stof parser the reader replaces
+static std::map<double, Frame> referenceParse(const std::string &fileName) {
+    std::map<double, Frame> chromagram;
+    std::ifstream infile(fileName);
+    std::string line;
+    double timeStamp = 0.0;
+    while (std::getline(infile, line)) {
+        std::istringstream sstr(line);
+        std::string token;
+        int i = 0;
+        while (std::getline(sstr, token, ',')) {
+            if (i == 0) {
+                timeStamp = std::stof(token);
+            } else {
+                int pcIndex =
+                    (PitchClass::PITCHCLASS_A_NATURAL + (i-1))
+                    % PitchClass::NUMBER_OF_PITCHCLASSES;
+                chromagram[timeStamp][pcIndex] = std::stof(token);
+            }
+            i++;
+        }
+    }
+    return chromagram;
+}
+
+// Every way a chroma value has been seen written
+static std::string formatValue(unsigned int n) {
+    char buffer[64];
+    double value = static_cast<double>(std::rand()) / RAND_MAX;
+    float bits;
+    unsigned int pattern = std::rand() * 2654435761u;
+    switch (n % 8) {
+        case 0:
+            std::snprintf(buffer, sizeof(buffer), "%g", value * 4);
+            break;
+        case 1:
+            std::snprintf(buffer, sizeof(buffer), "%.17g", value);
+            break;
+        case 2:
+            std::snprintf(buffer, sizeof(buffer), "%e", value * 1e-7);
+            break;
+        case 3:
+            std::snprintf(buffer, sizeof(buffer), "%d", std::rand() % 10);
+            break;
+        case 4:
+            std::snprintf(buffer, sizeof(buffer), "-%.9g", value * 100);
+            break;
+        case 5:
+            // Any normal float, printed to round-trip
+            pattern = (pattern & 0x7e7fffffu) | 0x00800000u;
+            std::memcpy(&bits, &pattern, sizeof(bits));
+            std::snprintf(buffer, sizeof(buffer), "%.9g", bits);
+            break;
+        case 6:
+            std::snprintf(buffer, sizeof(buffer), "%.25f", value);
+            break;
+        default:
+            std::snprintf(buffer, sizeof(buffer), "%.6f", value * 2);
+            break;
+    }
+    return buffer;
+}
+
+static void writeFile(const std::string &fileName, const std::string &text) {
+    std::ofstream outfile(fileName);
+    outfile << text;
+}
+
+static int compare(
+    const std::string &fileName,
+    int numberOfThreads,
+    const std::map<double, Frame> &reference) {
+    ChromagramCsvReader reader(fileName);
+    reader.setNumberOfThreads(numberOfThreads);
+    reader.read();
+    const ChromagramBuffer &chromagram = reader.getChromagramBuffer();
+    if (reader.getStatus() != Status::CHROMAGRAMCSVREADER_READY ||
+        chromagram.getNumberOfFrames() != reference.size()) {
+        std::cout << numberOfThreads << " threads: "
+            << chromagram.getNumberOfFrames() << " frames instead of "
+            << reference.size() << std::endl;
+        return 1;
+    }
+    int mismatches = 0;
+    std::size_t row = 0;
+    for (std::map<double, Frame>::const_iterator it = reference.begin();
+        it != reference.end(); it++, row++) {
+        bool same = chromagram.getTimestamp(row) == it->first;
+        for (int pc = 0; pc < PitchClass::NUMBER_OF_PITCHCLASSES; pc++) {
+            double value = chromagram.getFrame(row)[pc];
+            same = same && std::memcmp(&value, &it->second[pc],
+                sizeof(value)) == 0;
+        }
+        mismatches += !same;
+    }
+    std::cout << numberOfThreads << " threads: "
+        << chromagram.getNumberOfFrames() << " frames"
+        << (mismatches == 0 ? " == " : " != ") << "getline and std::stof"
+        << std::endl;
+    return mismatches;
+}
+
+int main(int argc, char *argv[]) {
+    const std::string fileName = "test_chromagramcsvreader.csv";
+    std::srand(1);
+    std::ostringstream text;
+    for (unsigned int frame = 0; frame < 2000; frame++) {
+        text << frame * 0.046439909 << std::string(frame % 5 == 0, ' ');
+        for (int i = 0; i < PitchClass::NUMBER_OF_PITCHCLASSES; i++) {
+            text << "," << formatValue(frame + i);
+        }
+        // Windows line endings and blank lines on the way
+        text << (frame % 7 == 0 ? "\r\n" : "\n");
+        if (frame % 97 == 0) {
+            text << "\n";
+        }
+    }
+    // A last line without line ending
+    text << "92.9,1,2,3,4,5,6,7,8,9,10,11,12";
+    writeFile(fileName, text.str());
+    std::map<double, Frame> reference = referenceParse(fileName);
+    int mismatches = 0;
+    const int numberOfThreads[] = {0, 1, 2, 3, 7};
+    for (int i = 0; i < 5; i++) {
+        mismatches += compare(fileName, numberOfThreads[i], reference);
+    }
+    // Chroma values from A to G#, stored from C to B
+    writeFile(fileName, "0.5,0,0,0,1,0,0,0,0,0,0,0,0\n");
+    ChromagramCsvReader rotated(fileName);
+    rotated.read();
+    if (rotated.getChromagramBuffer().getNumberOfFrames() != 1 ||
+        rotated.getChromagramBuffer().getFrame(0)[
+            PitchClass::PITCHCLASS_C_NATURAL] != 1.0f) {
+        std::cout << "A is not the first column" << std::endl;
+        mismatches++;
+    }
+    writeFile(fileName, "0.0,0.1,0.2\n0.1,0.1,abc\n");
+    ChromagramCsvReader malformed(fileName);
+    malformed.read();
+    if (malformed.getStatus() != Status::CHROMAGRAMCSVREADER_FORMAT_ERROR) {
+        std::cout << "Malformed file not detected" << std::endl;
+        mismatches++;
+    }
+    writeFile(fileName, "");
+    ChromagramCsvReader empty(fileName);
+    empty.read();
+    if (empty.getStatus() != Status::CHROMAGRAMCSVREADER_READY ||
+        !empty.getChromagramBuffer().isEmpty()) {
+        std::cout << "Empty file not read" << std::endl;
+        mismatches++;
+    }
+    std::remove(fileName.c_str());
+    ChromagramCsvReader missing(fileName);
+    missing.read();
+    if (missing.getStatus() != Status::CHROMAGRAMCSVREADER_INPUTFILE_ERROR) {
+        std::cout << "Missing file not detected" << std::endl;
+        mismatches++;
+    }
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Log spectra of chunked front ends compared with a single front end
+
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include<cmath>
+#include<string>
+#include<vector>
+#include<iostream>
+
+#include "./chunkedfrontend.h"
+
+using justkeydding::ChunkedFrontEnd;
+
+static const int SAMPLE_RATE = 44100;
+
+// Log spectra of a single front end over the whole signal, as
+// AudioChromaStream reads a file block by block
+static Vamp::Plugin::FeatureList getSingleFrontEnd(
+    const std::vector<float> &signal,
+    int blockSize) {
+    Vamp::HostExt::PluginBufferingAdapter *adapter =
+        ChunkedFrontEnd::makeAdapter(new NNLSChroma(SAMPLE_RATE));
+    Vamp::Plugin::FeatureList logSpectra;
+    int logSpectrumFeatureNo = -1;
+    if (adapter->initialise(1, blockSize, blockSize)) {
+        Vamp::Plugin::OutputList outputs = adapter->getOutputDescriptors();
+        for (int i = 0; i < static_cast<int>(outputs.size()); ++i) {
+            if (outputs[i].identifier == "logfreqspec") {
+                logSpectrumFeatureNo = i;
+            }
+        }
+    }
+    if (logSpectrumFeatureNo < 0) {
+        delete adapter;
+        return logSpectra;
+    }
+    Vamp::Plugin::FeatureSet fs;
+    for (std::size_t block = 0; block * blockSize < signal.size(); block++) {
+        const float *blockBuffer = &signal[block * blockSize];
+        fs = adapter->process(&blockBuffer,
+            Vamp::RealTime::frame2RealTime(block * blockSize, SAMPLE_RATE));
+        logSpectra.insert(logSpectra.end(),
+            fs[logSpectrumFeatureNo].begin(), fs[logSpectrumFeatureNo].end());
+    }
+    fs = adapter->getRemainingFeatures();
+    logSpectra.insert(logSpectra.end(),
+        fs[logSpectrumFeatureNo].begin(), fs[logSpectrumFeatureNo].end());
+    delete adapter;
+    return logSpectra;
+}
+
+// Log spectra of the chunked front ends, with the blocks appended as
+// AudioChromaStream reads them
+static Vamp::Plugin::FeatureList getChunkedFrontEnds(
+    const std::vector<float> &signal,
+    int blockSize,
+    int numberOfFrontEnds,
+    int blocksPerChunk) {
+    ChunkedFrontEnd frontEnd(
+        SAMPLE_RATE, blockSize, numberOfFrontEnds, blocksPerChunk);
+    Vamp::Plugin::FeatureList logSpectra;
+    if (!frontEnd.isReady()) {
+        return logSpectra;
+    }
+    std::size_t block = 0;
+    while (!frontEnd.isDone()) {
+        while (frontEnd.needsBlocks()) {
+            if (block * blockSize >= signal.size()) {
+                frontEnd.endSignal();
+                break;
+            }
+            frontEnd.appendBlock(&signal[block * blockSize]);
+            block++;
+        }
+        frontEnd.process(&logSpectra);
+    }
+    return logSpectra;
+}
+
+int main(int argc, char *argv[]) {
+    Vamp::HostExt::PluginBufferingAdapter *adapter =
+        ChunkedFrontEnd::makeAdapter(new NNLSChroma(SAMPLE_RATE));
+    const int blockSize = adapter->getPreferredBlockSize();
+    delete adapter;
+    // Twenty seconds of a gliding tone over a fixed one, with a little
+    // noise, zero padded to whole blocks as AudioChromaStream does
+    const std::size_t numberOfSamples = 20 * SAMPLE_RATE;
+    std::vector<float> signal(
+        (numberOfSamples + blockSize - 1) / blockSize * blockSize, 0.f);
+    unsigned int seed = 1;
+    double phase = 0;
+    for (std::size_t i = 0; i < numberOfSamples; i++) {
+        double seconds = static_cast<double>(i) / SAMPLE_RATE;
+        phase += 2 * M_PI * 220 * std::pow(2.0, seconds / 12) / SAMPLE_RATE;
+        seed = seed * 1103515245 + 12345;
+        signal[i] = static_cast<float>(0.4 * std::sin(phase) +
+            0.3 * std::sin(2 * M_PI * 329.63 * seconds) +
+            0.01 * ((seed >> 16) % 2001 - 1000) / 1000.0);
+    }
+    Vamp::Plugin::FeatureList single = getSingleFrontEnd(signal, blockSize);
+    int mismatches = single.empty();
+    std::cout << single.size() << " frames from a single front end"
+        << std::endl;
+    const int frontEnds[] = {1, 2, 3, 4};
+    const int chunks[] = {1, 7, 32, ChunkedFrontEnd::BLOCKS_PER_CHUNK};
+    for (int f = 0; f < 4; f++) {
+        for (int c = 0; c < 4; c++) {
+            Vamp::Plugin::FeatureList chunked = getChunkedFrontEnds(
+                signal, blockSize, frontEnds[f], chunks[c]);
+            bool equal = chunked.size() == single.size();
+            for (std::size_t i = 0; equal && i < single.size(); i++) {
+                equal =
+                    chunked[i].hasTimestamp == single[i].hasTimestamp &&
+                    chunked[i].timestamp == single[i].timestamp &&
+                    chunked[i].values == single[i].values;
+            }
+            std::cout << frontEnds[f] << " front ends, " << chunks[c]
+                << " blocks per chunk" << (equal ? " == " : " != ")
+                << "single front end" << std::endl;
+            if (!equal) {
+                mismatches++;
+            }
+        }
+    }
+    return mismatches == 0 ? 0 : 1;
+}
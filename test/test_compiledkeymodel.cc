@@ -0,0 +1,94 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Log-domain key model compiled once from a key profile and key transition
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include<map>
+#include<array>
+#include<vector>
+#include<memory>
+#include<iostream>
+
+#include "./pitchclass.h"
+#include "./key.h"
+#include "./keytransition.h"
+#include "./keyprofile.h"
+#include "./compiledkeymodel.h"
+#include "./hiddenmarkovmodel.h"
+
+using justkeydding::PitchClass;
+using justkeydding::KeyTransition;
+using justkeydding::KeyProfile;
+using justkeydding::Key;
+using justkeydding::CompiledKeyModel;
+using justkeydding::HiddenMarkovModel;
+
+
+int main(int argc, char *argv[]) {
+    // Observation symbols section
+    std::vector<PitchClass> pitchClassSequence;
+    pitchClassSequence.push_back(PitchClass("C"));
+    pitchClassSequence.push_back(PitchClass("E"));
+    pitchClassSequence.push_back(PitchClass("G"));
+    pitchClassSequence.push_back(PitchClass("F#"));
+    pitchClassSequence.push_back(PitchClass("D"));
+    // Model built from the maps, as the original constructor does
+    Key::KeyVector keyVector = Key::getAllKeysVector();
+    KeyTransition::KeyTransitionArray symmetrical =
+        KeyTransition("symmetrical").getKeyTransitionArray();
+    std::map<Key, double> initialProbabilities;
+    for (Key::KeyVector::iterator it = keyVector.begin();
+        it != keyVector.end(); it++) {
+        initialProbabilities[*it] = symmetrical[it->getInt()];
+    }
+    HiddenMarkovModel legacy(
+        pitchClassSequence,
+        keyVector,
+        initialProbabilities,
+        KeyTransition("exponential10").getKeyTransitionMap(),
+        KeyProfile("temperley", "sapp").getKeyProfileMap());
+    legacy.runViterbi();
+    // The same model compiled once and shared by two decoders
+    CompiledKeyModel::ConstPointer model =
+        std::make_shared<CompiledKeyModel>(
+            KeyProfile("temperley", "sapp"),
+            KeyTransition("exponential10"));
+    HiddenMarkovModel compiled(pitchClassSequence, model);
+    HiddenMarkovModel again(pitchClassSequence, model);
+    compiled.runViterbi();
+    again.runViterbi();
+    HiddenMarkovModel::ProbabilityVector expected =
+        legacy.getProbabilityVector();
+    bool equal =
+        compiled.getProbabilityVector() == expected &&
+        again.getProbabilityVector() == expected &&
+        compiled.getKeySequence() == legacy.getKeySequence();
+    Key::KeySequence keySequence = compiled.getKeySequence();
+    for (Key::KeySequence::const_iterator it = keySequence.begin();
+        it != keySequence.end(); it++) {
+        std::cout << it->getString() << " ";
+    }
+    std::cout << (equal ? "== legacy" : "!= legacy") << std::endl;
+    return equal ? 0 : 1;
+}
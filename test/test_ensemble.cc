@@ -0,0 +1,173 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Ensemble of a bundle compared with its models run one at a time
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include<cstdio>
+#include<string>
+#include<vector>
+#include<memory>
+#include<iostream>
+
+#include "./pitchclass.h"
+#include "./key.h"
+#include "./keytransition.h"
+#include "./keyprofile.h"
+#include "./compiledkeymodel.h"
+#include "./hiddenmarkovmodel.h"
+#include "./globalkeyestimator.h"
+#include "./modelbundle.h"
+#include "./ensemble.h"
+#include "./status.h"
+
+using justkeydding::PitchClass;
+using justkeydding::KeyTransition;
+using justkeydding::KeyProfile;
+using justkeydding::CompiledKeyModel;
+using justkeydding::HiddenMarkovModel;
+using justkeydding::GlobalKeyEstimator;
+using justkeydding::ModelBundle;
+using justkeydding::Ensemble;
+using justkeydding::Status;
+
+// Global key probabilities of one model compiled from its names, as
+// justkeydding -p -K -T computes them
+template <typename Observations>
+static GlobalKeyEstimator::ProbabilityVector runModel(
+    const Observations &observations,
+    const std::string &profile,
+    const std::string &transition) {
+    HiddenMarkovModel hmm(
+        observations,
+        std::make_shared<CompiledKeyModel>(
+            KeyProfile(profile), KeyTransition(transition)));
+    hmm.runViterbi();
+    GlobalKeyEstimator globalKeyEstimator(
+        GlobalKeyEstimator::compileModel(KeyTransition(transition)));
+    globalKeyEstimator.estimate(hmm.getKeySequence());
+    return globalKeyEstimator.getProbabilityVector();
+}
+
+int main(int argc, char *argv[]) {
+    const std::string fileName = "test_ensemble.jkm";
+    const char *profileNames[] = {"sapp", "temperley", "krumhansl_kessler"};
+    const char *transitionNames[] = {"exponential10", "linear"};
+    std::vector<ModelBundle::Profile> profiles;
+    std::vector<ModelBundle::Transition> transitions;
+    std::vector<ModelBundle::Model> models;
+    ModelBundle::Ensemble ensemble;
+    ensemble.name = "all";
+    for (int p = 0; p < 3; p++) {
+        KeyProfile keyProfile(profileNames[p]);
+        ModelBundle::Profile profile;
+        profile.name = profileNames[p];
+        profile.major = keyProfile.getMajorKeyProfile();
+        profile.minor = keyProfile.getMinorKeyProfile();
+        profiles.push_back(profile);
+    }
+    for (int t = 0; t < 2; t++) {
+        ModelBundle::Transition transition;
+        transition.name = transitionNames[t];
+        transition.transition =
+            KeyTransition(transitionNames[t]).getKeyTransitionArray();
+        transitions.push_back(transition);
+    }
+    for (int p = 0; p < 3; p++) {
+        for (int t = 0; t < 2; t++) {
+            ModelBundle::Model model;
+            model.name = std::string(profileNames[p]) + "_" +
+                transitionNames[t];
+            model.profile = profileNames[p];
+            model.transition = transitionNames[t];
+            models.push_back(model);
+            ensemble.models.push_back(model.name);
+        }
+    }
+    if (!ModelBundle::write(fileName, profiles, transitions, models,
+        std::vector<ModelBundle::Ensemble>(1, ensemble))) {
+        std::cout << "the bundle could not be written" << std::endl;
+        return 1;
+    }
+    std::vector<PitchClass> sequence;
+    HiddenMarkovModel::WeightedObservations chromaSequence;
+    for (int i = 0; i < 3000; i++) {
+        int pitchClass = (i * 7 + i / 11) % 12;
+        sequence.push_back(PitchClass(pitchClass));
+        // The pitch class and its fifth, so that some path stays possible
+        // under the zeros of "sapp"
+        HiddenMarkovModel::WeightedObservation weights = {};
+        weights[pitchClass] = 1.5;
+        weights[(pitchClass + 7) % 12] = 0.25;
+        chromaSequence.push_back(weights);
+    }
+    int mismatches = 0;
+    ModelBundle bundle(fileName);
+    Ensemble all(bundle, "all");
+    // The exact parallel decoder gives the same local keys
+    Ensemble parallel(bundle, "all");
+    parallel.setViterbiMode(HiddenMarkovModel::VITERBI_PARALLEL);
+    parallel.setNumberOfThreads(4);
+    Ensemble weighted(bundle, "all");
+    all.estimate(sequence);
+    parallel.estimate(sequence);
+    weighted.estimate(chromaSequence);
+    if (all.getStatus() != Status::ENSEMBLE_READY ||
+        parallel.getStatus() != Status::ENSEMBLE_READY ||
+        weighted.getStatus() != Status::ENSEMBLE_READY ||
+        all.getNumberOfModels() != models.size()) {
+        std::cout << "the ensemble could not be run" << std::endl;
+        std::remove(fileName.c_str());
+        return 1;
+    }
+    std::vector<Ensemble::ProbabilityVector> expanded =
+        all.getProbabilityVectors();
+    std::vector<Ensemble::ProbabilityVector> chunked =
+        parallel.getProbabilityVectors();
+    std::vector<Ensemble::ProbabilityVector> chroma =
+        weighted.getProbabilityVectors();
+    for (std::size_t m = 0; m < models.size(); m++) {
+        bool equal =
+            expanded[m] == runModel(
+                sequence, models[m].profile, models[m].transition) &&
+            chunked[m] == expanded[m] &&
+            chroma[m] == runModel(
+                chromaSequence, models[m].profile, models[m].transition);
+        std::cout << "all[" << m << "]" << (equal ? " == " : " != ")
+            << models[m].name << std::endl;
+        if (!equal) {
+            mismatches++;
+        }
+    }
+    Ensemble missing(bundle, "none");
+    missing.estimate(sequence);
+    bool rejected = missing.getStatus() == Status::ENSEMBLE_MODEL_ERROR &&
+        missing.getProbabilityVectors().empty();
+    std::cout << "none " << (rejected ? "rejected" : "not rejected")
+        << std::endl;
+    if (!rejected) {
+        mismatches++;
+    }
+    std::remove(fileName.c_str());
+    return mismatches == 0 ? 0 : 1;
+}
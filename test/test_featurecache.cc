@@ -0,0 +1,223 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Test of the content-addressed feature cache
+
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include<sys/stat.h>
+#include<sys/wait.h>
+#include<dirent.h>
+#include<unistd.h>
+#include<utime.h>
+
+#include<cstdio>
+#include<cstring>
+#include<string>
+#include<vector>
+#include<fstream>
+#include<iostream>
+
+#include "./pitchclass.h"
+#include "./chromagrambuffer.h"
+#include "./chromagramcache.h"
+#include "./featurecache.h"
+#include "./status.h"
+
+using justkeydding::PitchClass;
+using justkeydding::ChromagramBuffer;
+using justkeydding::ChromagramCache;
+using justkeydding::FeatureCache;
+using justkeydding::Status;
+
+static const char DIRECTORY[] = "test_featurecache";
+
+static void writeFile(const std::string &fileName, const std::string &text) {
+    std::ofstream outfile(fileName.c_str());
+    outfile << text;
+}
+
+static void removeDirectory(const std::string &directory) {
+    DIR *stream = opendir(directory.c_str());
+    if (!stream) {
+        return;
+    }
+    struct dirent *item;
+    while ((item = readdir(stream)) != NULL) {
+        std::string name = item->d_name;
+        if (name == "." || name == "..") {
+            continue;
+        }
+        std::string path = directory + "/" + name;
+        struct stat fileStatus;
+        if (stat(path.c_str(), &fileStatus) == 0 &&
+            S_ISDIR(fileStatus.st_mode)) {
+            removeDirectory(path);
+        } else {
+            std::remove(path.c_str());
+        }
+    }
+    closedir(stream);
+    rmdir(directory.c_str());
+}
+
+// Sets the last use of an entry, seconds ago
+static void age(const std::string &fileName, int seconds) {
+    struct utimbuf times;
+    times.actime = times.modtime = time(NULL) - seconds;
+    utime(fileName.c_str(), &times);
+}
+
+static ChromagramBuffer makeChromagram(int numberOfFrames, float value) {
+    ChromagramBuffer chromagram;
+    for (int frame = 0; frame < numberOfFrames; frame++) {
+        float *chrVector = chromagram.appendFrame(frame * 0.5);
+        for (int pc = 0; pc < PitchClass::NUMBER_OF_PITCHCLASSES; pc++) {
+            chrVector[pc] = value + pc;
+        }
+    }
+    return chromagram;
+}
+
+int main(int argc, char *argv[]) {
+    int mismatches = 0;
+    removeDirectory(DIRECTORY);
+    const std::string audio = std::string(DIRECTORY) + "_audio.wav";
+    const std::string other = std::string(DIRECTORY) + "_other.wav";
+    writeFile(audio, "RIFF and some samples");
+    writeFile(other, "RIFF and other samples");
+    FeatureCache cache(DIRECTORY, FeatureCache::DEFAULT_MAXIMUM_BYTES);
+    if (cache.getStatus() != Status::FEATURECACHE_READY) {
+        std::cout << "Could not create " << DIRECTORY << std::endl;
+        return 1;
+    }
+    // Same content and parameters, same key
+    std::string key = cache.getKey(audio, "s 0.7");
+    bool equal = !key.empty() && key == cache.getKey(audio, "s 0.7") &&
+        key != cache.getKey(audio, "s 0.8") &&
+        key != cache.getKey(other, "s 0.7") &&
+        cache.getKey("missing.wav", "s 0.7").empty();
+    std::cout << "keys" << (equal ? " == " : " != ")
+        << "content and parameters" << std::endl;
+    mismatches += !equal;
+    // Chromagrams
+    ChromagramBuffer chromagram = makeChromagram(100, 0.25f);
+    ChromagramCache::Parameters parameters;
+    parameters.tuning = 440.5f;
+    ChromagramBuffer found;
+    ChromagramCache::Parameters foundParameters;
+    equal = !cache.findChromagram(key, &found, &foundParameters) &&
+        cache.storeChromagram(key, chromagram, parameters) &&
+        cache.findChromagram(key, &found, &foundParameters) &&
+        found.getFrames() == chromagram.getFrames() &&
+        found.getTimestamps() == chromagram.getTimestamps() &&
+        foundParameters.tuning == parameters.tuning;
+    std::cout << "found chromagram" << (equal ? " == " : " != ")
+        << "stored" << std::endl;
+    mismatches += !equal;
+    // Results, per model
+    std::string result;
+    equal = !cache.findResult(key, "sapp-exp10", &result) &&
+        cache.storeResult(key, "sapp-exp10", "C\tmajor\n") &&
+        cache.findResult(key, "sapp-exp10", &result) &&
+        result == "C\tmajor\n" &&
+        !cache.findResult(key, "temperley-exp10", &result);
+    std::cout << "found result" << (equal ? " == " : " != ")
+        << "stored" << std::endl;
+    mismatches += !equal;
+    const FeatureCache::Statistics &statistics = cache.getStatistics();
+    equal = statistics.chromagramHits == 1 &&
+        statistics.chromagramMisses == 1 &&
+        statistics.resultHits == 1 &&
+        statistics.resultMisses == 2;
+    std::cout << statistics.chromagramHits << " chromagram hits, "
+        << statistics.chromagramMisses << " misses, "
+        << statistics.resultHits << " result hits, "
+        << statistics.resultMisses << " misses"
+        << (equal ? " == " : " != ") << "1, 1, 1, 2" << std::endl;
+    mismatches += !equal;
+    // Least recently used first: room for about two chromagrams
+    removeDirectory(DIRECTORY);
+    std::size_t entrySize = 0;
+    {
+        FeatureCache sizing(DIRECTORY, FeatureCache::DEFAULT_MAXIMUM_BYTES);
+        sizing.storeChromagram("size", chromagram, parameters);
+        struct stat fileStatus;
+        stat((std::string(DIRECTORY) + "/chroma/size.chroma").c_str(),
+            &fileStatus);
+        entrySize = fileStatus.st_size;
+        removeDirectory(DIRECTORY);
+    }
+    FeatureCache bounded(DIRECTORY, entrySize * 5 / 2);
+    const std::string chromaDirectory = std::string(DIRECTORY) + "/chroma/";
+    bounded.storeChromagram("first", chromagram, parameters);
+    age(chromaDirectory + "first.chroma", 30);
+    bounded.storeChromagram("second", chromagram, parameters);
+    age(chromaDirectory + "second.chroma", 20);
+    // Reading the first one makes the second one the oldest
+    bounded.findChromagram("first", &found, &foundParameters);
+    bounded.storeChromagram("third", chromagram, parameters);
+    equal = bounded.findChromagram("first", &found, &foundParameters) &&
+        !bounded.findChromagram("second", &found, &foundParameters) &&
+        bounded.findChromagram("third", &found, &foundParameters) &&
+        bounded.getStatistics().evictedEntries == 1;
+    std::cout << bounded.getStatistics().evictedEntries << " evicted, "
+        << (equal ? "" : "not ") << "the least recently used"
+        << std::endl;
+    mismatches += !equal;
+    // Processes writing and reading the same entries at the same time
+    // only ever see whole chromagrams
+    std::vector<pid_t> children;
+    for (int child = 0; child < 4; child++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            FeatureCache shared(DIRECTORY, entrySize * 3);
+            ChromagramBuffer mine = makeChromagram(100, child);
+            int errors = 0;
+            for (int i = 0; i < 50; i++) {
+                std::string entry = i % 2 ? "shared" : "other";
+                shared.storeChromagram(entry, mine, parameters);
+                ChromagramBuffer seen;
+                if (shared.findChromagram(entry, &seen, &foundParameters)) {
+                    errors += seen.getNumberOfFrames() != 100 ||
+                        seen.getFrame(99)[1] != seen.getFrame(0)[1];
+                }
+            }
+            _exit(errors != 0);
+        }
+        children.push_back(pid);
+    }
+    for (std::size_t child = 0; child < children.size(); child++) {
+        int childStatus = 0;
+        waitpid(children[child], &childStatus, 0);
+        if (!WIFEXITED(childStatus) || WEXITSTATUS(childStatus) != 0) {
+            std::cout << "process " << child
+                << " saw a partial chromagram" << std::endl;
+            mismatches++;
+        }
+    }
+    removeDirectory(DIRECTORY);
+    std::remove(audio.c_str());
+    std::remove(other.c_str());
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,134 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Scaled forward-backward algorithm for per-frame key posteriors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include<cmath>
+#include<vector>
+#include<memory>
+#include<iostream>
+
+#include "./pitchclass.h"
+#include "./key.h"
+#include "./keytransition.h"
+#include "./keyprofile.h"
+#include "./compiledkeymodel.h"
+#include "./forwardbackward.h"
+
+using justkeydding::PitchClass;
+using justkeydding::KeyTransition;
+using justkeydding::KeyProfile;
+using justkeydding::Key;
+using justkeydding::CompiledKeyModel;
+using justkeydding::ForwardBackward;
+
+
+int main(int argc, char *argv[]) {
+    CompiledKeyModel::ConstPointer model =
+        std::make_shared<CompiledKeyModel>(
+            KeyProfile("temperley", "temperley"),
+            KeyTransition("exponential2"));
+    const int n = model->getNumberOfStates();
+    ////////////////////////////////////////
+    // Three frames, against every path
+    ////////////////////////////////////////
+    std::vector<PitchClass> shortSequence;
+    shortSequence.push_back(PitchClass("C"));
+    shortSequence.push_back(PitchClass("E"));
+    shortSequence.push_back(PitchClass("A"));
+    std::vector<double> expected(3 * n, 0.0);
+    double likelihood = 0.0;
+    for (int s0 = 0; s0 < n; s0++) {
+        for (int s1 = 0; s1 < n; s1++) {
+            for (int s2 = 0; s2 < n; s2++) {
+                double p = std::pow(10.0,
+                    model->getLogStart(shortSequence[0].getInt())[s0] +
+                    model->getLogStep(
+                        shortSequence[1].getInt())[s0 * n + s1] +
+                    model->getLogStep(
+                        shortSequence[2].getInt())[s1 * n + s2]);
+                expected[s0] += p;
+                expected[n + s1] += p;
+                expected[2 * n + s2] += p;
+                likelihood += p;
+            }
+        }
+    }
+    ForwardBackward shortPosteriors(shortSequence, model);
+    shortPosteriors.run();
+    bool equal = true;
+    for (int t = 0; t < 3; t++) {
+        ForwardBackward::ProbabilityVector posterior =
+            shortPosteriors.getPosterior(t);
+        for (int s = 0; s < n; s++) {
+            double value = expected[t * n + s] / likelihood;
+            if (std::abs(posterior[model->getState(s)] - value) > 1e-12) {
+                equal = false;
+            }
+        }
+    }
+    if (std::abs(shortPosteriors.getLogLikelihood() -
+        std::log10(likelihood)) > 1e-9) {
+        equal = false;
+    }
+    std::cout << "3 frames: " << (equal ? "==" : "!=")
+        << " every path" << std::endl;
+    ////////////////////////////////////////
+    // A long sequence stays normalized
+    ////////////////////////////////////////
+    std::vector<PitchClass> longSequence;
+    for (int i = 0; i < 200000; i++) {
+        int tonic = (i / 7000) * 5 % 12;
+        int scale[] = {0, 4, 7, 2, 11};
+        longSequence.push_back(
+            PitchClass((tonic + scale[(i * 7 + i / 3) % 5]) % 12));
+    }
+    ForwardBackward longPosteriors(longSequence, model);
+    longPosteriors.run();
+    const std::vector<double> &posteriors = longPosteriors.getPosteriors();
+    bool normalized = std::isfinite(longPosteriors.getLogLikelihood());
+    for (std::size_t t = 0; t < longSequence.size(); t++) {
+        double sum = 0.0;
+        for (int key = 0; key < Key::NUMBER_OF_KEYS; key++) {
+            sum += posteriors[t * Key::NUMBER_OF_KEYS + key];
+        }
+        if (!(std::abs(sum - 1.0) < 1e-9)) {
+            normalized = false;
+        }
+    }
+    ForwardBackward::ProbabilityVector average =
+        longPosteriors.getAveragePosterior();
+    int best = 0;
+    for (int key = 1; key < Key::NUMBER_OF_KEYS; key++) {
+        if (average[key] > average[best]) {
+            best = key;
+        }
+    }
+    std::cout << longSequence.size() << " frames: "
+        << (normalized ? "normalized" : "not normalized")
+        << ", log-likelihood " << longPosteriors.getLogLikelihood()
+        << ", most likely key " << Key(best).getString()
+        << " (" << average[best] << ")" << std::endl;
+    return equal && normalized ? 0 : 1;
+}
@@ -0,0 +1,122 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Global key of a piece from the histogram of its local keys
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include<map>
+#include<cmath>
+#include<vector>
+#include<memory>
+#include<sstream>
+#include<iostream>
+
+#include "./pitchclass.h"
+#include "./key.h"
+#include "./keytransition.h"
+#include "./keyprofile.h"
+#include "./compiledkeymodel.h"
+#include "./hiddenmarkovmodel.h"
+#include "./globalkeyestimator.h"
+
+using justkeydding::PitchClass;
+using justkeydding::KeyTransition;
+using justkeydding::KeyProfile;
+using justkeydding::Key;
+using justkeydding::CompiledKeyModel;
+using justkeydding::HiddenMarkovModel;
+using justkeydding::GlobalKeyEstimator;
+
+
+int main(int argc, char *argv[]) {
+    // A piece modulating between a few keys
+    std::vector<PitchClass> pitchClassSequence;
+    for (int i = 0; i < 5000; i++) {
+        int tonic = (i / 700) * 5 % 12;
+        int degree = (i * 7 + i / 3) % 5;
+        int scale[] = {0, 4, 7, 2, 11};
+        pitchClassSequence.push_back(PitchClass((tonic + scale[degree]) % 12));
+    }
+    Key::KeyVector keyVector = Key::getAllKeysVector();
+    KeyTransition::KeyTransitionArray symmetrical =
+        KeyTransition("symmetrical").getKeyTransitionArray();
+    std::map<Key, double> initialProbabilities;
+    for (Key::KeyVector::iterator it = keyVector.begin();
+        it != keyVector.end(); it++) {
+        initialProbabilities[*it] = symmetrical[it->getInt()];
+    }
+    const char *profiles[] = {
+        "krumhansl_kessler", "aarden_essen", "bellman_budge",
+        "sapp", "temperley"};
+    const char *transitions[] = {"exponential2", "exponential10"};
+    int mismatches = 0;
+    for (int p = 0; p < 5; p++) {
+        for (int t = 0; t < 2; t++) {
+            KeyTransition keyTransition(transitions[t]);
+            HiddenMarkovModel hmm(
+                pitchClassSequence,
+                std::make_shared<CompiledKeyModel>(
+                    KeyProfile(profiles[p], profiles[p]), keyTransition));
+            hmm.runViterbi();
+            Key::KeySequence localKeys = hmm.getKeySequence();
+            CompiledKeyModel::ConstPointer globalKeyModel =
+                std::make_shared<CompiledKeyModel>(
+                    keyVector,
+                    initialProbabilities,
+                    KeyTransition("zero").getKeyTransitionMap(),
+                    keyTransition.getKeyTransitionMap());
+            // Full Viterbi over the local keys
+            HiddenMarkovModel hmm2(localKeys, globalKeyModel);
+            hmm2.runViterbi();
+            // Closed form
+            GlobalKeyEstimator estimator(globalKeyModel);
+            estimator.estimate(localKeys);
+            HiddenMarkovModel::ProbabilityVector expected =
+                hmm2.getProbabilityVector();
+            GlobalKeyEstimator::ProbabilityVector estimated =
+                estimator.getProbabilityVector();
+            // Same values up to rounding, same output of -p
+            std::ostringstream expectedOutput, estimatedOutput;
+            bool equal = estimator.getGlobalKey() ==
+                hmm2.getKeySequence().front();
+            for (int key = 0; key < Key::NUMBER_OF_KEYS; key++) {
+                expectedOutput << expected[key] << " ";
+                estimatedOutput << estimated[key] << " ";
+                if (std::abs(expected[key] - estimated[key]) >
+                    1e-9 * std::abs(expected[key])) {
+                    equal = false;
+                }
+            }
+            if (expectedOutput.str() != estimatedOutput.str()) {
+                equal = false;
+            }
+            std::cout << profiles[p] << " " << transitions[t] << ": "
+                << estimator.getGlobalKey().getString()
+                << (equal ? " == " : " != ") << "viterbi" << std::endl;
+            if (!equal) {
+                mismatches++;
+            }
+        }
+    }
+    return mismatches == 0 ? 0 : 1;
+}
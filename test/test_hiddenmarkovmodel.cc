@@ -27,6 +27,8 @@ SOFTWARE.
 #include<map>
 #include<array>
 #include<vector>
+#include<memory>
+#include<cmath>
 #include<iostream>
 #include<algorithm>
 
@@ -34,6 +36,7 @@ SOFTWARE.
 #include "./key.h"
 #include "./keytransition.h"
 #include "./keyprofile.h"
+#include "./compiledkeymodel.h"
 #include "./hiddenmarkovmodel.h"
 
 using justkeydding::PitchClass;
@@ -41,7 +44,29 @@ using justkeydding::KeyTransition;
 using justkeydding::KeyProfile;
 using justkeydding::Key;
 using justkeydding::HiddenMarkovModel;
+using justkeydding::CompiledKeyModel;
+using justkeydding::Status;
 
+// log10 probability of a given key path
+double getPathScore(
+    const std::vector<PitchClass> &pitchClassSequence,
+    const Key::KeySequence &keySequence,
+    CompiledKeyModel::ConstPointer model) {
+    std::vector<int> stateIndex(Key::NUMBER_OF_KEYS);
+    for (int state = 0; state < model->getNumberOfStates(); state++) {
+        stateIndex[model->getState(state)] = state;
+    }
+    int previous = stateIndex[keySequence[0].getInt()];
+    double score =
+        model->getLogStart(pitchClassSequence[0].getInt())[previous];
+    for (std::size_t t = 1; t < keySequence.size(); t++) {
+        int current = stateIndex[keySequence[t].getInt()];
+        score += model->getLogStep(pitchClassSequence[t].getInt())[
+            previous * model->getNumberOfStates() + current];
+        previous = current;
+    }
+    return score;
+}
 
 int main(int argc, char *argv[]) {
     ////////////////////////////
@@ -92,4 +117,240 @@ int main(int argc, char *argv[]) {
     Key::KeySequence mainKeySequence;
     hmm2.runViterbi();
     mainKeySequence = hmm2.getKeySequence();
+    ////////////////////////////////////
+    // Several models in a single sweep
+    ////////////////////////////////////
+    const char *profiles[] = {
+        "krumhansl_kessler", "aarden_essen", "bellman_budge",
+        "sapp", "temperley"};
+    const char *transitions[] = {"exponential2", "exponential10"};
+    std::vector<CompiledKeyModel::ConstPointer> models;
+    for (int p = 0; p < 5; p++) {
+        for (int t = 0; t < 2; t++) {
+            models.push_back(std::make_shared<CompiledKeyModel>(
+                KeyProfile(profiles[p], profiles[p]),
+                KeyTransition(transitions[t])));
+        }
+    }
+    std::vector<PitchClass> longSequence;
+    for (int i = 0; i < 1000; i++) {
+        longSequence.push_back(PitchClass((i * 7 + i / 13) % 12));
+    }
+    std::vector<HiddenMarkovModel::ProbabilityVector> batch =
+        HiddenMarkovModel::runBatchedViterbi(longSequence, models);
+    int mismatches = 0;
+    for (std::size_t m = 0; m < models.size(); m++) {
+        HiddenMarkovModel single(longSequence, models[m]);
+        single.runViterbi();
+        if (batch[m] != single.getProbabilityVector()) {
+            mismatches++;
+        }
+    }
+    std::cout << models.size() << " models decoded in one sweep, "
+        << mismatches << " mismatches" << std::endl;
+    ////////////////////////////////////////
+    // Checkpointed backtrace
+    ////////////////////////////////////////
+    const std::size_t lengths[] = {1, 2, 3, 16, 17, 1000};
+    int checkpointMismatches = 0;
+    for (int l = 0; l < 6; l++) {
+        std::vector<PitchClass> sequence(
+            longSequence.begin(), longSequence.begin() + lengths[l]);
+        HiddenMarkovModel lattice(sequence, models[6]);
+        lattice.runViterbi();
+        HiddenMarkovModel checkpoint(sequence, models[6]);
+        checkpoint.setViterbiMode(HiddenMarkovModel::VITERBI_CHECKPOINT);
+        checkpoint.runViterbi();
+        if (checkpoint.getKeySequence() != lattice.getKeySequence() ||
+            checkpoint.getProbabilityVector() !=
+            lattice.getProbabilityVector()) {
+            checkpointMismatches++;
+        }
+    }
+    std::cout << "checkpointed backtrace, " << checkpointMismatches
+        << " mismatches" << std::endl;
+    ////////////////////////////////////////
+    // Chunks decoded concurrently
+    ////////////////////////////////////////
+    std::vector<PitchClass> parallelSequence;
+    for (int i = 0; i < 20000; i++) {
+        int tonic = (i / 1500) * 7 % 12;
+        int scale[] = {0, 4, 7, 2, 11, 5, 9};
+        parallelSequence.push_back(
+            PitchClass((tonic + scale[(i * 5 + i / 7) % 7]) % 12));
+    }
+    int parallelMismatches = 0;
+    for (std::size_t m = 0; m < models.size(); m++) {
+        HiddenMarkovModel sequential(parallelSequence, models[m]);
+        sequential.runViterbi();
+        HiddenMarkovModel::ProbabilityVector sequentialProbabilities =
+            sequential.getProbabilityVector();
+        for (int threads = 2; threads <= 7; threads += 5) {
+            HiddenMarkovModel parallel(parallelSequence, models[m]);
+            parallel.setViterbiMode(HiddenMarkovModel::VITERBI_PARALLEL);
+            parallel.setNumberOfThreads(threads);
+            parallel.runViterbi();
+            // The same path and scores as the full lattice, bit for bit
+            bool equal =
+                parallel.getKeySequence() == sequential.getKeySequence() &&
+                parallel.getProbabilityVector() == sequentialProbabilities &&
+                parallel.getMaximumProbability() ==
+                sequential.getMaximumProbability();
+            if (!equal) {
+                parallelMismatches++;
+            }
+        }
+    }
+    std::cout << "parallel chunks, " << parallelMismatches
+        << " mismatches" << std::endl;
+    ////////////////////////////////////////
+    // Pruned decoding
+    ////////////////////////////////////////
+    int beamMismatches = 0;
+    for (std::size_t m = 0; m < models.size(); m++) {
+        HiddenMarkovModel full(parallelSequence, models[m]);
+        full.runViterbi();
+        // Skipping impossible states only, identical to the full decoder
+        HiddenMarkovModel exact(parallelSequence, models[m]);
+        exact.setViterbiMode(HiddenMarkovModel::VITERBI_BEAM);
+        exact.runViterbi();
+        if (exact.getKeySequence() != full.getKeySequence() ||
+            exact.getProbabilityVector() != full.getProbabilityVector()) {
+            beamMismatches++;
+        }
+        HiddenMarkovModel pruned(parallelSequence, models[m]);
+        pruned.setViterbiMode(HiddenMarkovModel::VITERBI_BEAM);
+        pruned.setBeamWidth(2.0);
+        pruned.runViterbi();
+        HiddenMarkovModel::PruningStatistics exactStatistics =
+            exact.getPruningStatistics();
+        HiddenMarkovModel::PruningStatistics prunedStatistics =
+            pruned.getPruningStatistics();
+        if (prunedStatistics.averageActiveStates >
+            exactStatistics.averageActiveStates) {
+            beamMismatches++;
+        }
+        std::cout << "beam, model " << m << ", active states "
+            << exactStatistics.averageActiveStates << " (exact) "
+            << prunedStatistics.averageActiveStates << " (beam 2) "
+            << (pruned.getKeySequence() == full.getKeySequence() ?
+                "==" : "!=") << " full" << std::endl;
+    }
+    std::cout << "beam, " << beamMismatches << " mismatches" << std::endl;
+    ////////////////////////////////////////
+    // Weighted observations
+    ////////////////////////////////////////
+    // A weight of one on a single pitch class is that pitch class
+    HiddenMarkovModel::WeightedObservations oneHotSequence;
+    for (std::size_t i = 0; i < 2000; i++) {
+        HiddenMarkovModel::WeightedObservation weights = {};
+        weights[parallelSequence[i].getInt()] = 1.0;
+        oneHotSequence.push_back(weights);
+    }
+    std::vector<PitchClass> symbolSequence;
+    for (std::size_t i = 0; i < oneHotSequence.size(); i++) {
+        symbolSequence.push_back(parallelSequence[i]);
+    }
+    int weightedMismatches = 0;
+    for (std::size_t m = 0; m < models.size(); m++) {
+        HiddenMarkovModel symbols(symbolSequence, models[m]);
+        symbols.runViterbi();
+        HiddenMarkovModel weighted(oneHotSequence, models[m]);
+        weighted.runViterbi();
+        HiddenMarkovModel::ProbabilityVector symbolProbabilities =
+            symbols.getProbabilityVector();
+        HiddenMarkovModel::ProbabilityVector weightedProbabilities =
+            weighted.getProbabilityVector();
+        double symbolScore = getPathScore(
+            symbolSequence, symbols.getKeySequence(), models[m]);
+        double weightedScore = getPathScore(
+            symbolSequence, weighted.getKeySequence(), models[m]);
+        bool equal =
+            weighted.getKeySequence() == symbols.getKeySequence() ||
+            std::abs(weightedScore - symbolScore) <=
+            1e-12 * std::abs(symbolScore);
+        for (int key = 0; key < Key::NUMBER_OF_KEYS; key++) {
+            if (std::abs(weightedProbabilities[key] -
+                symbolProbabilities[key]) >
+                1e-9 * std::abs(symbolProbabilities[key])) {
+                equal = false;
+            }
+        }
+        if (!equal) {
+            weightedMismatches++;
+        }
+    }
+    // Fractional weights, one observation per frame
+    HiddenMarkovModel::WeightedObservations chromaSequence;
+    for (int i = 0; i < 500; i++) {
+        HiddenMarkovModel::WeightedObservation weights = {};
+        for (int pc = 0; pc < PitchClass::NUMBER_OF_PITCHCLASSES; pc++) {
+            weights[pc] = ((i * 7 + pc * 5) % 12) / 4.0;
+        }
+        chromaSequence.push_back(weights);
+    }
+    HiddenMarkovModel chroma(chromaSequence, models[9]);
+    chroma.runViterbi();
+    if (chroma.getStatus() != Status::HIDDENMARKOVMODEL_VITERBI_READY ||
+        chroma.getKeySequence().size() != chromaSequence.size()) {
+        weightedMismatches++;
+    }
+    // The global key model has keys, not pitch classes, as symbols
+    HiddenMarkovModel global(
+        chromaSequence,
+        std::make_shared<CompiledKeyModel>(
+            keyVector,
+            initialProbabilities,
+            zeroTransiionProbabilities,
+            transitionProbabilities));
+    global.runViterbi();
+    if (global.getStatus() !=
+        Status::HIDDENMARKOVMODEL_INVALID_OBSERVATIONS ||
+        !global.getKeySequence().empty()) {
+        weightedMismatches++;
+    }
+    std::cout << "weighted observations, " << weightedMismatches
+        << " mismatches" << std::endl;
+    ////////////////////////////////////////
+    // Run-length encoded observations
+    ////////////////////////////////////////
+    HiddenMarkovModel::ObservationRuns runs;
+    std::vector<PitchClass> expandedSequence;
+    for (int i = 0; i < 300; i++) {
+        int pitchClass = (i * 7 + i / 13) % 12;
+        std::size_t length = 1 + (i * 37) % 45;
+        runs.push_back(std::make_pair(pitchClass, length));
+        for (std::size_t j = 0; j < length; j++) {
+            expandedSequence.push_back(PitchClass(pitchClass));
+        }
+    }
+    HiddenMarkovModel full(expandedSequence, models[9]);
+    full.runViterbi();
+    HiddenMarkovModel runLength(runs, models[9]);
+    runLength.setViterbiMode(HiddenMarkovModel::VITERBI_RUNLENGTH);
+    runLength.runViterbi();
+    HiddenMarkovModel::ProbabilityVector fullProbabilities =
+        full.getProbabilityVector();
+    HiddenMarkovModel::ProbabilityVector runLengthProbabilities =
+        runLength.getProbabilityVector();
+    // The runs are only expanded by the other modes
+    HiddenMarkovModel fullFromRuns(runs, models[9]);
+    fullFromRuns.runViterbi();
+    bool runLengthEqual =
+        runLength.getKeySequence() == full.getKeySequence() &&
+        fullFromRuns.getKeySequence() == full.getKeySequence() &&
+        fullFromRuns.getProbabilityVector() == fullProbabilities;
+    for (int key = 0; key < Key::NUMBER_OF_KEYS; key++) {
+        if (std::abs(fullProbabilities[key] - runLengthProbabilities[key]) >
+            1e-9 * std::abs(fullProbabilities[key])) {
+            runLengthEqual = false;
+        }
+    }
+    std::cout << expandedSequence.size() << " observations in "
+        << runs.size() << " runs "
+        << (runLengthEqual ? "==" : "!=") << " full" << std::endl;
+    return mismatches == 0 && checkpointMismatches == 0 &&
+        parallelMismatches == 0 && beamMismatches == 0 &&
+        weightedMismatches == 0 &&
+        runLengthEqual ? 0 : 1;
 }
@@ -26,6 +26,8 @@ SOFTWARE.
 
 #include<map>
 #include<array>
+#include<string>
+#include<cctype>
 #include<iostream>
 
 #include "./key.h"
@@ -42,4 +44,29 @@ int main(int argc, char *argv[]) {
     for (int i=0; i < allKeys.size(); i++) {
         std::cout << allKeys[i].getString() << std::endl;
     }
+    // Every spelling, letter and accidental, of every key
+    const char *spellings[] = {
+        "B#", "C", "C#", "Db", "D", "D#", "Eb", "E", "Fb", "E#", "F",
+        "F#", "Gb", "G", "G#", "Ab", "A", "A#", "Bb", "B", "Cb"
+    };
+    const int keys[] = {
+        0, 0, 1, 1, 2, 3, 3, 4, 4, 5, 5,
+        6, 6, 7, 8, 8, 9, 10, 10, 11, 11
+    };
+    int mismatches = 0;
+    for (int i = 0; i < 21; i++) {
+        std::string major(spellings[i]);
+        std::string minor(major);
+        minor[0] = std::tolower(minor[0]);
+        if (justkeydding::Key(major).getInt() != keys[i] ||
+            justkeydding::Key(minor).getInt() != keys[i] + 12) {
+            std::cout << spellings[i] << " misparsed" << std::endl;
+            mismatches++;
+        }
+    }
+    if (justkeydding::Key("H").getString() != "" ||
+        justkeydding::Key(24).getString() != "") {
+        mismatches++;
+    }
+    return mismatches == 0 ? 0 : 1;
 }
@@ -27,6 +27,7 @@ SOFTWARE.
 #include<map>
 #include<array>
 #include<iostream>
+#include<algorithm>
 
 #include "./keyprofile.h"
 
@@ -43,4 +44,29 @@ int main(int argc, char *argv[]) {
                 << " " << kpMajor[i]
                 << " " << kpMinor[i] << std::endl;
     }
+    // Every row of the matrix is the profile rotated to the tonic
+    int mismatches = 0;
+    justkeydding::KeyProfile temperley("temperley", "aarden_essen");
+    const justkeydding::KeyProfile::KeyProfileMatrix &matrix =
+        temperley.getKeyProfileMatrix();
+    justkeydding::KeyProfile::KeyProfileMap map =
+        temperley.getKeyProfileMap();
+    for (int key = 0; key < justkeydding::Key::NUMBER_OF_KEYS; key++) {
+        justkeydding::KeyProfile::KeyProfileArray profile =
+            justkeydding::Key(key).isMajorKey() ?
+            temperley.getMajorKeyProfile() :
+            temperley.getMinorKeyProfile();
+        std::rotate(profile.begin(), profile.begin() + 12 - key % 12,
+            profile.end());
+        for (int pc = 0; pc < 12; pc++) {
+            if (matrix[key * 12 + pc] != profile[pc] ||
+                map[justkeydding::Key(key)][justkeydding::PitchClass(pc)] !=
+                profile[pc]) {
+                mismatches++;
+            }
+        }
+    }
+    std::cout << "profile matrix, " << mismatches
+        << " mismatches" << std::endl;
+    return mismatches == 0 ? 0 : 1;
 }
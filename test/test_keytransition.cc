@@ -38,4 +38,37 @@ int main(int argc, char *argv[]) {
     for (int i = 0; i < ktArray.size(); i++) {
         std::cout << ktArray[i] << std::endl;
     }
+    // The matrix is invariant to transposition, its first row is the
+    // array, and A minor sees the keys as C major sees their relatives
+    int mismatches = 0;
+    justkeydding::KeyTransition exponential("exponential10");
+    const justkeydding::KeyTransition::KeyTransitionMatrix &matrix =
+        exponential.getKeyTransitionMatrix();
+    justkeydding::KeyTransition::KeyTransitionArray array =
+        exponential.getKeyTransitionArray();
+    justkeydding::KeyTransition::KeyTransitionMap map =
+        exponential.getKeyTransitionMap();
+    for (int from = 0; from < 24; from++) {
+        for (int to = 0; to < 24; to++) {
+            int shiftedFrom = from / 12 * 12 + (from + 1) % 12;
+            int shiftedTo = to / 12 * 12 + (to + 1) % 12;
+            if (matrix[from * 24 + to] !=
+                matrix[shiftedFrom * 24 + shiftedTo] ||
+                map[justkeydding::Key(from)][justkeydding::Key(to)] !=
+                matrix[from * 24 + to]) {
+                mismatches++;
+            }
+        }
+    }
+    const int aMinor = justkeydding::Key::KEY_A_NATURAL_MINOR;
+    for (int pc = 0; pc < 12; pc++) {
+        if (matrix[pc] != array[pc] ||
+            matrix[aMinor * 24 + pc] != array[12 + pc] ||
+            matrix[aMinor * 24 + 12 + (pc + 9) % 12] != array[pc]) {
+            mismatches++;
+        }
+    }
+    std::cout << "transition matrix, " << mismatches
+        << " mismatches" << std::endl;
+    return mismatches == 0 ? 0 : 1;
 }
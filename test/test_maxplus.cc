@@ -0,0 +1,117 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Max-plus matrix-vector kernels for the Viterbi recurrence
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include<cstdlib>
+#include<cstring>
+#include<vector>
+#include<limits>
+#include<algorithm>
+#include<iostream>
+
+#include "./maxplus.h"
+
+using justkeydding::MaxPlus;
+
+int main(int argc, char *argv[]) {
+    // Random 24-state problems with impossible transitions and ties,
+    // every instruction set must match the scalar kernel bit for bit
+    const int numberOfStates = 24;
+    const int numberOfTrials = 1000;
+    const double impossible = -std::numeric_limits<double>::infinity();
+    std::srand(1);
+    std::vector<double> current(numberOfStates);
+    std::vector<double> matrix(numberOfStates * numberOfStates);
+    bool equal = true;
+    for (int trial = 0; trial < numberOfTrials; trial++) {
+        for (int i = 0; i < numberOfStates; i++) {
+            int r = std::rand() % 10;
+            current[i] = r == 0 ? impossible : -(std::rand() % 50) / 4.0;
+        }
+        for (int i = 0; i < numberOfStates * numberOfStates; i++) {
+            int r = std::rand() % 10;
+            matrix[i] = r == 0 ? impossible : -(std::rand() % 20) / 8.0;
+        }
+        MaxPlus::setInstructionSet(MaxPlus::INSTRUCTIONSET_SCALAR);
+        std::vector<double> expected(numberOfStates);
+        std::vector<signed char> expectedBackPointers(numberOfStates);
+        MaxPlus::step(&current[0], &matrix[0], numberOfStates,
+            &expected[0], &expectedBackPointers[0]);
+        // The best candidate minus the runner-up, by sorting them
+        std::vector<double> expectedMargins(numberOfStates);
+        for (int to = 0; to < numberOfStates; to++) {
+            std::vector<double> candidates;
+            for (int from = 0; from < numberOfStates; from++) {
+                candidates.push_back(
+                    current[from] + matrix[from * numberOfStates + to]);
+            }
+            std::sort(candidates.begin(), candidates.end());
+            expectedMargins[to] = candidates[numberOfStates - 1] -
+                candidates[numberOfStates - 2];
+        }
+        for (int instructionSet = 0;
+            instructionSet < MaxPlus::NUMBER_OF_INSTRUCTIONSETS;
+            instructionSet++) {
+            if (!MaxPlus::setInstructionSet(instructionSet)) {
+                continue;
+            }
+            std::vector<double> next(numberOfStates);
+            std::vector<signed char> backPointers(numberOfStates);
+            MaxPlus::step(&current[0], &matrix[0], numberOfStates,
+                &next[0], &backPointers[0]);
+            if (std::memcmp(&next[0], &expected[0],
+                    numberOfStates * sizeof(double)) != 0 ||
+                backPointers != expectedBackPointers) {
+                std::cout << MaxPlus::getInstructionSetName(instructionSet)
+                    << " differs from scalar" << std::endl;
+                equal = false;
+            }
+            std::vector<double> margins(numberOfStates);
+            MaxPlus::stepWithMargins(&current[0], &matrix[0], numberOfStates,
+                &next[0], &backPointers[0], &margins[0]);
+            bool sameMargins = true;
+            for (int to = 0; to < numberOfStates; to++) {
+                sameMargins = sameMargins && (expected[to] ==
+                    -std::numeric_limits<double>::infinity() ||
+                    margins[to] == expectedMargins[to]);
+            }
+            if (std::memcmp(&next[0], &expected[0],
+                    numberOfStates * sizeof(double)) != 0 ||
+                backPointers != expectedBackPointers || !sameMargins) {
+                std::cout << MaxPlus::getInstructionSetName(instructionSet)
+                    << " margins differ" << std::endl;
+                equal = false;
+            }
+        }
+    }
+    for (int instructionSet = 0;
+        instructionSet < MaxPlus::NUMBER_OF_INSTRUCTIONSETS;
+        instructionSet++) {
+        std::cout << MaxPlus::getInstructionSetName(instructionSet) << ": "
+            << (MaxPlus::isSupported(instructionSet) ?
+                "supported" : "not supported") << std::endl;
+    }
+    return equal ? 0 : 1;
+}
@@ -0,0 +1,182 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Model bundle written, memory-mapped and compared with the compiled models
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include<cstdio>
+#include<cstring>
+#include<string>
+#include<vector>
+#include<memory>
+#include<fstream>
+#include<iostream>
+
+#include "./pitchclass.h"
+#include "./key.h"
+#include "./keytransition.h"
+#include "./keyprofile.h"
+#include "./compiledkeymodel.h"
+#include "./hiddenmarkovmodel.h"
+#include "./modelbundle.h"
+#include "./status.h"
+
+using justkeydding::PitchClass;
+using justkeydding::KeyTransition;
+using justkeydding::KeyProfile;
+using justkeydding::Key;
+using justkeydding::CompiledKeyModel;
+using justkeydding::HiddenMarkovModel;
+using justkeydding::ModelBundle;
+using justkeydding::Status;
+
+int main(int argc, char *argv[]) {
+    const std::string fileName = "test_modelbundle.jkm";
+    const char *profileNames[] = {"sapp", "temperley", "krumhansl_kessler"};
+    const char *transitionNames[] = {"exponential10", "linear"};
+    std::vector<ModelBundle::Profile> profiles;
+    std::vector<ModelBundle::Transition> transitions;
+    std::vector<ModelBundle::Model> models;
+    ModelBundle::Ensemble ensemble;
+    ensemble.name = "all";
+    for (int p = 0; p < 3; p++) {
+        KeyProfile keyProfile(profileNames[p]);
+        ModelBundle::Profile profile;
+        profile.name = profileNames[p];
+        profile.major = keyProfile.getMajorKeyProfile();
+        profile.minor = keyProfile.getMinorKeyProfile();
+        profiles.push_back(profile);
+    }
+    for (int t = 0; t < 2; t++) {
+        ModelBundle::Transition transition;
+        transition.name = transitionNames[t];
+        transition.transition =
+            KeyTransition(transitionNames[t]).getKeyTransitionArray();
+        transitions.push_back(transition);
+    }
+    for (int p = 0; p < 3; p++) {
+        for (int t = 0; t < 2; t++) {
+            ModelBundle::Model model;
+            model.name = std::string(profileNames[p]) + "_" +
+                transitionNames[t];
+            model.profile = profileNames[p];
+            model.transition = transitionNames[t];
+            models.push_back(model);
+            ensemble.models.push_back(model.name);
+        }
+    }
+    std::vector<ModelBundle::Ensemble> ensembles(1, ensemble);
+    int mismatches = 0;
+    if (!ModelBundle::write(
+        fileName, profiles, transitions, models, ensembles)) {
+        std::cout << "the bundle could not be written" << std::endl;
+        return 1;
+    }
+    ////////////////////////////////////////
+    // Mapped tables against compiled ones
+    ////////////////////////////////////////
+    std::vector<PitchClass> sequence;
+    for (int i = 0; i < 3000; i++) {
+        sequence.push_back(PitchClass((i * 7 + i / 11) % 12));
+    }
+    std::vector<CompiledKeyModel::ConstPointer> mappedModels;
+    {
+        ModelBundle bundle(fileName);
+        if (bundle.getStatus() != Status::MODELBUNDLE_READY ||
+            bundle.getModelNames().size() != models.size() ||
+            bundle.getEnsemble("all") != ensemble.models ||
+            bundle.getModel("sapp_heatmap")) {
+            mismatches++;
+        }
+        for (std::size_t m = 0; m < models.size(); m++) {
+            mappedModels.push_back(bundle.getModel(models[m].name));
+        }
+        KeyTransition::KeyTransitionArray transitionArray;
+        if (!bundle.getKeyTransitionArray("sapp_linear", &transitionArray) ||
+            transitionArray != transitions[1].transition) {
+            mismatches++;
+        }
+    }
+    // The models keep the mapping alive after the bundle is gone
+    for (std::size_t m = 0; m < models.size(); m++) {
+        CompiledKeyModel::ConstPointer compiled =
+            std::make_shared<CompiledKeyModel>(
+                KeyProfile(models[m].profile),
+                KeyTransition(models[m].transition));
+        std::size_t tableSize = sizeof(double) *
+            CompiledKeyModel::getNumberOfTableValues(
+                compiled->getNumberOfStates(),
+                compiled->getNumberOfSymbols());
+        bool equal = mappedModels[m] &&
+            std::memcmp(mappedModels[m]->getTables(),
+                compiled->getTables(), tableSize) == 0;
+        if (equal) {
+            HiddenMarkovModel mappedHmm(sequence, mappedModels[m]);
+            mappedHmm.runViterbi();
+            HiddenMarkovModel compiledHmm(sequence, compiled);
+            compiledHmm.runViterbi();
+            equal =
+                mappedHmm.getKeySequence() == compiledHmm.getKeySequence() &&
+                mappedHmm.getProbabilityVector() ==
+                compiledHmm.getProbabilityVector();
+        }
+        std::cout << models[m].name << (equal ? " == " : " != ")
+            << "compiled" << std::endl;
+        if (!equal) {
+            mismatches++;
+        }
+    }
+    ////////////////////////////////////////
+    // Files that are not bundles
+    ////////////////////////////////////////
+    if (ModelBundle("missing.jkm").getStatus() !=
+        Status::MODELBUNDLE_INPUTFILE_ERROR) {
+        mismatches++;
+    }
+    std::vector<char> contents;
+    {
+        std::ifstream infile(fileName.c_str(), std::ios::binary);
+        contents.assign(std::istreambuf_iterator<char>(infile),
+            std::istreambuf_iterator<char>());
+    }
+    // Truncated, and from another version
+    for (int corruption = 0; corruption < 2; corruption++) {
+        std::vector<char> corrupted(contents);
+        if (corruption == 0) {
+            corrupted.resize(corrupted.size() / 2);
+        } else {
+            corrupted[8]++;
+        }
+        {
+            std::ofstream outfile(fileName.c_str(), std::ios::binary);
+            outfile.write(&corrupted[0], corrupted.size());
+        }
+        if (ModelBundle(fileName).getStatus() !=
+            Status::MODELBUNDLE_FORMAT_ERROR) {
+            mismatches++;
+        }
+    }
+    std::remove(fileName.c_str());
+    std::cout << "model bundle, " << mismatches << " mismatches" << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,271 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Parity of the NNLS solvers of the chroma extraction
+
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include<dirent.h>
+
+#include<chrono>
+#include<cmath>
+#include<cstdlib>
+#include<string>
+#include<vector>
+#include<iostream>
+#include<algorithm>
+
+#include <chromamethods.h>
+#include <fnnls.h>
+
+#include "./pitchclass.h"
+#include "./chromagrambuffer.h"
+#include "./audiochromastream.h"
+#include "./status.h"
+
+using justkeydding::ChromagramBuffer;
+using justkeydding::AudioChromaStream;
+using justkeydding::PitchClass;
+using justkeydding::Status;
+
+// Largest difference of the solutions of a and b, relative to their
+// largest value
+template <typename A, typename B>
+static double getLargestDifference(const A *a, const B *b, int n) {
+    double largest = 0;
+    double largestDifference = 0;
+    for (int i = 0; i < n; i++) {
+        largest = std::max(largest, static_cast<double>(b[i]));
+        largestDifference = std::max(largestDifference,
+            std::fabs(static_cast<double>(a[i]) - b[i]));
+    }
+    return largest > 0 ? largestDifference / largest : largestDifference;
+}
+
+// Both solvers on mixtures of a few notes of the dictionary, plus noise,
+// over random subsets of the notes; the number of mismatches
+static int compareSolvers(int numberOfProblems) {
+    const int numberOfNotes = 84;
+    std::vector<float> dictionary(nNote * numberOfNotes, 0.f);
+    dictionaryMatrix(&dictionary[0], 0.7);
+    std::srand(1);
+    int mismatches = 0;
+    double largestDifference = 0;
+    double lawsonHansonSeconds = 0;
+    double gramSeconds = 0;
+    for (int problem = 0; problem < numberOfProblems; problem++) {
+        std::vector<float> b(nNote);
+        for (int bin = 0; bin < nNote; bin++) {
+            b[bin] = 0.02f * std::rand() / RAND_MAX;
+        }
+        for (int note = 0; note < 6; note++) {
+            int column = std::rand() % numberOfNotes;
+            float amplitude = static_cast<float>(std::rand()) / RAND_MAX;
+            for (int bin = 0; bin < nNote; bin++) {
+                b[bin] += amplitude * dictionary[column * nNote + bin];
+            }
+        }
+        std::vector<int> notes;
+        for (int note = 0; note < numberOfNotes; note++) {
+            if (std::rand() % 3 != 0) {
+                notes.push_back(note);
+            }
+        }
+        const int n = notes.size();
+        std::vector<float> a(nNote * n);
+        std::vector<double> ata(n * n), atb(n), xGram(n);
+        for (int i = 0; i < n; i++) {
+            const float *column = &dictionary[notes[i] * nNote];
+            std::copy(column, column + nNote, &a[i * nNote]);
+        }
+        // The plugin takes the Gram matrix from one computed for the whole
+        // dictionary, so only the right-hand side is timed with the solver
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < n; j++) {
+                double sum = 0;
+                for (int bin = 0; bin < nNote; bin++) {
+                    sum += static_cast<double>(a[i * nNote + bin]) *
+                        a[j * nNote + bin];
+                }
+                ata[j + i * n] = sum;
+            }
+        }
+        std::vector<double> work(fnnlsWorkSize(n));
+        std::vector<int> index(fnnlsIndexSize(n));
+        std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        for (int i = 0; i < n; i++) {
+            atb[i] = 0;
+            for (int bin = 0; bin < nNote; bin++) {
+                atb[i] += static_cast<double>(a[i * nNote + bin]) * b[bin];
+            }
+        }
+        int mode;
+        fnnls(&ata[0], &atb[0], n, &xGram[0], &work[0], &index[0], &mode);
+        mismatches += mode != 1;
+        std::chrono::steady_clock::time_point lawsonHanson =
+            std::chrono::steady_clock::now();
+        float x[84 + 1000], w[84 + 1000], zz[84 + 1000], rnorm;
+        int indx[84 + 1000];
+        nnls(&a[0], nNote, nNote, n, &b[0], x, &rnorm, w, zz, indx, &mode);
+        gramSeconds += std::chrono::duration<double>(
+            lawsonHanson - start).count();
+        lawsonHansonSeconds += std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - lawsonHanson).count();
+        double difference = getLargestDifference(&xGram[0], x, n);
+        largestDifference = std::max(largestDifference, difference);
+        mismatches += difference > 1e-4;
+    }
+    std::cout << numberOfProblems << " dictionary problems, largest"
+        " difference " << largestDifference << ", Lawson-Hanson "
+        << lawsonHansonSeconds << " s, Gram active set "
+        << gramSeconds << " s" << std::endl;
+    return mismatches;
+}
+
+// Seconds to extract the chromagram of a file with a solver, on one
+// thread, adding the solver statistics to statistics
+static double extract(
+    const std::string &fileName,
+    int nnlsSolver,
+    ChromagramBuffer *chromagram,
+    NNLSChroma::NNLSStatistics *statistics) {
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    AudioChromaStream stream(fileName, -1, 1, nnlsSolver);
+    while (stream.read(chromagram)) {
+    }
+    if (stream.getStatus() != Status::AUDIOCHROMASTREAM_READY) {
+        std::cout << "Could not read " << fileName << std::endl;
+    }
+    *statistics += stream.getNNLSStatistics();
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+// The wav files of test_data, in order
+static std::vector<std::string> getTestFiles() {
+    std::vector<std::string> fileNames;
+    DIR *directory = opendir("test_data");
+    if (!directory) {
+        return fileNames;
+    }
+    struct dirent *item;
+    while ((item = readdir(directory)) != NULL) {
+        std::string name = item->d_name;
+        if (name.size() > 4 && name.compare(name.size() - 4, 4, ".wav") == 0) {
+            fileNames.push_back("test_data/" + name);
+        }
+    }
+    closedir(directory);
+    std::sort(fileNames.begin(), fileNames.end());
+    return fileNames;
+}
+
+// Largest difference of two chromagrams, relative to the largest value
+// of each frame; infinite if they have different timestamps
+static double getLargestDifference(
+    const ChromagramBuffer &a,
+    const ChromagramBuffer &b) {
+    if (a.isEmpty() || a.getTimestamps() != b.getTimestamps()) {
+        return INFINITY;
+    }
+    double largestDifference = 0;
+    for (std::size_t frame = 0; frame < a.getNumberOfFrames(); frame++) {
+        largestDifference = std::max(largestDifference,
+            getLargestDifference(a.getFrame(frame), b.getFrame(frame),
+                PitchClass::NUMBER_OF_PITCHCLASSES));
+    }
+    return largestDifference;
+}
+
+// Iterations of the solution loop per solve
+static double getIterationsPerSolve(
+    const NNLSChroma::NNLSStatistics &statistics) {
+    return static_cast<double>(statistics.iterations) /
+        std::max(statistics.solves, 1L);
+}
+
+// The chroma of every file, by default those of test_data, with the
+// Gram active set and warm start solvers against Lawson-Hanson, e.g.:
+//
+//   bin/test_nnlssolver test_data/*.wav
+//
+// The warm starts solve the same frames as Lawson-Hanson from a cold
+// start, so the difference of their iterations is the number saved.
+int main(int argc, char *argv[]) {
+    int mismatches = compareSolvers(1000);
+    std::vector<std::string> fileNames(argv + 1, argv + argc);
+    if (fileNames.empty()) {
+        fileNames = getTestFiles();
+    }
+    double lawsonHansonSeconds = 0;
+    double gramSeconds = 0;
+    double warmStartSeconds = 0;
+    NNLSChroma::NNLSStatistics lawsonHansonStatistics;
+    NNLSChroma::NNLSStatistics gramStatistics;
+    NNLSChroma::NNLSStatistics warmStartStatistics;
+    for (std::size_t file = 0; file < fileNames.size(); file++) {
+        ChromagramBuffer lawsonHanson, gram, warmStart;
+        NNLSChroma::NNLSStatistics coldFile, warmFile;
+        lawsonHansonSeconds += extract(fileNames[file],
+            NNLSChroma::LawsonHansonSolver, &lawsonHanson, &coldFile);
+        gramSeconds += extract(fileNames[file],
+            NNLSChroma::GramActiveSetSolver, &gram, &gramStatistics);
+        warmStartSeconds += extract(fileNames[file],
+            NNLSChroma::WarmStartSolver, &warmStart, &warmFile);
+        lawsonHansonStatistics += coldFile;
+        warmStartStatistics += warmFile;
+        double gramDifference = getLargestDifference(gram, lawsonHanson);
+        double warmStartDifference =
+            getLargestDifference(warmStart, lawsonHanson);
+        bool mismatch = !(gramDifference <= 1e-4) ||
+            !(warmStartDifference <= 1e-4) ||
+            warmFile.solves != coldFile.solves;
+        std::cout << fileNames[file] << ": "
+            << lawsonHanson.getNumberOfFrames() << " frames, largest"
+            " difference " << gramDifference << " (Gram active set), "
+            << warmStartDifference << " (warm start); "
+            << coldFile.iterations << " cold iterations, "
+            << warmFile.iterations << " warm"
+            << (mismatch ? ", MISMATCH" : "") << std::endl;
+        mismatches += mismatch;
+    }
+    std::cout << fileNames.size() << " files, Lawson-Hanson "
+        << lawsonHansonSeconds << " s, Gram active set " << gramSeconds
+        << " s, warm start " << warmStartSeconds << " s" << std::endl;
+    std::cout << lawsonHansonStatistics.solves << " solves, iterations"
+        " per solve: Lawson-Hanson "
+        << getIterationsPerSolve(lawsonHansonStatistics)
+        << ", Gram active set " << getIterationsPerSolve(gramStatistics)
+        << ", warm start " << getIterationsPerSolve(warmStartStatistics)
+        << " (" << lawsonHansonStatistics.iterations -
+            warmStartStatistics.iterations << " saved)" << std::endl;
+    std::cout << "Solves stopped at the iteration limit: Lawson-Hanson "
+        << lawsonHansonStatistics.unconverged << ", Gram active set "
+        << gramStatistics.unconverged << ", warm start "
+        << warmStartStatistics.unconverged << std::endl;
+    std::cout << "NNLS solvers, " << mismatches << " mismatches"
+        << std::endl;
+    return mismatches != 0;
+}
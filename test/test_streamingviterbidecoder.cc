@@ -0,0 +1,112 @@
+/*
+MIT License
+
+Copyright (c) 2018 Nestor Napoles
+
+Fixed-lag Viterbi decoder for observations arriving incrementally
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR sOTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include<cmath>
+#include<vector>
+#include<memory>
+#include<iostream>
+
+#include "./pitchclass.h"
+#include "./key.h"
+#include "./keytransition.h"
+#include "./keyprofile.h"
+#include "./compiledkeymodel.h"
+#include "./hiddenmarkovmodel.h"
+#include "./streamingviterbidecoder.h"
+
+using justkeydding::PitchClass;
+using justkeydding::KeyTransition;
+using justkeydding::KeyProfile;
+using justkeydding::Key;
+using justkeydding::CompiledKeyModel;
+using justkeydding::HiddenMarkovModel;
+using justkeydding::StreamingViterbiDecoder;
+
+Key::KeySequence decode(
+    const std::vector<PitchClass> &pitchClassSequence,
+    CompiledKeyModel::ConstPointer model,
+    std::size_t maximumLag) {
+    StreamingViterbiDecoder decoder(model, maximumLag);
+    Key::KeySequence keySequence;
+    for (std::vector<PitchClass>::const_iterator it =
+        pitchClassSequence.begin(); it != pitchClassSequence.end(); it++) {
+        decoder.addObservation(*it);
+        // Keys come out while the observations are still arriving
+        Key::KeySequence committed = decoder.takeCommittedKeys();
+        keySequence.insert(
+            keySequence.end(), committed.begin(), committed.end());
+    }
+    decoder.finish();
+    Key::KeySequence committed = decoder.takeCommittedKeys();
+    keySequence.insert(keySequence.end(), committed.begin(), committed.end());
+    StreamingViterbiDecoder::LatencyStatistics statistics =
+        decoder.getLatencyStatistics();
+    std::cout << "maximum lag " << maximumLag << ": "
+        << statistics.numberOfCommits << " commits ("
+        << statistics.numberOfForcedCommits << " forced), "
+        << "mean lag " << statistics.meanLag << ", "
+        << "maximum lag " << statistics.maximumLag << std::endl;
+    return keySequence;
+}
+
+int main(int argc, char *argv[]) {
+    // A piece modulating between a few keys
+    std::vector<PitchClass> pitchClassSequence;
+    for (int i = 0; i < 5000; i++) {
+        int tonic = (i / 700) * 5 % 12;
+        int degree = (i * 7 + i / 3) % 5;
+        int scale[] = {0, 4, 7, 2, 11};
+        pitchClassSequence.push_back(PitchClass((tonic + scale[degree]) % 12));
+    }
+    CompiledKeyModel::ConstPointer model =
+        std::make_shared<CompiledKeyModel>(
+            KeyProfile("sapp", "sapp"), KeyTransition("exponential10"));
+    HiddenMarkovModel hmm(pitchClassSequence, model);
+    hmm.runViterbi();
+    Key::KeySequence offline = hmm.getKeySequence();
+    // Without forced commits, the output is the offline path
+    Key::KeySequence unbounded =
+        decode(pitchClassSequence, model, pitchClassSequence.size());
+    bool equal = unbounded == offline;
+    std::cout << "unbounded lag" << (equal ? " == " : " != ")
+        << "offline path" << std::endl;
+    // With a short lag, the output is still a valid path
+    Key::KeySequence bounded = decode(pitchClassSequence, model, 16);
+    bool valid = bounded.size() == offline.size();
+    std::size_t agreement = 0;
+    for (std::size_t t = 1; valid && t < bounded.size(); t++) {
+        double logStep = model->getLogStep(pitchClassSequence[t].getInt())
+            [bounded[t - 1].getInt() * 24 + bounded[t].getInt()];
+        valid = !std::isinf(logStep);
+    }
+    for (std::size_t t = 0; valid && t < bounded.size(); t++) {
+        agreement += bounded[t] == offline[t];
+    }
+    std::cout << "lag 16 path is " << (valid ? "valid" : "not valid")
+        << ", " << agreement << "/" << offline.size()
+        << " frames agree with the offline path" << std::endl;
+    return equal && valid ? 0 : 1;
+}